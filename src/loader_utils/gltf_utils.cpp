@@ -1,5 +1,35 @@
 #include "gltf_utils.h"
-#include "vk_utils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+// the loader is also used on CPU only (rt_bench), so it does not depend on vk_utils logging
+static void logWarning(const std::string& a_msg)
+{
+  std::cout << "[WARNING]: " << a_msg << std::endl;
+}
+
+LiteMath::float4x4 matrixFromTRS(const LiteMath::float3 &t, const LiteMath::float4 &r, const LiteMath::float3 &s)
+{
+  const float x = r.x, y = r.y, z = r.z, w = r.w;
+
+  LiteMath::float4x4 res;
+  res.set_col(0, float4((1.0f - 2.0f * (y * y + z * z)) * s.x, 2.0f * (x * y + z * w) * s.x, 2.0f * (x * z - y * w) * s.x, 0.0f));
+  res.set_col(1, float4(2.0f * (x * y - z * w) * s.y, (1.0f - 2.0f * (x * x + z * z)) * s.y, 2.0f * (y * z + x * w) * s.y, 0.0f));
+  res.set_col(2, float4(2.0f * (x * z + y * w) * s.z, 2.0f * (y * z - x * w) * s.z, (1.0f - 2.0f * (x * x + y * y)) * s.z, 0.0f));
+  res.set_col(3, float4(t.x, t.y, t.z, 1.0f));
+  return res;
+}
+
+static void trsFromGLTFNode(const tinygltf::Node &node, LiteMath::float3 &t, LiteMath::float4 &r, LiteMath::float3 &s)
+{
+  t = (node.translation.size() == 3) ? LiteMath::float3(node.translation[0], node.translation[1], node.translation[2]) : LiteMath::float3(0.0f, 0.0f, 0.0f);
+  r = (node.rotation.size() == 4) ? LiteMath::float4(node.rotation[0], node.rotation[1], node.rotation[2], node.rotation[3]) : LiteMath::float4(0.0f, 0.0f, 0.0f, 1.0f);
+  s = (node.scale.size() == 3) ? LiteMath::float3(node.scale[0], node.scale[1], node.scale[2]) : LiteMath::float3(1.0f, 1.0f, 1.0f);
+}
 
 LiteMath::float4x4 transformMatrixFromGLTFNode(const tinygltf::Node &node)
 {
@@ -14,24 +44,66 @@ LiteMath::float4x4 transformMatrixFromGLTFNode(const tinygltf::Node &node)
   }
   else
   {
-    if(node.scale.size() == 3)
-    {
-      LiteMath::float3 s = LiteMath::float3(node.scale[0], node.scale[1], node.scale[2]);
-      nodeMatrix         = LiteMath::scale4x4(s) * nodeMatrix;
-    }
-    if(node.rotation.size() == 4)// @TODO: add support for quaternion rotations
+    LiteMath::float3 t, s;
+    LiteMath::float4 r;
+    trsFromGLTFNode(node, t, r, s);
+    nodeMatrix = matrixFromTRS(t, r, s);
+  }
+
+  return nodeMatrix;
+}
+
+void GLTFNodeTransforms::Init(const tinygltf::Model &a_model, const tinygltf::Scene &a_scene)
+{
+  *this = GLTFNodeTransforms();
+  entryOfNode.resize(a_model.nodes.size(), -1);
+
+  // breadth-first order, so that parent of each entry is already processed when its world matrix is computed
+  for(int root : a_scene.nodes)
+  {
+    node.push_back(root);
+    parent.push_back(-1);
+  }
+  for(size_t entry = 0; entry < node.size(); ++entry)
+  {
+    for(int child : a_model.nodes[node[entry]].children)
     {
-//      LiteMath::float4 rot = LiteMath::float4(node.rotation[0], node.rotation[1], node.rotation[2], node.rotation[3]);
-      //        nodeMatrix *= LiteMath::quternionRot(rot);
+      node.push_back(child);
+      parent.push_back(int(entry));
     }
-    if(node.translation.size() == 3)
+  }
+
+  const size_t entriesNum = node.size();
+  translation.resize(entriesNum);
+  rotation.resize(entriesNum);
+  scale.resize(entriesNum);
+  changed.resize(entriesNum, 0);
+  local.resize(entriesNum);
+  world.resize(entriesNum);
+  moved.resize(entriesNum, 1);
+  for(size_t entry = 0; entry < entriesNum; ++entry)
+  {
+    const tinygltf::Node &gltfNode = a_model.nodes[node[entry]];
+    entryOfNode[node[entry]] = int(entry);
+    trsFromGLTFNode(gltfNode, translation[entry], rotation[entry], scale[entry]);
+    local[entry] = transformMatrixFromGLTFNode(gltfNode);
+    world[entry] = (parent[entry] < 0) ? local[entry] : world[parent[entry]] * local[entry];
+  }
+}
+
+void GLTFNodeTransforms::Update()
+{
+  for(size_t entry = 0; entry < node.size(); ++entry)
+  {
+    moved[entry] = changed[entry] || (parent[entry] >= 0 && moved[parent[entry]]);
+    if(changed[entry])
     {
-      LiteMath::float3 t = LiteMath::float3(node.translation[0], node.translation[1], node.translation[2]);
-      nodeMatrix         = LiteMath::translate4x4(t) * nodeMatrix;
+      local[entry]   = matrixFromTRS(translation[entry], rotation[entry], scale[entry]);
+      changed[entry] = 0;
     }
+    if(moved[entry])
+      world[entry] = (parent[entry] < 0) ? local[entry] : world[parent[entry]] * local[entry];
   }
-
-  return nodeMatrix;
 }
 
 MaterialData_pbrMR materialDataFromGLTF(const tinygltf::Material &gltfMat)
@@ -63,18 +135,83 @@ MaterialData_pbrMR materialDataFromGLTF(const tinygltf::Material &gltfMat)
   return mat;
 }
 
+std::vector<GLTFMeshInstance> flattenGLTFScene(const tinygltf::Model &a_model, const GLTFNodeTransforms &a_transforms)
+{
+  std::vector<GLTFMeshInstance> res;
+  for(size_t entry = 0; entry < a_transforms.node.size(); ++entry)
+  {
+    const int mesh = a_model.nodes[a_transforms.node[entry]].mesh;
+    if(mesh > -1)
+      res.push_back({mesh, int(entry), a_transforms.world[entry]});
+  }
+  return res;
+}
+
+// pointer to the first element of accessor and distance between elements, which is byteStride of buffer view if it is set;
+// nullptr for accessors without buffer view (all elements are zero then)
+static const uint8_t* accessorData(const tinygltf::Model &a_model, const tinygltf::Accessor &a_accessor, size_t &a_stride)
+{
+  a_stride = 0;
+  if(a_accessor.bufferView < 0)
+    return nullptr;
+
+  const tinygltf::BufferView &view = a_model.bufferViews[a_accessor.bufferView];
+  const tinygltf::Buffer &buffer   = a_model.buffers[view.buffer];
+  const int elemSize = tinygltf::GetComponentSizeInBytes(a_accessor.componentType) * tinygltf::GetNumComponentsInType(a_accessor.type);
+  a_stride = view.byteStride != 0 ? view.byteStride : size_t(elemSize);
+  return buffer.data.data() + view.byteOffset + a_accessor.byteOffset;
+}
+
+// float attribute of primitive or nullptr if it is absent
+static const uint8_t* attributeData(const tinygltf::Model &a_model, const tinygltf::Primitive &a_primitive, const char* a_name,
+  size_t &a_stride, size_t &a_count)
+{
+  a_stride = 0;
+  a_count  = 0;
+  auto found = a_primitive.attributes.find(a_name);
+  if(found == a_primitive.attributes.end())
+    return nullptr;
+
+  const tinygltf::Accessor &accessor = a_model.accessors[found->second];
+  if(accessor.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT)
+  {
+    std::stringstream ss;
+    ss << "[LoadSceneGLTF]: Unsupported component type of " << a_name << " attribute, it is ignored";
+    logWarning(ss.str());
+    return nullptr;
+  }
+  a_count = accessor.count;
+  return accessorData(a_model, accessor, a_stride);
+}
+
+template<typename T>
+static void readIndices(const uint8_t* a_data, size_t a_stride, size_t a_count, uint32_t a_vertexStart, uint32_t* a_out)
+{
+  for(size_t index = 0; index < a_count; index++)
+  {
+    T value;
+    memcpy(&value, a_data + index * a_stride, sizeof(T));
+    a_out[index] = uint32_t(value) + a_vertexStart;
+  }
+}
+
 void getNumVerticesAndIndicesFromGLTFMesh(const tinygltf::Model &a_model, const tinygltf::Mesh &a_mesh, uint32_t& numVertices, uint32_t& numIndices)
 {
   auto numPrimitives   = a_mesh.primitives.size();
   for(size_t j = 0; j < numPrimitives; ++j)
   {
     const tinygltf::Primitive &glTFPrimitive = a_mesh.primitives[j];
+    uint32_t primVertices = 0;
     if(glTFPrimitive.attributes.find("POSITION") != glTFPrimitive.attributes.end())
     {
-      numVertices += a_model.accessors[glTFPrimitive.attributes.find("POSITION")->second].count;
+      primVertices = static_cast<uint32_t>(a_model.accessors[glTFPrimitive.attributes.find("POSITION")->second].count);
     }
 
-    numIndices += static_cast<uint32_t>(a_model.accessors[glTFPrimitive.indices].count);
+    numVertices += primVertices;
+    if(glTFPrimitive.indices >= 0)
+      numIndices += static_cast<uint32_t>(a_model.accessors[glTFPrimitive.indices].count);
+    else
+      numIndices += primVertices; // not indexed, vertices form triangles one after another
   }
 }
 
@@ -94,117 +231,237 @@ cmesh::SimpleMesh simpleMeshFromGLTFMesh(const tinygltf::Model &a_model, const t
   {
     const tinygltf::Primitive &glTFPrimitive = a_mesh.primitives[j];
 
-    // Vertices
+    // Vertices, accessors are read in place with their byte strides
     size_t vertexCount = 0;
     {
-      const float *positionBuffer  = nullptr;
-      const float *normalsBuffer   = nullptr;
-      const float *texCoordsBuffer = nullptr;
-      const float *tangentsBuffer  = nullptr;
+      size_t posStride = 0, normStride = 0, texStride = 0, tangStride = 0, count = 0;
+      const uint8_t *positionBuffer  = attributeData(a_model, glTFPrimitive, "POSITION",   posStride, vertexCount);
+      const uint8_t *normalsBuffer   = attributeData(a_model, glTFPrimitive, "NORMAL",     normStride, count);
+      const uint8_t *texCoordsBuffer = attributeData(a_model, glTFPrimitive, "TEXCOORD_0", texStride, count);
+      const uint8_t *tangentsBuffer  = attributeData(a_model, glTFPrimitive, "TANGENT",    tangStride, count);
 
-      if(glTFPrimitive.attributes.find("POSITION") != glTFPrimitive.attributes.end())
+      for(size_t v = 0; v < vertexCount; v++)
       {
-        const tinygltf::Accessor &accessor = a_model.accessors[glTFPrimitive.attributes.find("POSITION")->second];
-        const tinygltf::BufferView &view   = a_model.bufferViews[accessor.bufferView];
-        positionBuffer = reinterpret_cast<const float *>(&(a_model.buffers[view.buffer].data[accessor.byteOffset + view.byteOffset]));
-        vertexCount                        = accessor.count;
-      }
+        float* pos  = simpleMesh.vPos4f.data()      + (vertexStart + v) * 4;
+        float* norm = simpleMesh.vNorm4f.data()     + (vertexStart + v) * 4;
+        float* tex  = simpleMesh.vTexCoord2f.data() + (vertexStart + v) * 2;
+        float* tang = simpleMesh.vTang4f.data()     + (vertexStart + v) * 4;
 
-      if(glTFPrimitive.attributes.find("NORMAL") != glTFPrimitive.attributes.end())
-      {
-        const tinygltf::Accessor &accessor = a_model.accessors[glTFPrimitive.attributes.find("NORMAL")->second];
-        const tinygltf::BufferView &view   = a_model.bufferViews[accessor.bufferView];
-        normalsBuffer = reinterpret_cast<const float *>(&(a_model.buffers[view.buffer].data[accessor.byteOffset + view.byteOffset]));
-      }
+        pos[0] = pos[1] = pos[2] = 0.0f;
+        if(positionBuffer)
+          memcpy(pos, positionBuffer + v * posStride, 3 * sizeof(float));
+        pos[3] = 1.0f;
 
-      if(glTFPrimitive.attributes.find("TEXCOORD_0") != glTFPrimitive.attributes.end())
-      {
-        const tinygltf::Accessor &accessor = a_model.accessors[glTFPrimitive.attributes.find("TEXCOORD_0")->second];
-        const tinygltf::BufferView &view   = a_model.bufferViews[accessor.bufferView];
-        texCoordsBuffer = reinterpret_cast<const float *>(&(a_model.buffers[view.buffer].data[accessor.byteOffset + view.byteOffset]));
-      }
+        norm[0] = norm[1] = norm[2] = 0.0f;
+        if(normalsBuffer)
+          memcpy(norm, normalsBuffer + v * normStride, 3 * sizeof(float));
+        norm[3] = normalsBuffer ? 1.0f : 0.0f;
 
-      if(glTFPrimitive.attributes.find("TANGENT") != glTFPrimitive.attributes.end())
-      {
-        const tinygltf::Accessor &accessor = a_model.accessors[glTFPrimitive.attributes.find("TANGENT")->second];
-        const tinygltf::BufferView &view   = a_model.bufferViews[accessor.bufferView];
-        tangentsBuffer = reinterpret_cast<const float *>(&(a_model.buffers[view.buffer].data[accessor.byteOffset + view.byteOffset]));
-      }
+        tex[0] = tex[1] = 0.0f;
+        if(texCoordsBuffer)
+          memcpy(tex, texCoordsBuffer + v * texStride, 2 * sizeof(float));
 
-      for(size_t v = 0; v < vertexCount; v++)
-      {
-        simpleMesh.vPos4f[(vertexStart + v) * 4 + 0] = positionBuffer[v * 3 + 0];
-        simpleMesh.vPos4f[(vertexStart + v) * 4 + 1] = positionBuffer[v * 3 + 1];
-        simpleMesh.vPos4f[(vertexStart + v) * 4 + 2] = positionBuffer[v * 3 + 2];
-        simpleMesh.vPos4f[(vertexStart + v) * 4 + 3] = 1.0f;
-
-        simpleMesh.vNorm4f[(vertexStart + v) * 4 + 0] = normalsBuffer ? normalsBuffer[v * 3 + 0] : 0.0f;
-        simpleMesh.vNorm4f[(vertexStart + v) * 4 + 1] = normalsBuffer ? normalsBuffer[v * 3 + 1] : 0.0f;
-        simpleMesh.vNorm4f[(vertexStart + v) * 4 + 2] = normalsBuffer ? normalsBuffer[v * 3 + 2] : 0.0f;
-        simpleMesh.vNorm4f[(vertexStart + v) * 4 + 3] = normalsBuffer ? 1.0f : 0.0f;
-
-        simpleMesh.vTexCoord2f[(vertexStart + v) * 2 + 0] = texCoordsBuffer ? texCoordsBuffer[v * 2 + 0] : 0.0f;
-        simpleMesh.vTexCoord2f[(vertexStart + v) * 2 + 1] = texCoordsBuffer ? texCoordsBuffer[v * 2 + 1] : 0.0f;
-
-        simpleMesh.vTang4f[(vertexStart + v) * 4 + 0] = tangentsBuffer ? tangentsBuffer[v * 4 + 0] : 0.0f;
-        simpleMesh.vTang4f[(vertexStart + v) * 4 + 1] = tangentsBuffer ? tangentsBuffer[v * 4 + 1] : 0.0f;
-        simpleMesh.vTang4f[(vertexStart + v) * 4 + 2] = tangentsBuffer ? tangentsBuffer[v * 4 + 2] : 0.0f;
-        simpleMesh.vTang4f[(vertexStart + v) * 4 + 3] = tangentsBuffer ? tangentsBuffer[v * 4 + 3] : 0.0f;
+        tang[0] = tang[1] = tang[2] = tang[3] = 0.0f;
+        if(tangentsBuffer)
+          memcpy(tang, tangentsBuffer + v * tangStride, 4 * sizeof(float));
       }
     }
 
     // Indices
     {
-      const tinygltf::Accessor &accessor     = a_model.accessors[glTFPrimitive.indices];
-      const tinygltf::BufferView &bufferView = a_model.bufferViews[accessor.bufferView];
-      const tinygltf::Buffer &buffer         = a_model.buffers[bufferView.buffer];
-
-      auto indexCount = static_cast<uint32_t>(accessor.count);
-
-      std::fill(simpleMesh.matIndices.begin() + firstIndex / 3,
-            simpleMesh.matIndices.begin() + (firstIndex + indexCount) / 3, glTFPrimitive.material);
-
-      switch(accessor.componentType)
-      {
-      case TINYGLTF_PARAMETER_TYPE_UNSIGNED_INT:
-      {
-        auto *buf = new uint32_t[accessor.count];
-        memcpy(buf, &buffer.data[accessor.byteOffset + bufferView.byteOffset], accessor.count * sizeof(uint32_t));
-        for(size_t index = 0; index < accessor.count; index++)
-        {
-          simpleMesh.indices[firstIndex + index] = buf[index] + vertexStart;
-        }
-        break;
-      }
-      case TINYGLTF_PARAMETER_TYPE_UNSIGNED_SHORT:
+      uint32_t* indices = simpleMesh.indices.data() + firstIndex;
+      uint32_t indexCount = static_cast<uint32_t>(vertexCount);
+      if(glTFPrimitive.indices < 0)
       {
-        auto *buf = new uint16_t[accessor.count];
-        memcpy(buf, &buffer.data[accessor.byteOffset + bufferView.byteOffset], accessor.count * sizeof(uint16_t));
-        for(size_t index = 0; index < accessor.count; index++)
-        {
-          simpleMesh.indices[firstIndex + index] = buf[index] + vertexStart;
-        }
-        break;
+        for(uint32_t index = 0; index < indexCount; index++)
+          indices[index] = index + vertexStart;
       }
-      case TINYGLTF_PARAMETER_TYPE_UNSIGNED_BYTE:
+      else
       {
-        auto *buf = new uint8_t[accessor.count];
-        memcpy(buf, &buffer.data[accessor.byteOffset + bufferView.byteOffset], accessor.count * sizeof(uint8_t));
-        for(size_t index = 0; index < accessor.count; index++)
+        const tinygltf::Accessor &accessor = a_model.accessors[glTFPrimitive.indices];
+        indexCount = static_cast<uint32_t>(accessor.count);
+
+        size_t stride = 0;
+        const uint8_t* data = accessorData(a_model, accessor, stride);
+        if(data == nullptr)
+          std::fill(indices, indices + indexCount, vertexStart);
+        else
         {
-          simpleMesh.indices[firstIndex + index] = buf[index] + vertexStart;
+          switch(accessor.componentType)
+          {
+          case TINYGLTF_PARAMETER_TYPE_UNSIGNED_INT:
+            readIndices<uint32_t>(data, stride, accessor.count, vertexStart, indices);
+            break;
+          case TINYGLTF_PARAMETER_TYPE_UNSIGNED_SHORT:
+            readIndices<uint16_t>(data, stride, accessor.count, vertexStart, indices);
+            break;
+          case TINYGLTF_PARAMETER_TYPE_UNSIGNED_BYTE:
+            readIndices<uint8_t>(data, stride, accessor.count, vertexStart, indices);
+            break;
+          default:
+            logWarning("[LoadSceneGLTF]: Unsupported index component type");
+            return { };
+          }
         }
-        break;
-      }
-      default:
-        vk_utils::logWarning("[LoadSceneGLTF]: Unsupported index component type");
-        return { };
       }
 
+      std::fill(simpleMesh.matIndices.begin() + firstIndex / 3,
+            simpleMesh.matIndices.begin() + (firstIndex + indexCount) / 3, glTFPrimitive.material);
+
       firstIndex  += indexCount;
       vertexStart += vertexCount;
     }
   }
 
   return simpleMesh;
-}
\ No newline at end of file
+}
+
+static bool readAnimationFloats(const tinygltf::Model &a_model, int a_accessor, int a_components, std::vector<float> &a_out)
+{
+  const tinygltf::Accessor &accessor = a_model.accessors[a_accessor];
+  if(accessor.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT || tinygltf::GetNumComponentsInType(accessor.type) != a_components)
+    return false;
+
+  size_t stride = 0;
+  const uint8_t* data = accessorData(a_model, accessor, stride);
+  a_out.resize(accessor.count * a_components, 0.0f);
+  for(size_t i = 0; data != nullptr && i < accessor.count; i++)
+    memcpy(a_out.data() + i * a_components, data + i * stride, a_components * sizeof(float));
+  return true;
+}
+
+std::vector<GLTFAnimation> animationsFromGLTF(const tinygltf::Model &a_model, const GLTFNodeTransforms &a_transforms)
+{
+  std::vector<GLTFAnimation> res;
+  res.reserve(a_model.animations.size());
+  for(const tinygltf::Animation &gltfAnim : a_model.animations)
+  {
+    GLTFAnimation anim;
+    anim.name = gltfAnim.name;
+    for(const tinygltf::AnimationChannel &gltfChannel : gltfAnim.channels)
+    {
+      if(gltfChannel.target_node < 0 || gltfChannel.target_node >= int(a_transforms.entryOfNode.size()) ||
+         a_transforms.entryOfNode[gltfChannel.target_node] < 0)
+        continue;
+
+      GLTFAnimationChannel channel;
+      channel.entry = a_transforms.entryOfNode[gltfChannel.target_node];
+      if(gltfChannel.target_path == "translation")
+        channel.path = GLTFAnimationChannel::TRANSLATION;
+      else if(gltfChannel.target_path == "rotation")
+        channel.path = GLTFAnimationChannel::ROTATION;
+      else if(gltfChannel.target_path == "scale")
+        channel.path = GLTFAnimationChannel::SCALE;
+      else
+        continue;
+
+      const tinygltf::AnimationSampler &sampler = gltfAnim.samplers[gltfChannel.sampler];
+      if(sampler.interpolation == "STEP")
+        channel.interpolation = GLTFAnimationChannel::STEP;
+      else if(sampler.interpolation == "CUBICSPLINE")
+        channel.interpolation = GLTFAnimationChannel::CUBICSPLINE;
+      else
+        channel.interpolation = GLTFAnimationChannel::LINEAR;
+
+      const int components   = (channel.path == GLTFAnimationChannel::ROTATION) ? 4 : 3;
+      const size_t valuesPerKey = (channel.interpolation == GLTFAnimationChannel::CUBICSPLINE) ? 3 : 1;
+      if(!readAnimationFloats(a_model, sampler.input, 1, channel.times) || !readAnimationFloats(a_model, sampler.output, components, channel.values) ||
+         channel.times.empty() || channel.values.size() != channel.times.size() * components * valuesPerKey)
+      {
+        std::stringstream ss;
+        ss << "[LoadSceneGLTF]: Unsupported data of animation \"" << gltfAnim.name << "\" channel, it is ignored";
+        logWarning(ss.str());
+        continue;
+      }
+
+      anim.duration = std::max(anim.duration, channel.times.back());
+      anim.channels.push_back(std::move(channel));
+    }
+    res.push_back(std::move(anim));
+  }
+  return res;
+}
+
+static LiteMath::float4 slerp(LiteMath::float4 a, LiteMath::float4 b, float t)
+{
+  float cosTheta = LiteMath::dot(a, b);
+  if(cosTheta < 0.0f) // shortest path
+  {
+    b        = -1.0f * b;
+    cosTheta = -cosTheta;
+  }
+
+  if(cosTheta > 0.9995f)
+    return LiteMath::normalize(a + t * (b - a));
+
+  const float theta = std::acos(cosTheta);
+  const float sinTheta = std::sin(theta);
+  return (std::sin((1.0f - t) * theta) / sinTheta) * a + (std::sin(t * theta) / sinTheta) * b;
+}
+
+static LiteMath::float4 sampleChannel(const GLTFAnimationChannel &a_channel, float a_time)
+{
+  const int components = (a_channel.path == GLTFAnimationChannel::ROTATION) ? 4 : 3;
+  const bool cubic     = (a_channel.interpolation == GLTFAnimationChannel::CUBICSPLINE);
+  const auto& times    = a_channel.times;
+
+  // value (and tangents for CUBICSPLINE) of key
+  auto value = [&](size_t a_key, int a_which) {
+    const float* v = a_channel.values.data() + (cubic ? (a_key * 3 + a_which) : a_key) * components;
+    return LiteMath::float4(v[0], v[1], v[2], components == 4 ? v[3] : 0.0f);
+  };
+  const int VALUE = cubic ? 1 : 0;
+
+  if(a_time <= times.front() || times.size() == 1)
+    return value(0, VALUE);
+  if(a_time >= times.back())
+    return value(times.size() - 1, VALUE);
+
+  const size_t key1 = size_t(std::upper_bound(times.begin(), times.end(), a_time) - times.begin());
+  const size_t key0 = key1 - 1;
+  const float dt    = times[key1] - times[key0];
+  const float t     = (a_time - times[key0]) / dt;
+
+  if(a_channel.interpolation == GLTFAnimationChannel::STEP)
+    return value(key0, VALUE);
+
+  if(cubic)
+  {
+    const float t2 = t * t, t3 = t2 * t;
+    LiteMath::float4 res = (2.0f * t3 - 3.0f * t2 + 1.0f) * value(key0, 1) + ((t3 - 2.0f * t2 + t) * dt) * value(key0, 2) +
+                           (-2.0f * t3 + 3.0f * t2) * value(key1, 1) + ((t3 - t2) * dt) * value(key1, 0);
+    return (a_channel.path == GLTFAnimationChannel::ROTATION) ? LiteMath::normalize(res) : res;
+  }
+
+  if(a_channel.path == GLTFAnimationChannel::ROTATION)
+    return slerp(value(key0, VALUE), value(key1, VALUE), t);
+  return value(key0, VALUE) + t * (value(key1, VALUE) - value(key0, VALUE));
+}
+
+void GLTFAnimation::Apply(float a_time, GLTFNodeTransforms &a_transforms) const
+{
+  const float time = (duration > 0.0f) ? std::fmod(std::max(a_time, 0.0f), duration) : 0.0f;
+  for(const auto& channel : channels)
+  {
+    const LiteMath::float4 v = sampleChannel(channel, time);
+    switch(channel.path)
+    {
+    case GLTFAnimationChannel::TRANSLATION: a_transforms.SetTranslation(channel.entry, LiteMath::to_float3(v)); break;
+    case GLTFAnimationChannel::ROTATION:    a_transforms.SetRotation(channel.entry, v);                        break;
+    case GLTFAnimationChannel::SCALE:       a_transforms.SetScale(channel.entry, LiteMath::to_float3(v));       break;
+    }
+  }
+}
+
+std::vector<uint8_t> GLTFAnimation::AffectedEntries(const GLTFNodeTransforms &a_transforms) const
+{
+  std::vector<uint8_t> res(a_transforms.node.size(), 0);
+  for(const auto& channel : channels)
+    res[channel.entry] = 1;
+  for(size_t entry = 0; entry < res.size(); ++entry)
+  {
+    if(a_transforms.parent[entry] >= 0 && res[a_transforms.parent[entry]])
+      res[entry] = 1;
+  }
+  return res;
+}
@@ -1,6 +1,9 @@
 #ifndef CHIMERA_GLTF_UTILS_H
 #define CHIMERA_GLTF_UTILS_H
 
+#include <string>
+#include <vector>
+
 #include <LiteMath.h>
 #include "geom/cmesh.h"
 #include "tiny_gltf.h"
@@ -11,4 +14,70 @@ cmesh::SimpleMesh  simpleMeshFromGLTFMesh(const tinygltf::Model &a_model, const
 LiteMath::float4x4 transformMatrixFromGLTFNode(const tinygltf::Node &node);
 MaterialData_pbrMR materialDataFromGLTF(const tinygltf::Material &gltfMat);
 
+// translation * rotation * scale as in glTF, rotation is unit quaternion (x, y, z, w)
+LiteMath::float4x4 matrixFromTRS(const LiteMath::float3 &t, const LiteMath::float4 &r, const LiteMath::float3 &s);
+
+/**
+\brief Transforms of all nodes of a glTF scene in flat arrays where parents go before their children,
+so world matrices are computed with one linear pass without recursion and copies of tinygltf::Node.
+Translation, rotation and scale of nodes can be changed later (i.e. by animation) and world matrices re-evaluated with Update().
+*/
+struct GLTFNodeTransforms
+{
+  void Init(const tinygltf::Model &a_model, const tinygltf::Scene &a_scene);
+  void Update(); // recomputes local matrices of changed nodes and world matrices of them and their descendants, see 'moved'
+
+  void SetTranslation(int a_entry, const LiteMath::float3 &t) { translation[a_entry] = t; changed[a_entry] = 1; }
+  void SetRotation   (int a_entry, const LiteMath::float4 &r) { rotation[a_entry]    = r; changed[a_entry] = 1; }
+  void SetScale      (int a_entry, const LiteMath::float3 &s) { scale[a_entry]       = s; changed[a_entry] = 1; }
+
+  std::vector<int>                node;         // glTF node of each entry
+  std::vector<int>                parent;       // entry of parent node, -1 for root nodes
+  std::vector<int>                entryOfNode;  // entry of each glTF node, -1 for nodes not in the scene
+  std::vector<LiteMath::float3>   translation;
+  std::vector<LiteMath::float4>   rotation;
+  std::vector<LiteMath::float3>   scale;
+  std::vector<uint8_t>            changed;
+  std::vector<LiteMath::float4x4> local;
+  std::vector<LiteMath::float4x4> world;
+  std::vector<uint8_t>            moved;        // world matrix was changed by the last Update()
+};
+
+struct GLTFMeshInstance
+{
+  int                mesh;   // index in tinygltf::Model::meshes
+  int                entry;  // node entry in GLTFNodeTransforms
+  LiteMath::float4x4 matrix; // world matrix of the node
+};
+
+// nodes of the scene which have meshes, with world matrices; parents go before their children
+std::vector<GLTFMeshInstance> flattenGLTFScene(const tinygltf::Model &a_model, const GLTFNodeTransforms &a_transforms);
+/**
+\brief Keyframes of translation, rotation or scale of one node entry of GLTFNodeTransforms
+*/
+struct GLTFAnimationChannel
+{
+  enum PATH          { TRANSLATION = 0, ROTATION = 1, SCALE = 2 };
+  enum INTERPOLATION { LINEAR = 0, STEP = 1, CUBICSPLINE = 2 };
+
+  int                entry;
+  PATH               path;
+  INTERPOLATION      interpolation;
+  std::vector<float> times;
+  std::vector<float> values; // 3 or 4 floats per key; in-tangent, value and out-tangent per key for CUBICSPLINE
+};
+
+struct GLTFAnimation
+{
+  std::string                       name;
+  float                             duration = 0.0f;
+  std::vector<GLTFAnimationChannel> channels;
+
+  void Apply(float a_time, GLTFNodeTransforms &a_transforms) const; // a_time in seconds is wrapped to [0, duration); call a_transforms.Update() after it
+  std::vector<uint8_t> AffectedEntries(const GLTFNodeTransforms &a_transforms) const; // animated entries and their descendants
+};
+
+// animations of nodes which are in a_transforms; morph target weights are not supported and skipped
+std::vector<GLTFAnimation> animationsFromGLTF(const tinygltf::Model &a_model, const GLTFNodeTransforms &a_transforms);
+
 #endif// CHIMERA_GLTF_UTILS_H
@@ -1,8 +1,15 @@
 #include "hydraxml.h"
 
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <cwchar>
 #include <iostream>
+#include <limits>
 #include <sstream>
 #include <fstream>
+#include <string_view>
 #include <locale>
 #include <codecvt>
 
@@ -13,6 +20,8 @@
 
 namespace hydra_xml
 {
+  static constexpr size_t STREAM_CHUNK_SIZE = 1 << 20; // file is read by chunks of this size when instances are streamed
+
   std::wstring s2ws(const std::string& str)
   {
     using convert_typeX = std::codecvt_utf8<wchar_t>;
@@ -27,6 +36,149 @@ namespace hydra_xml
     return converterX.to_bytes(wstr);
   }
 
+  // exactly representable powers of 10, so that mantissa * 10^exp is rounded only once for short decimal numbers
+  static const double POW10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+  template<typename CharT> static inline bool isSpace(CharT c) { return c == CharT(' ') || c == CharT('\t') || c == CharT('\n') || c == CharT('\r') || c == CharT('\f') || c == CharT('\v'); }
+  template<typename CharT> static inline bool isDigit(CharT c) { return c >= CharT('0') && c <= CharT('9'); }
+
+  // a_word is lower case ASCII
+  template<typename CharT>
+  static inline bool startsWithNoCase(const CharT* a_str, const char* a_word)
+  {
+    for(; *a_word != 0; ++a_str, ++a_word)
+      if(*a_str != CharT(*a_word) && *a_str != CharT(*a_word - 'a' + 'A'))
+        return false;
+    return true;
+  }
+
+  template<typename CharT>
+  static const CharT* parseFloatT(const CharT* a_str, float& a_val)
+  {
+    const CharT* p = a_str;
+    while(isSpace(*p))
+      ++p;
+
+    const bool negative = (*p == CharT('-'));
+    if(*p == CharT('-') || *p == CharT('+'))
+      ++p;
+
+    // as strtof does, "inf", "infinity" and "nan" are accepted in any case
+    if(startsWithNoCase(p, "inf"))
+    {
+      a_val = negative ? -std::numeric_limits<float>::infinity() : std::numeric_limits<float>::infinity();
+      return startsWithNoCase(p, "infinity") ? p + 8 : p + 3;
+    }
+    if(startsWithNoCase(p, "nan"))
+    {
+      a_val = negative ? -std::numeric_limits<float>::quiet_NaN() : std::numeric_limits<float>::quiet_NaN();
+      return p + 3;
+    }
+
+    uint64_t mantissa  = 0;
+    int      exponent  = 0;
+    int      digitsNum = 0;
+    int      mantDigits = 0; // significant digits accumulated in mantissa, uint64_t holds 19 of them
+    for(; isDigit(*p); ++p, ++digitsNum)
+    {
+      if(mantDigits < 19)
+      {
+        mantissa = mantissa * 10 + uint64_t(*p - CharT('0'));
+        mantDigits += (mantissa != 0) ? 1 : 0;
+      }
+      else
+        exponent++;
+    }
+    if(*p == CharT('.'))
+    {
+      for(++p; isDigit(*p); ++p, ++digitsNum)
+      {
+        if(mantDigits < 19)
+        {
+          mantissa = mantissa * 10 + uint64_t(*p - CharT('0'));
+          mantDigits += (mantissa != 0) ? 1 : 0;
+          exponent--;
+        }
+      }
+    }
+    if(digitsNum == 0)
+      return nullptr;
+
+    if(*p == CharT('e') || *p == CharT('E'))
+    {
+      const CharT* e = p + 1;
+      const bool negExp = (*e == CharT('-'));
+      if(*e == CharT('-') || *e == CharT('+'))
+        ++e;
+      if(isDigit(*e))
+      {
+        int expValue = 0;
+        for(; isDigit(*e); ++e)
+          expValue = (expValue < 10000) ? expValue * 10 + int(*e - CharT('0')) : expValue;
+        exponent += negExp ? -expValue : expValue;
+        p = e;
+      }
+    }
+
+    double value = double(mantissa);
+    if(mantissa != 0 && exponent != 0)
+    {
+      if(exponent > 0 && exponent <= 22)
+        value *= POW10[exponent];
+      else if(exponent < 0 && exponent >= -22)
+        value /= POW10[-exponent];
+      else
+        value *= std::pow(10.0, double(exponent));
+    }
+
+    a_val = float(negative ? -value : value);
+    return p;
+  }
+
+  template<typename CharT>
+  static int readFloatsT(const CharT* a_str, float* a_out, int a_count)
+  {
+    int parsed = 0;
+    const CharT* p = a_str;
+    for(; p != nullptr && parsed < a_count; ++parsed)
+    {
+      p = parseFloatT(p, a_out[parsed]);
+      if(p == nullptr)
+        break;
+    }
+    for(int i = parsed; i < a_count; ++i)
+      a_out[i] = 0.0f;
+    return parsed;
+  }
+
+  const wchar_t* parseFloat(const wchar_t* a_str, float& a_val)    { return parseFloatT(a_str, a_val); }
+  const char*    parseFloat(const char* a_str, float& a_val)       { return parseFloatT(a_str, a_val); }
+  int readFloats(const wchar_t* a_str, float* a_out, int a_count) { return readFloatsT(a_str, a_out, a_count); }
+  int readFloats(const char* a_str, float* a_out, int a_count)    { return readFloatsT(a_str, a_out, a_count); }
+
+  LiteMath::float4x4 float4x4FromFloats(const float data[16])
+  {
+    LiteMath::float4x4 result;
+    result.set_row(0, LiteMath::float4(data[0],data[1], data[2], data[3]));
+    result.set_row(1, LiteMath::float4(data[4],data[5], data[6], data[7]));
+    result.set_row(2, LiteMath::float4(data[8],data[9], data[10], data[11]));
+    result.set_row(3, LiteMath::float4(data[12],data[13], data[14], data[15])); 
+    return result;
+  }
+
+  LiteMath::float4x4 float4x4FromString(const wchar_t* matrix_str)
+  {
+    float data[16];
+    readFloats(matrix_str != nullptr ? matrix_str : L"", data, 16);
+    return float4x4FromFloats(data);
+  }
+
+  LiteMath::float4x4 float4x4FromString(const std::wstring &matrix_str)
+  {
+    return float4x4FromString(matrix_str.c_str());
+  }
+
   void HydraScene::LogError(const std::string &msg)
   {
     std::cout << "HydraScene ERROR: " << msg << std::endl;
@@ -87,9 +239,69 @@ namespace hydra_xml
     return 0;
   }
 #else
-  int HydraScene::LoadState(const std::string &path)
+  // byte offset of "<scenes" tag; Hydra XML places all libraries before it
+  static bool findScenesOffset(const std::string& a_path, size_t& a_offset)
+  {
+    std::ifstream file(a_path, std::ios::binary);
+    if(!file.is_open())
+      return false;
+
+    const std::string tag = "<scenes";
+    std::vector<char> buf(STREAM_CHUNK_SIZE);
+    size_t bufOffset = 0; // file offset of buf[0]
+    size_t kept      = 0; // tail of the previous chunk, the tag may cross chunks
+    while(true)
+    {
+      file.read(buf.data() + kept, std::streamsize(buf.size() - kept));
+      const size_t size = kept + size_t(file.gcount());
+      if(size == kept)
+        return false;
+
+      const char* begin = buf.data();
+      const char* end   = begin + size;
+      for(auto it = std::search(begin, end, tag.begin(), tag.end()); it + tag.size() < end; it = std::search(it + 1, end, tag.begin(), tag.end()))
+      {
+        const char next = it[tag.size()];
+        if(next == '>' || next == '/' || isSpace(next))
+        {
+          a_offset = bufOffset + size_t(it - begin);
+          return true;
+        }
+      }
+
+      kept = std::min(size, tag.size());
+      memmove(buf.data(), end - kept, kept);
+      bufOffset += size - kept;
+    }
+  }
+
+  int HydraScene::LoadState(const std::string &path, bool a_streamInstances)
   {
-    auto loaded = m_xmlDoc.load_file(path.c_str());
+    m_streamInstances = false;
+    m_instancesOffset = 0;
+    m_statePath       = path;
+
+    pugi::xml_parse_result loaded;
+    if(a_streamInstances && findScenesOffset(path, m_instancesOffset))
+    {
+      // only libraries go to DOM, instances are read by ForEachInstance
+      std::vector<char> libraries(m_instancesOffset);
+      std::ifstream file(path, std::ios::binary);
+      file.read(libraries.data(), std::streamsize(libraries.size()));
+      loaded = m_xmlDoc.load_buffer(libraries.data(), libraries.size());
+      if(loaded)
+      {
+        m_xmlDoc.append_child(L"scenes");
+        m_streamInstances = true;
+      }
+    }
+
+    // found "<scenes" may be inside comment or CDATA, then libraries are cut in the middle and the whole file is loaded
+    if(!m_streamInstances)
+    {
+      m_instancesOffset = 0;
+      loaded = m_xmlDoc.load_file(path.c_str());
+    }
 
     if(!loaded)
     {
@@ -116,85 +328,196 @@ namespace hydra_xml
 
     if (m_texturesLib == nullptr || m_materialsLib == nullptr || m_lightsLib == nullptr || m_cameraLib == nullptr || m_geometryLib == nullptr || m_settingsNode == nullptr || m_sceneNode == nullptr)
     {
+      if(m_streamInstances) // some library follows scenes, load the whole file
+      {
+        m_xmlDoc.reset();
+        return LoadState(path, false);
+      }
       std::string errMsg = "Loaded state (" +  path + ") doesn't have one of (textures_lib, materials_lib, lights_lib, cam_lib, geometry_lib, render_lib, scenes";
       LogError(errMsg);
       return -1;
     }
 
-    parseInstancedMeshes(m_sceneNode, m_geometryLib);
+    if(!m_streamInstances)
+      parseInstancedMeshes(m_sceneNode, m_geometryLib);
 
     return 0;
   }
-#endif
 
-  void HydraScene::parseInstancedMeshes(pugi::xml_node a_scenelib, pugi::xml_node a_geomlib)
+  // value of attribute a_name in start tag text; entities are not expected in instance attributes
+  static bool tagAttribute(std::string_view a_tag, std::string_view a_name, std::string_view& a_value)
   {
-    auto scene = a_scenelib.first_child();
-    for (pugi::xml_node inst = scene.first_child(); inst != nullptr; inst = inst.next_sibling())
+    for(size_t pos = a_tag.find(a_name); pos != std::string_view::npos; pos = a_tag.find(a_name, pos + a_name.size()))
     {
-      if (std::wstring(inst.name()) == L"instance_light")
-        break;
-
-      auto mesh_id = inst.attribute(L"mesh_id").as_string();
-      auto matrix = std::wstring(inst.attribute(L"matrix").as_string());
+      size_t p = pos + a_name.size();
+      while(p < a_tag.size() && isSpace(a_tag[p]))
+        ++p;
+      if(pos == 0 || !isSpace(a_tag[pos - 1]) || p >= a_tag.size() || a_tag[p] != '=')
+        continue;
+      ++p;
+      while(p < a_tag.size() && isSpace(a_tag[p]))
+        ++p;
+      if(p >= a_tag.size() || (a_tag[p] != '"' && a_tag[p] != '\''))
+        return false;
+      const size_t end = a_tag.find(a_tag[p], p + 1);
+      if(end == std::string_view::npos)
+        return false;
+      a_value = a_tag.substr(p + 1, end - p - 1);
+      return true;
+    }
+    return false;
+  }
 
-      auto meshNode = a_geomlib.find_child_by_attribute(L"id", mesh_id);
+  static uint32_t tagAttributeUInt(std::string_view a_tag, std::string_view a_name, uint32_t a_default)
+  {
+    std::string_view value;
+    uint32_t res = a_default;
+    if(tagAttribute(a_tag, a_name, value))
+    {
+      if(!value.empty() && value[0] == '-') // the same as pugi::xml_attribute::as_uint()
+        return 0;
+      std::from_chars(value.data(), value.data() + value.size(), res);
+    }
+    return res;
+  }
 
-      if(meshNode != nullptr)
+  uint32_t HydraScene::streamInstances(const std::function<void(const Instance&)>& a_func) const
+  {
+    std::ifstream file(m_statePath, std::ios::binary);
+    if(!file.is_open())
+      return 0;
+    file.seekg(std::streamoff(m_instancesOffset));
+
+    std::string buf;
+    size_t pos = 0;
+    auto readMore = [&]() {
+      buf.erase(0, pos);
+      pos = 0;
+      const size_t oldSize = buf.size();
+      buf.resize(oldSize + STREAM_CHUNK_SIZE);
+      file.read(&buf[oldSize], std::streamsize(STREAM_CHUNK_SIZE));
+      buf.resize(oldSize + size_t(file.gcount()));
+      return file.gcount() > 0;
+    };
+
+    uint32_t instNum = 0;
+    bool inScene = false;
+    while(true)
+    {
+      const size_t tagBegin = buf.find('<', pos);
+      if(tagBegin == std::string::npos)
       {
-        auto meshLoc = ws2s(std::wstring(meshNode.attribute(L"loc").as_string()));
-        meshLoc = m_libraryRootDir + "/" + meshLoc;
+        pos = buf.size();
+        if(!readMore()) break;
+        continue;
+      }
 
-#if not defined(__ANDROID__)
-        std::ifstream checkMesh(meshLoc);
-        if(!checkMesh.good())
-        {
-          LogError("Mesh not found at: " + meshLoc + ". Loader will skip it.");
-          continue;
-        }
-        else
-        {
-          checkMesh.close();
-        }
-#endif
+      const bool comment = buf.compare(tagBegin, 4, "<!--") == 0;
+      const size_t tagEnd = comment ? buf.find("-->", tagBegin + 4) : buf.find('>', tagBegin);
+      if(tagEnd == std::string::npos)
+      {
+        pos = tagBegin;
+        if(!readMore()) break;
+        continue;
+      }
+      pos = tagEnd + 1;
+      if(comment)
+        continue;
 
-        if(unique_meshes.find(meshLoc) == unique_meshes.end())
-        {
-          unique_meshes.emplace(meshLoc);
-          //m_meshloc.push_back(meshLoc);
-        }
+      std::string_view tag(buf.data() + tagBegin + 1, tagEnd - tagBegin - 1);
+      std::string_view name = tag.substr(0, std::min(tag.size(), tag.find_first_of(" \t\r\n/")));
+      if(name == "scene")
+        inScene = true;
+      else if((name.empty() && tag.substr(0, 6) == "/scene") || (inScene && name == "instance_light"))
+        break;
+      else if(inScene && name == "instance")
+      {
+        Instance inst;
+        inst.geomId = tagAttributeUInt(tag, "mesh_id", inst.geomId);
+        inst.rmapId = tagAttributeUInt(tag, "rmap_id", inst.rmapId);
 
+        float data[16];
+        std::string_view matrix;
+        readFloats(tagAttribute(tag, "matrix", matrix) ? matrix.data() : "", data, 16); // the value is followed by quote, which stops parsing
+        inst.matrix = float4x4FromFloats(data);
 
-        if(m_instancesPerMeshLoc.find(meshLoc) != m_instancesPerMeshLoc.end())
-        {
-          m_instancesPerMeshLoc[meshLoc].push_back(float4x4FromString(matrix));
-        }
-        else
-        {
-          std::vector<LiteMath::float4x4> tmp = { float4x4FromString(matrix) };
-          m_instancesPerMeshLoc[meshLoc] = tmp;
-        }
+        a_func(inst);
+        instNum++;
       }
     }
+    return instNum;
+  }
+#endif
 
+  uint32_t HydraScene::ForEachInstance(const std::function<void(const Instance&)>& a_func)
+  {
+#if not defined(__ANDROID__)
+    if(m_streamInstances)
+      return streamInstances(a_func);
+#endif
+    uint32_t instNum = 0;
+    for(auto node = m_sceneNode.first_child().first_child(); node != nullptr; node = node.next_sibling())
+    {
+      if(wcscmp(node.name(), L"instance_light") == 0)
+        break;
+      if(wcscmp(node.name(), L"instance") != 0)
+        continue;
 
+      Instance inst;
+      inst.geomId = node.attribute(L"mesh_id").as_uint();
+      inst.rmapId = node.attribute(L"rmap_id").as_uint();
+      inst.matrix = float4x4FromString(node.attribute(L"matrix").as_string());
+      a_func(inst);
+      instNum++;
+    }
+    return instNum;
   }
 
-  LiteMath::float4x4 float4x4FromString(const std::wstring &matrix_str)
+  void HydraScene::parseInstancedMeshes(pugi::xml_node a_scenelib, pugi::xml_node a_geomlib)
   {
-    LiteMath::float4x4 result;
-    std::wstringstream inputStream(matrix_str);
-    
-    float data[16];
-    for(int i = 0; i < 16; i++)
-      inputStream >> data[i];
-    
-    result.set_row(0, LiteMath::float4(data[0],data[1], data[2], data[3]));
-    result.set_row(1, LiteMath::float4(data[4],data[5], data[6], data[7]));
-    result.set_row(2, LiteMath::float4(data[8],data[9], data[10], data[11]));
-    result.set_row(3, LiteMath::float4(data[12],data[13], data[14], data[15])); 
+    // mesh id -> location, built once instead of searching geometry library for each instance
+    struct MeshLoc
+    {
+      std::string loc;
+      bool checked = false;
+      bool exists  = false;
+    };
+    std::unordered_map<std::wstring, MeshLoc> meshLocById;
+    for(auto meshNode : a_geomlib.children())
+    {
+      MeshLoc meshLoc;
+      meshLoc.loc = m_libraryRootDir + "/" + ws2s(std::wstring(meshNode.attribute(L"loc").as_string()));
+      meshLocById.emplace(meshNode.attribute(L"id").as_string(), std::move(meshLoc)); // the first one wins, like find_child_by_attribute
+    }
 
-    return result;
+    auto scene = a_scenelib.first_child();
+    for (pugi::xml_node inst = scene.first_child(); inst != nullptr; inst = inst.next_sibling())
+    {
+      if (wcscmp(inst.name(), L"instance_light") == 0)
+        break;
+
+      auto found = meshLocById.find(inst.attribute(L"mesh_id").as_string());
+      if(found == meshLocById.end())
+        continue;
+
+      MeshLoc& meshLoc = found->second;
+      if(!meshLoc.checked)
+      {
+        meshLoc.checked = true;
+        meshLoc.exists  = true;
+#if not defined(__ANDROID__)
+        std::ifstream checkMesh(meshLoc.loc);
+        meshLoc.exists = checkMesh.good();
+        if(!meshLoc.exists)
+          LogError("Mesh not found at: " + meshLoc.loc + ". Loader will skip it.");
+#endif
+        if(meshLoc.exists)
+          unique_meshes.emplace(meshLoc.loc);
+      }
+
+      if(meshLoc.exists)
+        m_instancesPerMeshLoc[meshLoc.loc].push_back(float4x4FromString(inst.attribute(L"matrix").as_string()));
+    }
   }
 
   LiteMath::float3 read3f(pugi::xml_attribute a_attr)
@@ -203,8 +526,9 @@ namespace hydra_xml
     const wchar_t* camPosStr = a_attr.as_string();
     if (camPosStr != nullptr)
     {
-      std::wstringstream inputStream(camPosStr);
-      inputStream >> res.x >> res.y >> res.z;
+      float data[3];
+      readFloats(camPosStr, data, 3);
+      res = LiteMath::float3(data);
     }
     return res;
   }
@@ -215,8 +539,9 @@ namespace hydra_xml
     const wchar_t* camPosStr = a_node.text().as_string();
     if (camPosStr != nullptr)
     {
-      std::wstringstream inputStream(camPosStr);
-      inputStream >> res.x >> res.y >> res.z;
+      float data[3];
+      readFloats(camPosStr, data, 3);
+      res = LiteMath::float3(data);
     }
     return res;
   }
@@ -5,6 +5,8 @@
 #include "LiteMath.h"
 using namespace LiteMath;
 
+#include <cwchar>
+#include <functional>
 #include <vector>
 #include <set>
 #include <unordered_map>
@@ -19,6 +21,17 @@ namespace hydra_xml
 {
   std::wstring s2ws(const std::string& str);
   std::string  ws2s(const std::wstring& wstr);
+
+  /// locale independent and allocation free, like std::from_chars: skips leading white space, parses decimal float
+  /// ("-1.5", "2e-3", "7.", "inf", "nan") and returns pointer past it or nullptr if there is no number
+  const wchar_t* parseFloat(const wchar_t* a_str, float& a_val);
+  const char*    parseFloat(const char* a_str, float& a_val);
+  /// parses a_count white space separated floats; missing or invalid values are set to 0; returns the number of parsed values
+  int readFloats(const wchar_t* a_str, float* a_out, int a_count);
+  int readFloats(const char* a_str, float* a_out, int a_count);
+
+  LiteMath::float4x4 float4x4FromFloats(const float data[16]); ///< row-major, as Hydra writes matrices
+  LiteMath::float4x4 float4x4FromString(const wchar_t* matrix_str);
   LiteMath::float4x4 float4x4FromString(const std::wstring &matrix_str);
   LiteMath::float3   read3f(pugi::xml_attribute a_attr);
   LiteMath::float3   read3f(pugi::xml_node a_node);
@@ -148,11 +161,11 @@ namespace hydra_xml
       return inst;
     }
   
-		const InstIterator& operator++() { do ++m_iter; while(m_iter != m_end && std::wstring(m_iter->name()) != L"instance"); return *this; }
-		InstIterator operator++(int)     { do m_iter++; while(m_iter != m_end && std::wstring(m_iter->name()) != L"instance"); return *this; }
+		const InstIterator& operator++() { do ++m_iter; while(m_iter != m_end && wcscmp(m_iter->name(), L"instance") != 0); return *this; }
+		InstIterator operator++(int)     { do m_iter++; while(m_iter != m_end && wcscmp(m_iter->name(), L"instance") != 0); return *this; }
   
-		const InstIterator& operator--() { do --m_iter; while(m_iter != m_end && std::wstring(m_iter->name()) != L"instance"); return *this; }
-		InstIterator operator--(int)     { do m_iter--; while(m_iter != m_end && std::wstring(m_iter->name()) != L"instance"); return *this; }
+		const InstIterator& operator--() { do --m_iter; while(m_iter != m_end && wcscmp(m_iter->name(), L"instance") != 0); return *this; }
+		InstIterator operator--(int)     { do m_iter--; while(m_iter != m_end && wcscmp(m_iter->name(), L"instance") != 0); return *this; }
   
   private:
     pugi::xml_node_iterator m_iter;
@@ -320,9 +333,15 @@ namespace hydra_xml
     #if defined(__ANDROID__)
     int LoadState(AAssetManager* mgr, const std::string &path);
     #else
-    int LoadState(const std::string &path);
+    /// if a_streamInstances is set, only libraries are loaded to DOM and instances of the scene are read from the file by ForEachInstance(),
+    /// so memory and load time do not depend on instances number; InstancesGeom(), InstancesLights() and GetAllInstancesOfMeshLoc() are empty then
+    int LoadState(const std::string &path, bool a_streamInstances = false);
     #endif  
 
+    /// calls a_func for each geometry instance of the first scene in file order and returns their number; works in both load modes.
+    /// Like GetAllInstancesOfMeshLoc(), only instances before the first light instance are taken
+    uint32_t ForEachInstance(const std::function<void(const Instance&)>& a_func);
+
     //// use this functions with C++11 range for 
     //
     pugi::xml_object_range<pugi::xml_node_iterator> TextureNodes()  { return m_texturesLib.children();  } 
@@ -361,6 +380,7 @@ namespace hydra_xml
     
   private:
     void parseInstancedMeshes(pugi::xml_node a_scenelib, pugi::xml_node a_geomlib);
+    uint32_t streamInstances(const std::function<void(const Instance&)>& a_func) const;
     void LogError(const std::string &msg);  
     
     std::set<std::string> unique_meshes;
@@ -375,6 +395,10 @@ namespace hydra_xml
     pugi::xml_document m_xmlDoc;
 
     std::unordered_map<std::string, std::vector<LiteMath::float4x4> > m_instancesPerMeshLoc;
+
+    std::string m_statePath;
+    size_t      m_instancesOffset = 0;     ///< offset of "<scenes" in file if instances are streamed
+    bool        m_streamInstances = false;
   };
 
   
@@ -1,7 +1,9 @@
 #include "image_loader.h"
 #include <string>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <limits>
 #include <vector>
 
 #define STB_IMAGE_IMPLEMENTATION
@@ -57,7 +59,7 @@ ImageFileInfo getImageInfo(const std::string& a_filename)
     else
       res.bytesPerChannel = sizeof(float);
 
-    if(res.width >= 0 && res.height >= 0)
+    if(res.width > 0 && res.height > 0)
       res.is_ok = true;
   }
   else if (tex_format == IMG_COMMON_LDR)
@@ -82,18 +84,36 @@ ImageFileInfo getImageInfo(const std::string& a_filename)
   return res;
 }
 
+// width and height from the header of .image4ub/.image4f file; zero, negative or corrupted sizes, which don't fit in the file, are rejected
+static bool readImage4Size(std::ifstream& a_file, uint64_t a_bytesPerPixel, size_t& a_pixelsNum)
+{
+  int32_t w = 0, h = 0;
+  a_file.read((char*)&w, sizeof(int32_t));
+  a_file.read((char*)&h, sizeof(int32_t));
+  if(!a_file.good() || w <= 0 || h <= 0)
+    return false;
+
+  const auto dataStart = a_file.tellg();
+  a_file.seekg(0, std::ios::end);
+  const uint64_t dataSize = uint64_t(a_file.tellg() - dataStart);
+  a_file.seekg(dataStart);
+
+  const uint64_t pixelsNum = uint64_t(w) * uint64_t(h); // less than 2^62, but multiplied by pixel size it could wrap around
+  if(pixelsNum > dataSize / a_bytesPerPixel || pixelsNum > std::numeric_limits<size_t>::max() / a_bytesPerPixel)
+    return false;
+  a_pixelsNum = size_t(pixelsNum);
+  return true;
+}
+
 std::vector<unsigned char> loadImage4ub(const std::string &filename)
 {
   std::ifstream infile(filename, std::ios::binary);
   std::vector<unsigned char> result;
-  if (infile.good())
+  size_t pixelsNum = 0;
+  if (infile.good() && readImage4Size(infile, 4, pixelsNum))
   {
-    int32_t w, h;
-    infile.read((char*)&w, sizeof(int));
-    infile.read((char*)&h, sizeof(int));
-
-    result.resize(w * h * 4);
-    infile.read((char*)result.data(), w * h * 4);
+    result.resize(pixelsNum * 4);
+    infile.read((char*)result.data(), std::streamsize(result.size()));
   }
   return result;
 }
@@ -114,6 +134,8 @@ std::vector<unsigned char> loadImageLDR(const ImageFileInfo& info)
       req_channels = info.channels;
 
     unsigned char *pixels = stbi_load(info.path.c_str(), &w, &h, &channels, req_channels);
+    if(pixels == nullptr)
+      return {};
 
     std::vector<unsigned char> result(w * h * req_channels);
     memcpy(result.data(), pixels, result.size());
@@ -124,8 +146,25 @@ std::vector<unsigned char> loadImageLDR(const ImageFileInfo& info)
   }
 }
 
+std::vector<float> loadImage4f(const std::string &filename)
+{
+  std::ifstream infile(filename, std::ios::binary);
+  std::vector<float> result;
+  size_t pixelsNum = 0;
+  if (infile.good() && readImage4Size(infile, 4 * sizeof(float), pixelsNum))
+  {
+    result.resize(pixelsNum * 4);
+    infile.read((char*)result.data(), std::streamsize(result.size() * sizeof(float)));
+  }
+  return result;
+}
+
 std::vector<float> loadImageHDR(const ImageFileInfo& info)
 {
+  auto tex_format = guessFormatFromExtension(info.path);
+  if (tex_format == IMG_IMAGE4F)
+    return loadImage4f(info.path);
+
   int w, h, channels, req_channels;
   if(info.channels == 3)
     req_channels = 4;
@@ -133,9 +172,11 @@ std::vector<float> loadImageHDR(const ImageFileInfo& info)
     req_channels = info.channels;
 
   float* pixels = stbi_loadf(info.path.c_str(), &w, &h, &channels, req_channels);
+  if(pixels == nullptr)
+    return {};
 
   std::vector<float> result(w * h * req_channels);
-  memcpy(result.data(), pixels, result.size());
+  memcpy(result.data(), pixels, result.size() * sizeof(float));
 
   stbi_image_free(pixels);
 
@@ -0,0 +1,194 @@
+#include "scene_cache.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+
+static const char     SCENE_CACHE_MAGIC[8]  = {'C', 'H', 'S', 'C', 'E', 'N', 'E', '\0'};
+static const uint32_t SCENE_CACHE_VERSION   = 2; // 2: animated scenes are not cached, caches of version 1 may lack their animations
+static const size_t   SCENE_CACHE_ALIGNMENT = 64; // sections are aligned for direct use of mapped data
+
+struct SceneCacheSection
+{
+  uint64_t offset;
+  uint64_t count;
+  uint64_t elemSize;
+};
+
+struct SceneCacheHeader
+{
+  char              magic[8];
+  uint32_t          version;
+  uint32_t          loadFlags;
+  int64_t           sourceTime;
+  uint64_t          sourceSize;
+  SceneCacheSection sections[SCENE_CACHE_SECTIONS_NUM];
+};
+
+static size_t alignSize(size_t a_size) { return (a_size + SCENE_CACHE_ALIGNMENT - 1) / SCENE_CACHE_ALIGNMENT * SCENE_CACHE_ALIGNMENT; }
+
+bool SceneCacheKey::FromFile(const std::string& a_path, uint32_t a_loadFlags, SceneCacheKey& a_key)
+{
+  std::error_code err;
+  auto absPath = std::filesystem::absolute(a_path, err);
+  auto time    = std::filesystem::last_write_time(absPath, err);
+  if(err)
+    return false;
+  auto size = std::filesystem::file_size(absPath, err);
+  if(err)
+    return false;
+
+  a_key.sourcePath = absPath.lexically_normal().string();
+  a_key.sourceTime = int64_t(time.time_since_epoch().count());
+  a_key.sourceSize = uint64_t(size);
+  a_key.loadFlags  = a_loadFlags;
+  return true;
+}
+
+std::string SceneCacheKey::CachePath(const std::string& a_cacheDir, const char* a_extension) const
+{
+  std::stringstream ss;
+  ss << std::filesystem::path(sourcePath).stem().string() << "_" << std::hex << std::hash<std::string>()(sourcePath) << a_extension;
+  return (std::filesystem::path(a_cacheDir) / ss.str()).string();
+}
+
+void SceneCacheWriter::Add(SCENE_CACHE_SECTION a_section, const void* a_data, size_t a_count, size_t a_elemSize)
+{
+  m_sections[a_section].data     = a_data;
+  m_sections[a_section].count    = a_count;
+  m_sections[a_section].elemSize = a_elemSize;
+}
+
+bool SceneCacheWriter::Write(const std::string& a_path, const SceneCacheKey& a_key) const
+{
+  SceneCacheHeader header = {};
+  memcpy(header.magic, SCENE_CACHE_MAGIC, sizeof(header.magic));
+  header.version    = SCENE_CACHE_VERSION;
+  header.loadFlags  = a_key.loadFlags;
+  header.sourceTime = a_key.sourceTime;
+  header.sourceSize = a_key.sourceSize;
+
+  Section sections[SCENE_CACHE_SECTIONS_NUM];
+  std::copy(m_sections, m_sections + SCENE_CACHE_SECTIONS_NUM, sections);
+  sections[SCENE_CACHE_SOURCE_PATH] = {a_key.sourcePath.c_str(), a_key.sourcePath.size(), sizeof(char)};
+
+  size_t offset = alignSize(sizeof(SceneCacheHeader));
+  for(uint32_t i = 0; i < SCENE_CACHE_SECTIONS_NUM; ++i)
+  {
+    header.sections[i].offset   = offset;
+    header.sections[i].count    = sections[i].count;
+    header.sections[i].elemSize = sections[i].elemSize;
+    offset += alignSize(sections[i].count * sections[i].elemSize);
+  }
+
+  std::error_code err;
+  std::filesystem::create_directories(std::filesystem::path(a_path).parent_path(), err);
+
+  const std::string tmpPath = a_path + ".tmp";
+  {
+    std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+    if(!file.is_open())
+    {
+      std::cout << "SceneCacheWriter: can't open " << tmpPath << " for writing" << std::endl;
+      return false;
+    }
+
+    const char padding[SCENE_CACHE_ALIGNMENT] = {};
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(padding, alignSize(sizeof(header)) - sizeof(header));
+    for(const auto& section : sections)
+    {
+      const size_t bytes = section.count * section.elemSize;
+      if(bytes > 0)
+        file.write(reinterpret_cast<const char*>(section.data), bytes);
+      file.write(padding, alignSize(bytes) - bytes);
+    }
+
+    if(!file.good())
+    {
+      std::cout << "SceneCacheWriter: failed to write " << tmpPath << std::endl;
+      file.close();
+      std::filesystem::remove(tmpPath, err);
+      return false;
+    }
+  }
+
+  std::filesystem::rename(tmpPath, a_path, err);
+  if(err)
+  {
+    std::cout << "SceneCacheWriter: can't rename " << tmpPath << " to " << a_path << ": " << err.message() << std::endl;
+    std::filesystem::remove(tmpPath, err);
+    return false;
+  }
+  return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool SceneCacheReader::Open(const std::string& a_path, const SceneCacheKey& a_key)
+{
+  m_file.Close();
+  if(!std::filesystem::exists(a_path) || !m_file.Open(a_path))
+    return false;
+
+  const auto* header = m_file.At<SceneCacheHeader>(0);
+  bool valid = m_file.Size() >= sizeof(SceneCacheHeader) && memcmp(header->magic, SCENE_CACHE_MAGIC, sizeof(header->magic)) == 0 &&
+               header->version == SCENE_CACHE_VERSION;
+  const uint64_t fileSize = m_file.Size();
+  for(uint32_t i = 0; valid && i < SCENE_CACHE_SECTIONS_NUM; ++i)
+  {
+    // offset + count*elemSize could wrap around for a corrupted header, so the bytes after offset are compared instead
+    const auto& section = header->sections[i];
+    valid = section.offset % SCENE_CACHE_ALIGNMENT == 0 && section.offset <= fileSize &&
+            (section.elemSize == 0 || section.count <= (fileSize - section.offset) / section.elemSize);
+  }
+  if(!valid)
+  {
+    std::cout << "SceneCacheReader: " << a_path << " is not a scene cache of version " << SCENE_CACHE_VERSION << " or is truncated" << std::endl;
+    m_file.Close();
+    return false;
+  }
+
+  size_t pathLength = 0;
+  const char* sourcePath = Section<char>(SCENE_CACHE_SOURCE_PATH, pathLength);
+  if(header->loadFlags != a_key.loadFlags || header->sourceTime != a_key.sourceTime || header->sourceSize != a_key.sourceSize ||
+     std::string(sourcePath, pathLength) != a_key.sourcePath)
+  {
+    m_file.Close(); // outdated, will be overwritten
+    return false;
+  }
+
+  return true;
+}
+
+const void* SceneCacheReader::Section(SCENE_CACHE_SECTION a_section, size_t a_elemSize, size_t& a_count) const
+{
+  a_count = 0;
+  if(!m_file.IsOpen())
+    return nullptr;
+
+  const auto& section = m_file.At<SceneCacheHeader>(0)->sections[a_section];
+  if(section.count == 0 || section.elemSize != a_elemSize)
+    return nullptr;
+
+  a_count = size_t(section.count);
+  return m_file.Data() + section.offset;
+}
+
+std::vector<std::string> SceneCacheReader::Strings(SCENE_CACHE_SECTION a_section) const
+{
+  std::vector<std::string> res;
+  size_t count = 0;
+  const char* data = Section<char>(a_section, count);
+  for(size_t begin = 0; begin < count;)
+  {
+    const size_t length = strnlen(data + begin, count - begin);
+    res.emplace_back(data + begin, length);
+    begin += length + 1;
+  }
+  return res;
+}
@@ -0,0 +1,88 @@
+#ifndef CHIMERA_SCENE_CACHE_H
+#define CHIMERA_SCENE_CACHE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../utils/mapped_file.h"
+
+/**
+\brief Sections of binary scene cache, each one is a flat array of trivially copyable elements
+*/
+enum SCENE_CACHE_SECTION : uint32_t
+{
+  SCENE_CACHE_SOURCE_PATH        = 0, ///< char, absolute path of the scene file the cache was made from
+  SCENE_CACHE_MESH_INFOS         = 1, ///< MeshInfo
+  SCENE_CACHE_INSTANCE_MESHES    = 2, ///< uint32_t, mesh id of each instance
+  SCENE_CACHE_INSTANCE_MATRICES  = 3, ///< LiteMath::float4x4
+  SCENE_CACHE_MATERIALS          = 4, ///< MaterialData_pbrMR
+  SCENE_CACHE_TEXTURE_PATHS      = 5, ///< char, '\0'-terminated paths one after another
+  SCENE_CACHE_CAMERAS            = 6, ///< hydra_xml::Camera
+  SCENE_CACHE_VERTICES           = 7, ///< float, interleaved vertices of all meshes
+  SCENE_CACHE_INDICES            = 8, ///< uint32_t, indices of all meshes
+  SCENE_CACHE_MATERIAL_IDS       = 9, ///< uint32_t, material id of each triangle
+  SCENE_CACHE_SECTIONS_NUM       = 10
+};
+
+/**
+\brief Identifies the scene file state and loading options the cache is valid for.
+Note that only the scene file itself is checked, changes of mesh (.vsgf, .bin) and texture files alone do not invalidate the cache.
+*/
+struct SceneCacheKey
+{
+  std::string sourcePath;     ///< absolute path
+  int64_t     sourceTime = 0; ///< modification time
+  uint64_t    sourceSize = 0;
+  uint32_t    loadFlags  = 0; ///< anything that changes cached data besides the scene file, i.e. loader config
+
+  static bool FromFile(const std::string& a_path, uint32_t a_loadFlags, SceneCacheKey& a_key); ///< returns false if file does not exist
+  std::string CachePath(const std::string& a_cacheDir, const char* a_extension = ".scache") const; ///< cache file name in a_cacheDir, unique for the source path
+};
+
+/**
+\brief Collects sections in memory and writes cache file at once. File is written under temporary name and then renamed,
+so readers never see partially written cache.
+*/
+class SceneCacheWriter
+{
+public:
+  template<typename T>
+  void Add(SCENE_CACHE_SECTION a_section, const T* a_data, size_t a_count) { Add(a_section, a_data, a_count, sizeof(T)); }
+  void Add(SCENE_CACHE_SECTION a_section, const void* a_data, size_t a_count, size_t a_elemSize);
+
+  bool Write(const std::string& a_path, const SceneCacheKey& a_key) const;
+
+private:
+  struct Section
+  {
+    const void* data     = nullptr;
+    size_t      count    = 0;
+    size_t      elemSize = 0;
+  };
+  Section m_sections[SCENE_CACHE_SECTIONS_NUM];
+};
+
+/**
+\brief Memory-mapped cache file; sections point straight into the mapping and stay valid until the object is destroyed.
+*/
+class SceneCacheReader
+{
+public:
+  bool Open(const std::string& a_path, const SceneCacheKey& a_key); ///< returns false if file is absent, corrupted or made for other key
+
+  /// returns nullptr and a_count = 0 if section is empty or its elements are not of size sizeof(T)
+  template<typename T>
+  const T* Section(SCENE_CACHE_SECTION a_section, size_t& a_count) const
+  {
+    return reinterpret_cast<const T*>(Section(a_section, sizeof(T), a_count));
+  }
+  const void* Section(SCENE_CACHE_SECTION a_section, size_t a_elemSize, size_t& a_count) const;
+
+  std::vector<std::string> Strings(SCENE_CACHE_SECTION a_section) const; ///< splits '\0'-terminated strings of char section
+
+private:
+  MappedFile m_file;
+};
+
+#endif// CHIMERA_SCENE_CACHE_H
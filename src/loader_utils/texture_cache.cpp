@@ -0,0 +1,363 @@
+#include "texture_cache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+static const char     TEXTURE_CACHE_MAGIC[8]  = {'C', 'H', 'T', 'E', 'X', 'M', 'I', 'P'};
+static const uint32_t TEXTURE_CACHE_VERSION   = 2; // 2: 1 channel images are expanded to (r, 0, 0, 1), version 1 had gray (r, r, r, 1)
+static const size_t   TEXTURE_CACHE_ALIGNMENT = 64;
+static const uint32_t TEXTURE_CACHE_MAX_MIPS  = 32;
+
+struct TextureCacheHeader
+{
+  char     magic[8];
+  uint32_t version;
+  uint32_t format;
+  int64_t  sourceTime;
+  uint64_t sourceSize;
+  uint32_t width;
+  uint32_t height;
+  uint32_t mipLevels;
+  uint32_t pathLength;  ///< source path follows the header
+  uint64_t dataOffset;
+  uint64_t dataSize;
+  uint64_t mipOffsets[TEXTURE_CACHE_MAX_MIPS]; ///< relative to dataOffset
+};
+
+static size_t alignSize(size_t a_size) { return (a_size + TEXTURE_CACHE_ALIGNMENT - 1) / TEXTURE_CACHE_ALIGNMENT * TEXTURE_CACHE_ALIGNMENT; }
+
+static uint32_t mipSize(uint32_t a_size, uint32_t a_level) { return std::max(a_size >> a_level, 1u); }
+
+TEXTURE_CACHE_FORMAT textureCacheFormat(const ImageFileInfo& a_info)
+{
+  if(a_info.bytesPerChannel == 1)
+    return TEXTURE_CACHE_RGBA8;
+
+  const auto ext = std::filesystem::path(a_info.path).extension();
+  return ext == ".image4f" ? TEXTURE_CACHE_RGBA32F : TEXTURE_CACHE_RGBA16F;
+}
+
+uint32_t textureCacheBytesPerPixel(TEXTURE_CACHE_FORMAT a_format)
+{
+  switch(a_format)
+  {
+  case TEXTURE_CACHE_RGBA8:   return 4;
+  case TEXTURE_CACHE_RGBA16F: return 8;
+  case TEXTURE_CACHE_RGBA32F: return 16;
+  }
+  return 0;
+}
+
+uint32_t textureCacheMipLevels(uint32_t a_width, uint32_t a_height)
+{
+  uint32_t levels = 1;
+  for(uint32_t size = std::max(a_width, a_height); size > 1; size >>= 1)
+    levels++;
+  return levels;
+}
+
+// round to nearest even, as F16C conversion does
+static uint16_t floatToHalf(float a_value)
+{
+  uint32_t bits;
+  memcpy(&bits, &a_value, sizeof(float));
+  const uint32_t sign = (bits >> 16) & 0x8000u;
+  const uint32_t absBits = bits & 0x7FFFFFFFu;
+
+  if(absBits >= 0x7F800000u) // infinity or NaN
+    return uint16_t(sign | 0x7C00u | (absBits > 0x7F800000u ? 0x0200u : 0u));
+  if(absBits >= 0x477FF000u) // rounds to infinity
+    return uint16_t(sign | 0x7C00u);
+  if(absBits < 0x38800000u) // half denormals and zero, value is a multiple of 2^-24
+  {
+    float absValue;
+    memcpy(&absValue, &absBits, sizeof(float));
+    return uint16_t(sign | uint32_t(std::nearbyint(absValue * 16777216.0f)));
+  }
+
+  uint32_t half = (absBits - 0x38000000u) >> 13; // rebias exponent from 127 to 15
+  const uint32_t rest = absBits & 0x1FFFu;
+  if(rest > 0x1000u || (rest == 0x1000u && (half & 1u)))
+    half++;
+  return uint16_t(sign | half);
+}
+
+// 2x2 box filter, the last row/column of odd sized level is averaged with itself
+template<typename T>
+static void downsample(const T* a_src, uint32_t a_width, uint32_t a_height, T* a_dst)
+{
+  const uint32_t dstWidth  = std::max(a_width / 2, 1u);
+  const uint32_t dstHeight = std::max(a_height / 2, 1u);
+  const float    rounding  = std::is_integral<T>::value ? 0.5f : 0.0f;
+  for(uint32_t y = 0; y < dstHeight; ++y)
+  {
+    const uint32_t y0 = std::min(2 * y, a_height - 1), y1 = std::min(2 * y + 1, a_height - 1);
+    for(uint32_t x = 0; x < dstWidth; ++x)
+    {
+      const uint32_t x0 = std::min(2 * x, a_width - 1), x1 = std::min(2 * x + 1, a_width - 1);
+      for(uint32_t c = 0; c < 4; ++c)
+      {
+        const float sum = float(a_src[(y0 * a_width + x0) * 4 + c]) + float(a_src[(y0 * a_width + x1) * 4 + c]) +
+                          float(a_src[(y1 * a_width + x0) * 4 + c]) + float(a_src[(y1 * a_width + x1) * 4 + c]);
+        a_dst[(y * dstWidth + x) * 4 + c] = T(sum * 0.25f + rounding);
+      }
+    }
+  }
+}
+
+// all levels one after another without alignment, level 0 is a_rgba
+template<typename T>
+static std::vector<T> buildMipChain(std::vector<T>&& a_rgba, uint32_t a_width, uint32_t a_height, uint32_t a_mipLevels, std::vector<size_t>& a_offsets)
+{
+  a_offsets.resize(a_mipLevels);
+  size_t total = 0;
+  for(uint32_t level = 0; level < a_mipLevels; ++level)
+  {
+    a_offsets[level] = total;
+    total += size_t(mipSize(a_width, level)) * mipSize(a_height, level) * 4;
+  }
+
+  std::vector<T> chain = std::move(a_rgba);
+  chain.resize(total);
+  for(uint32_t level = 1; level < a_mipLevels; ++level)
+    downsample(chain.data() + a_offsets[level - 1], mipSize(a_width, level - 1), mipSize(a_height, level - 1), chain.data() + a_offsets[level]);
+  return chain;
+}
+
+// missing channels are filled as R8/R8G8/R32 images of uncached textures are sampled, so shaders get the same values with cache
+template<typename T>
+static std::vector<T> expandToRGBA(const std::vector<T>& a_pixels, size_t a_pixelsNum, uint32_t a_channels, T a_one)
+{
+  std::vector<T> rgba(a_pixelsNum * 4);
+  for(size_t i = 0; i < a_pixelsNum; ++i)
+  {
+    const T* src = a_pixels.data() + i * a_channels;
+    T*       dst = rgba.data() + i * 4;
+    dst[0] = src[0];
+    dst[1] = a_channels > 1 ? src[1] : T(0);
+    dst[2] = a_channels > 2 ? src[2] : T(0);
+    dst[3] = a_channels > 3 ? src[3] : a_one;
+  }
+  return rgba;
+}
+
+// whole cache file contents
+static bool buildCachedTexture(const SceneCacheKey& a_key, const ImageFileInfo& a_info, TEXTURE_CACHE_FORMAT a_format, std::vector<uint8_t>& a_file)
+{
+  if(!a_info.is_ok || a_info.width <= 0 || a_info.height <= 0)
+    return false;
+
+  const uint32_t width     = uint32_t(a_info.width);
+  const uint32_t height    = uint32_t(a_info.height);
+  const uint32_t mipLevels = textureCacheMipLevels(width, height);
+  const size_t   pixelsNum = size_t(width) * height;
+  const uint32_t channels  = a_info.channels == 3 ? 4 : uint32_t(a_info.channels); // the same as image loaders return
+
+  // levels are packed in chain without alignment, the file aligns each of them
+  std::vector<uint8_t>  chain8;
+  std::vector<float>    chain32;
+  std::vector<uint16_t> chain16;
+  std::vector<size_t>   chainOffsets;
+  const uint8_t* chainData = nullptr;
+  if(a_format == TEXTURE_CACHE_RGBA8)
+  {
+    auto pixels = loadImageLDR(a_info);
+    if(pixels.size() < pixelsNum * channels)
+      return false;
+    chain8    = buildMipChain(channels == 4 ? std::move(pixels) : expandToRGBA<uint8_t>(pixels, pixelsNum, channels, 255), width, height, mipLevels, chainOffsets);
+    chainData = chain8.data();
+  }
+  else
+  {
+    auto pixels = loadImageHDR(a_info);
+    if(pixels.size() < pixelsNum * channels)
+      return false;
+    chain32   = buildMipChain(channels == 4 ? std::move(pixels) : expandToRGBA<float>(pixels, pixelsNum, channels, 1.0f), width, height, mipLevels, chainOffsets);
+    chainData = reinterpret_cast<const uint8_t*>(chain32.data());
+    if(a_format == TEXTURE_CACHE_RGBA16F)
+    {
+      chain16.resize(chain32.size());
+      std::transform(chain32.begin(), chain32.end(), chain16.begin(), floatToHalf);
+      std::vector<float>().swap(chain32);
+      chainData = reinterpret_cast<const uint8_t*>(chain16.data());
+    }
+  }
+
+  const uint32_t bpp = textureCacheBytesPerPixel(a_format);
+
+  TextureCacheHeader header = {};
+  memcpy(header.magic, TEXTURE_CACHE_MAGIC, sizeof(header.magic));
+  header.version    = TEXTURE_CACHE_VERSION;
+  header.format     = a_format;
+  header.sourceTime = a_key.sourceTime;
+  header.sourceSize = a_key.sourceSize;
+  header.width      = width;
+  header.height     = height;
+  header.mipLevels  = mipLevels;
+  header.pathLength = uint32_t(a_key.sourcePath.size());
+  header.dataOffset = alignSize(sizeof(header) + a_key.sourcePath.size());
+  for(uint32_t level = 0; level < mipLevels; ++level)
+  {
+    header.mipOffsets[level] = header.dataSize;
+    header.dataSize += alignSize(size_t(mipSize(width, level)) * mipSize(height, level) * bpp);
+  }
+
+  a_file.assign(size_t(header.dataOffset + header.dataSize), 0);
+  memcpy(a_file.data(), &header, sizeof(header));
+  memcpy(a_file.data() + sizeof(header), a_key.sourcePath.data(), a_key.sourcePath.size());
+  for(uint32_t level = 0; level < mipLevels; ++level)
+  {
+    const size_t bytes = size_t(mipSize(width, level)) * mipSize(height, level) * bpp;
+    memcpy(a_file.data() + header.dataOffset + header.mipOffsets[level], chainData + chainOffsets[level] * (bpp / 4), bytes);
+  }
+  return true;
+}
+
+static bool writeFile(const std::string& a_path, const std::vector<uint8_t>& a_data)
+{
+  std::error_code err;
+  std::filesystem::create_directories(std::filesystem::path(a_path).parent_path(), err);
+
+  // several textures of a scene may refer to the same file and be cached from different threads at once
+  const std::string tmpPath = a_path + ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+  {
+    std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+    if(!file.is_open())
+    {
+      std::cout << "writeCachedTexture: can't open " << tmpPath << " for writing" << std::endl;
+      return false;
+    }
+
+    file.write(reinterpret_cast<const char*>(a_data.data()), std::streamsize(a_data.size()));
+    if(!file.good())
+    {
+      std::cout << "writeCachedTexture: failed to write " << tmpPath << std::endl;
+      file.close();
+      std::filesystem::remove(tmpPath, err);
+      return false;
+    }
+  }
+
+  std::filesystem::rename(tmpPath, a_path, err);
+  if(err)
+  {
+    std::cout << "writeCachedTexture: can't rename " << tmpPath << " to " << a_path << ": " << err.message() << std::endl;
+    std::filesystem::remove(tmpPath, err);
+    return false;
+  }
+  return true;
+}
+
+bool writeCachedTexture(const std::string& a_path, const SceneCacheKey& a_key, const ImageFileInfo& a_info, TEXTURE_CACHE_FORMAT a_format)
+{
+  std::vector<uint8_t> data;
+  return buildCachedTexture(a_key, a_info, a_format, data) && writeFile(a_path, data);
+}
+
+bool loadCachedTexture(const std::string& a_cacheDir, const ImageFileInfo& a_info, CachedTexture& a_texture)
+{
+  const TEXTURE_CACHE_FORMAT format = textureCacheFormat(a_info);
+
+  SceneCacheKey key;
+  if(!a_info.is_ok || !SceneCacheKey::FromFile(a_info.path, format, key))
+    return false;
+
+  const std::string cachePath = key.CachePath(a_cacheDir, ".image4mip");
+  if(a_texture.Open(cachePath, key))
+    return true;
+
+  std::vector<uint8_t> data;
+  if(!buildCachedTexture(key, a_info, format, data))
+    return false;
+  if(writeFile(cachePath, data) && a_texture.Open(cachePath, key))
+    return true;
+  return a_texture.Open(std::move(data), key); // the texture is still usable if the cache can't be written
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool CachedTexture::Open(const std::string& a_path, const SceneCacheKey& a_key)
+{
+  Close();
+  if(!std::filesystem::exists(a_path) || !m_file.Open(a_path))
+    return false;
+  return Validate(a_path, a_key);
+}
+
+bool CachedTexture::Open(std::vector<uint8_t>&& a_data, const SceneCacheKey& a_key)
+{
+  Close();
+  m_memory = std::move(a_data);
+  return Validate("texture in memory", a_key);
+}
+
+void CachedTexture::Close()
+{
+  m_file.Close();
+  std::vector<uint8_t>().swap(m_memory);
+}
+
+const uint8_t* CachedTexture::Bytes() const { return m_file.IsOpen() ? m_file.Data() : m_memory.data(); }
+const TextureCacheHeader* CachedTexture::Header() const { return reinterpret_cast<const TextureCacheHeader*>(Bytes()); }
+
+bool CachedTexture::Validate(const std::string& a_name, const SceneCacheKey& a_key)
+{
+  const size_t size   = m_file.IsOpen() ? m_file.Size() : m_memory.size();
+  const auto*  header = Header();
+  bool valid = size >= sizeof(TextureCacheHeader) && memcmp(header->magic, TEXTURE_CACHE_MAGIC, sizeof(header->magic)) == 0 &&
+               header->version == TEXTURE_CACHE_VERSION && header->format <= TEXTURE_CACHE_RGBA32F && header->width > 0 && header->height > 0 &&
+               header->mipLevels == textureCacheMipLevels(header->width, header->height) && header->mipLevels <= TEXTURE_CACHE_MAX_MIPS &&
+               header->dataOffset % TEXTURE_CACHE_ALIGNMENT == 0 && header->dataOffset >= sizeof(TextureCacheHeader) + header->pathLength &&
+               header->dataOffset <= size && header->dataSize <= size - header->dataOffset;
+
+  // each level must follow the previous one and end inside data; sizes are compared by division, so huge width or height can't wrap around
+  const uint64_t bpp = textureCacheBytesPerPixel(TEXTURE_CACHE_FORMAT(valid ? header->format : 0));
+  uint64_t levelsEnd = 0;
+  for(uint32_t level = 0; valid && level < header->mipLevels; ++level)
+  {
+    const uint64_t offset = header->mipOffsets[level];
+    const uint64_t pixels = uint64_t(mipSize(header->width, level)) * mipSize(header->height, level);
+    valid     = offset >= levelsEnd && offset <= header->dataSize && pixels <= (header->dataSize - offset) / bpp;
+    levelsEnd = offset + pixels * bpp;
+  }
+
+  if(!valid)
+  {
+    std::cout << "CachedTexture: " << a_name << " is not a texture cache of version " << TEXTURE_CACHE_VERSION << " or is truncated" << std::endl;
+    Close();
+    return false;
+  }
+
+  const char* sourcePath = reinterpret_cast<const char*>(Bytes() + sizeof(TextureCacheHeader));
+  if(header->format != a_key.loadFlags || header->sourceTime != a_key.sourceTime || header->sourceSize != a_key.sourceSize ||
+     std::string(sourcePath, header->pathLength) != a_key.sourcePath)
+  {
+    Close(); // outdated, will be overwritten
+    return false;
+  }
+
+  return true;
+}
+
+TEXTURE_CACHE_FORMAT CachedTexture::Format() const { return TEXTURE_CACHE_FORMAT(Header()->format); }
+uint32_t CachedTexture::Width()     const { return Header()->width; }
+uint32_t CachedTexture::Height()    const { return Header()->height; }
+uint32_t CachedTexture::MipLevels() const { return Header()->mipLevels; }
+
+const uint8_t* CachedTexture::Data() const { return Bytes() + Header()->dataOffset; }
+size_t CachedTexture::DataSize() const { return size_t(Header()->dataSize); }
+size_t CachedTexture::MipOffset(uint32_t a_level) const { return size_t(Header()->mipOffsets[a_level]); }
+
+size_t CachedTexture::MipSize(uint32_t a_level) const
+{
+  return size_t(mipSize(Width(), a_level)) * mipSize(Height(), a_level) * textureCacheBytesPerPixel(Format());
+}
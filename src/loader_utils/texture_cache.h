@@ -0,0 +1,71 @@
+#ifndef CHIMERA_TEXTURE_CACHE_H
+#define CHIMERA_TEXTURE_CACHE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "image_loader.h"
+#include "scene_cache.h"
+#include "../utils/mapped_file.h"
+
+/**
+\brief Pixel formats of cached textures, always 4 channels
+*/
+enum TEXTURE_CACHE_FORMAT : uint32_t
+{
+  TEXTURE_CACHE_RGBA8   = 0, ///< unsigned char per channel, for LDR images
+  TEXTURE_CACHE_RGBA16F = 1, ///< half float per channel, for HDR images (.hdr)
+  TEXTURE_CACHE_RGBA32F = 2  ///< float per channel, for .image4f which are stored as is
+};
+
+TEXTURE_CACHE_FORMAT textureCacheFormat(const ImageFileInfo& a_info);
+uint32_t textureCacheBytesPerPixel(TEXTURE_CACHE_FORMAT a_format);
+uint32_t textureCacheMipLevels(uint32_t a_width, uint32_t a_height); ///< full chain down to 1x1, level i is max(size >> i, 1)
+
+struct TextureCacheHeader;
+
+/**
+\brief Decoded image with all mip levels, memory-mapped from ".image4mip" cache file. Levels are tightly packed rows of pixels,
+each level starts at 64 byte aligned offset, so the data of all levels can be copied to a staging buffer as is.
+*/
+class CachedTexture
+{
+public:
+  bool Open(const std::string& a_path, const SceneCacheKey& a_key);   ///< returns false if file is absent, corrupted or made for other key
+  bool Open(std::vector<uint8_t>&& a_data, const SceneCacheKey& a_key); ///< contents of cache file kept in memory, when it can't be written
+  void Close();
+  bool IsOpen() const { return m_file.IsOpen() || !m_memory.empty(); }
+
+  TEXTURE_CACHE_FORMAT Format() const;
+  uint32_t Width()     const;
+  uint32_t Height()    const;
+  uint32_t MipLevels() const;
+
+  const uint8_t* Data() const; ///< start of level 0, offsets of levels are relative to it
+  size_t DataSize() const;     ///< size of all levels with alignment
+  size_t MipOffset(uint32_t a_level) const;
+  size_t MipSize(uint32_t a_level) const;
+
+private:
+  bool Validate(const std::string& a_name, const SceneCacheKey& a_key);
+  const uint8_t* Bytes() const;
+  const TextureCacheHeader* Header() const;
+
+  MappedFile           m_file;
+  std::vector<uint8_t> m_memory;
+};
+
+/**
+\brief Decodes the image, converts it to a_format, computes all mip levels on CPU with box filter and writes cache file.
+The file is written under temporary name and renamed, so concurrent readers never see partially written texture.
+*/
+bool writeCachedTexture(const std::string& a_path, const SceneCacheKey& a_key, const ImageFileInfo& a_info, TEXTURE_CACHE_FORMAT a_format);
+
+/**
+\brief Maps cached texture of a_info from a_cacheDir, the cache file is (re)created first if it is absent or the image file has changed.
+Format is chosen with textureCacheFormat().
+*/
+bool loadCachedTexture(const std::string& a_cacheDir, const ImageFileInfo& a_info, CachedTexture& a_texture);
+
+#endif// CHIMERA_TEXTURE_CACHE_H
@@ -0,0 +1,86 @@
+#include "vsgf_loader.h"
+
+#include <iostream>
+
+namespace vsgf
+{
+  // the same as in cmesh::LoadMeshFromVSGF
+  struct Header
+  {
+    uint64_t fileSizeInBytes;
+    uint32_t verticesNum;
+    uint32_t indicesNum;
+    uint32_t materialsNum;
+    uint32_t flags;
+  };
+
+  static constexpr uint32_t HAS_TANGENT = 1;
+
+  bool MappedMesh::Open(const std::string& a_path, pugi::xml_node a_meshNode)
+  {
+    m_view = MeshView();
+    if(!m_file.Open(a_path))
+      return false;
+
+    const size_t chunkOffset = size_t(a_meshNode.attribute(L"offset").as_ullong());
+    if(chunkOffset + sizeof(Header) > m_file.Size())
+    {
+      std::cout << "vsgf::MappedMesh: " << a_path << " is truncated" << std::endl;
+      m_file.Close();
+      return false;
+    }
+
+    const Header* header = m_file.At<Header>(chunkOffset);
+    const size_t  vertNum = header->verticesNum;
+    const size_t  indNum  = header->indicesNum;
+
+    // offsets of arrays as they follow each other in VSGF chunk
+    size_t offset = chunkOffset + sizeof(Header);
+    size_t posOffset  = offset; offset += vertNum * 4 * sizeof(float);
+    size_t normOffset = offset; offset += vertNum * 4 * sizeof(float);
+    size_t tangOffset = 0;
+    if(header->flags & HAS_TANGENT)
+    {
+      tangOffset = offset;
+      offset    += vertNum * 4 * sizeof(float);
+    }
+    size_t texOffset = offset; offset += vertNum * 2 * sizeof(float);
+    size_t indOffset = offset; offset += indNum * sizeof(uint32_t);
+    size_t matOffset = offset; offset += (indNum / 3) * sizeof(uint32_t);
+
+    // XML knows the same offsets relative to the chunk start, prefer them if they are present
+    auto xmlOffset = [&a_meshNode, chunkOffset](const wchar_t* a_name, size_t& a_offset) {
+      auto attr = a_meshNode.child(a_name).attribute(L"offset");
+      if(attr)
+        a_offset = chunkOffset + size_t(attr.as_ullong());
+    };
+    xmlOffset(L"positions",  posOffset);
+    xmlOffset(L"normals",    normOffset);
+    xmlOffset(L"tangents",   tangOffset);
+    xmlOffset(L"texcoords",  texOffset);
+    xmlOffset(L"indices",    indOffset);
+    xmlOffset(L"matindices", matOffset);
+
+    const size_t ends[] = {posOffset + vertNum * 16, normOffset + vertNum * 16, texOffset + vertNum * 8,
+                           indOffset + indNum * 4, matOffset + (indNum / 3) * 4, tangOffset != 0 ? tangOffset + vertNum * 16 : 0};
+    for(size_t end : ends)
+    {
+      if(end > m_file.Size())
+      {
+        std::cout << "vsgf::MappedMesh: " << a_path << " is truncated" << std::endl;
+        m_file.Close();
+        return false;
+      }
+    }
+
+    m_view.vertNum    = uint32_t(vertNum);
+    m_view.indNum     = uint32_t(indNum);
+    m_view.pos4f      = m_file.At<float>(posOffset);
+    m_view.norm4f     = m_file.At<float>(normOffset);
+    m_view.tang4f     = (tangOffset != 0) ? m_file.At<float>(tangOffset) : nullptr;
+    m_view.texCoord2f = m_file.At<float>(texOffset);
+    m_view.indices    = m_file.At<uint32_t>(indOffset);
+    m_view.matIndices = m_file.At<uint32_t>(matOffset);
+    return true;
+  }
+}
@@ -0,0 +1,44 @@
+#ifndef CHIMERA_VSGF_LOADER_H
+#define CHIMERA_VSGF_LOADER_H
+
+#include <cstdint>
+#include <string>
+
+#include "pugixml.hpp"
+#include "../utils/mapped_file.h"
+
+namespace vsgf
+{
+  /**
+  \brief Pointers to arrays of one VSGF mesh; all of them point inside of the mapped file
+  */
+  struct MeshView
+  {
+    uint32_t        vertNum    = 0;
+    uint32_t        indNum     = 0;
+    const float*    pos4f      = nullptr;
+    const float*    norm4f     = nullptr;
+    const float*    tang4f     = nullptr; ///< nullptr if mesh has no tangents
+    const float*    texCoord2f = nullptr;
+    const uint32_t* indices    = nullptr;
+    const uint32_t* matIndices = nullptr; ///< indNum/3 elements
+  };
+
+  /**
+  \brief Memory-mapped VSGF mesh. Arrays are located with byte offsets from Hydra XML 'mesh' node if it is given
+  (its 'offset' attribute and 'offset' of 'positions', 'normals', 'tangents', 'texcoords', 'indices', 'matindices' children);
+  otherwise, or if some of them are absent, with VSGF header. Data stays valid until the object is destroyed.
+  */
+  class MappedMesh
+  {
+  public:
+    bool Open(const std::string& a_path, pugi::xml_node a_meshNode = pugi::xml_node()); ///< returns false if file is absent or truncated
+    const MeshView& View() const { return m_view; }
+
+  private:
+    MappedFile m_file;
+    MeshView   m_view;
+  };
+}
+
+#endif// CHIMERA_VSGF_LOADER_H
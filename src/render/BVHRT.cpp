@@ -0,0 +1,817 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cassert>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BVHRT_USE_SSE
+#include <emmintrin.h>
+#endif
+
+#include "CrossRT.h"
+#include "cbvh.h"
+
+using LiteMath::float3;
+using LiteMath::float4;
+using LiteMath::float4x4;
+using cbvh::Box3f;
+
+enum class BVHLayout
+{
+  BVH2 = 0, ///< binary tree, one box test per child
+  BVH4 = 1, ///< collapsed 4-wide tree, all 4 child boxes are tested at once
+  BVH4_COMPRESSED = 2, ///< 4-wide tree with quantized child boxes (64 byte nodes) and indexed triangles
+};
+
+/**
+\brief Native CPU implementation of ISceneObject: BVH (binned SAH) per geometry and the same BVH over instances as TLAS
+*/
+class BVHRT : public ISceneObject
+{
+public:
+  BVHRT(BVHLayout a_layout);
+  ~BVHRT() override {}
+  void ClearGeom() override;
+  void SetBuildProfile(CRT_BuildProfile a_profile, bool a_robust) override;
+
+  uint32_t AddGeom_Triangles4f(const LiteMath::float4* a_vpos4f, size_t a_vertNumber, const uint32_t* a_triIndices, size_t a_indNumber) override;
+  void     UpdateGeom_Triangles4f(uint32_t a_geomId, const LiteMath::float4* a_vpos4f, size_t a_vertNumber, const uint32_t* a_triIndices, size_t a_indNumber) override;
+
+  void ClearScene() override;
+  void CommitScene  () override;
+
+  uint32_t AddInstance(uint32_t a_geomId, const LiteMath::float4x4& a_matrix) override;
+  void     UpdateInstance(uint32_t a_instanceId, const LiteMath::float4x4& a_matrix) override;
+  void     UpdateInstances(const uint32_t* a_instanceIds, const LiteMath::float4x4* a_matrices, size_t a_count) override;
+
+  CRT_Hit  RayQuery_NearestHit(LiteMath::float4 posAndNear, LiteMath::float4 dirAndFar) override;
+  bool     RayQuery_AnyHit(LiteMath::float4 posAndNear, LiteMath::float4 dirAndFar) override;
+
+  void     RayQuery_NearestHitBatch(const CRT_RaysSoA& a_rays, CRT_Hit* out_hits) override;
+  void     RayQuery_AnyHitBatch(const CRT_RaysSoA& a_rays, bool* out_hits) override;
+
+  CRT_MemoryStats GetMemoryStats() const override;
+  CRT_BuildStats  GetBuildStats()  const override { return m_buildStats; }
+
+protected:
+
+  /**
+  \brief Only the tree of 'layout' is not empty. It is the layout of BVHRT, except for trees with too many primitives for 4-wide leaves, they stay binary
+  */
+  struct AccelTree
+  {
+    BVHLayout       layout = BVHLayout::BVH2;
+    cbvh::BVHTree   bvh2;
+    cbvh::BVH4Tree  bvh4;
+    cbvh::BVH4QTree bvh4q;
+  };
+
+  struct GeomData
+  {
+    AccelTree             tree;
+    Box3f                 box;
+    std::vector<float4>   triangles; ///< uncompressed layouts: 3 vertices per triangle, in the order of tree 'primIndices'
+    std::vector<float3>   vertices;  ///< compressed layout: vertex positions
+    std::vector<uint32_t> indices;   ///< compressed layout: 3 indices per triangle, in the order of tree 'primIndices'
+  };
+
+  struct InstanceData
+  {
+    float4x4 matrix;
+    float4x4 invMatrix;
+    uint32_t geomId;
+  };
+
+  struct TraceHit
+  {
+    float    t;
+    float    u, v;
+    uint32_t primId = uint32_t(-1);
+    uint32_t instId = uint32_t(-1);
+  };
+
+  void BuildGeom(GeomData& a_geom, const LiteMath::float4* a_vpos4f, size_t a_vertNumber, const uint32_t* a_triIndices, size_t a_indNumber, bool a_refit);
+
+  void BuildTree(AccelTree& a_tree, const std::vector<Box3f>& a_boxes, const cbvh::BuildSettings& a_settings, bool a_refit) const;
+  const std::vector<uint32_t>& PrimIndices(const AccelTree& a_tree) const;
+  size_t NodesBytes(const AccelTree& a_tree) const;
+
+  template<typename LeafFunc> void Traverse(const AccelTree& a_tree, float3 a_org, float3 a_dir, float a_tNear, const float& a_tFar, LeafFunc a_leaf) const;
+
+  template<bool ANY_HIT> bool TraceBLAS(const GeomData& a_geom, float3 a_org, float3 a_dir, float a_tNear, uint32_t a_instId, TraceHit& a_hit) const;
+  template<bool ANY_HIT> bool TraceTLAS(float3 a_org, float3 a_dir, float a_tNear, TraceHit& a_hit) const;
+
+  CRT_Hit NearestHit(float4 posAndNear, float4 dirAndFar) const;
+  bool    AnyHit    (float4 posAndNear, float4 dirAndFar) const;
+
+  BVHLayout                 m_layout;
+  CRT_BuildProfile          m_profile = CRT_BuildProfile::HIGH;
+  cbvh::BuildSettings       m_buildSettings;
+  std::vector<GeomData>     m_geom;
+  std::vector<InstanceData> m_instances;
+  AccelTree                 m_tlas;
+  std::vector<uint32_t>     m_tlasInstIds; ///< instance of each top level primitive; instances of empty geometry are not in the top level
+
+  CRT_BuildStats            m_buildStats;  ///< of the last CommitScene
+  CRT_BuildStats            m_updateStats; ///< geometry added or updated since the last CommitScene
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// the builder limits tree depth, so the stacks never overflow: binary traversal pushes at most one node per interior level,
+// 4-wide traversal pops one node and pushes up to 4 per interior level; collapsed trees are not deeper than the binary ones
+//
+static constexpr int BVH_STACK_SIZE  = int(cbvh::MAX_TREE_DEPTH);
+static constexpr int BVH4_STACK_SIZE = 3*BVH_STACK_SIZE + 1;
+
+static inline float3 SafeInverse(float3 a_dir)
+{
+  const float eps = 1e-20f;
+  return float3(1.0f / (std::abs(a_dir.x) > eps ? a_dir.x : std::copysign(eps, a_dir.x)),
+                1.0f / (std::abs(a_dir.y) > eps ? a_dir.y : std::copysign(eps, a_dir.y)),
+                1.0f / (std::abs(a_dir.z) > eps ? a_dir.z : std::copysign(eps, a_dir.z)));
+}
+
+static inline bool RayBoxIntersection(float3 a_org, float3 a_invDir, float3 a_boxMin, float3 a_boxMax, float a_tNear, float a_tFar, float& a_tEnter)
+{
+  const float3 t0   = (a_boxMin - a_org) * a_invDir;
+  const float3 t1   = (a_boxMax - a_org) * a_invDir;
+  const float3 tMin = LiteMath::min(t0, t1);
+  const float3 tMax = LiteMath::max(t0, t1);
+  a_tEnter          = std::max(a_tNear, LiteMath::hmax(tMin));
+  const float tExit = std::min(a_tFar,  LiteMath::hmin(tMax));
+  return a_tEnter <= tExit;
+}
+
+// Moller-Trumbore; (u,v) are weights of the second and the third vertices, the same as in Embree
+//
+static inline bool RayTriangleIntersection(float3 a_org, float3 a_dir, float3 a_v0, float3 a_v1, float3 a_v2, float a_tNear, float a_tFar,
+                                           float& a_t, float& a_u, float& a_v)
+{
+  const float3 v0 = a_v0;
+  const float3 e1 = a_v1 - v0;
+  const float3 e2 = a_v2 - v0;
+  const float3 p  = LiteMath::cross(a_dir, e2);
+  const float det = LiteMath::dot(e1, p);
+  if(std::abs(det) < 1e-20f)
+    return false;
+
+  const float invDet = 1.0f / det;
+  const float3 s = a_org - v0;
+  const float  u = LiteMath::dot(s, p) * invDet;
+  if(u < 0.0f || u > 1.0f)
+    return false;
+
+  const float3 q = LiteMath::cross(s, e1);
+  const float  v = LiteMath::dot(a_dir, q) * invDet;
+  if(v < 0.0f || u + v > 1.0f)
+    return false;
+
+  const float t = LiteMath::dot(e2, q) * invDet;
+  if(t < a_tNear || t > a_tFar)
+    return false;
+
+  a_t = t;
+  a_u = u;
+  a_v = v;
+  return true;
+}
+
+/**
+\brief Ray data for RayBox4Intersection, precomputed once per ray and tree
+*/
+struct RayBox4
+{
+#ifdef BVHRT_USE_SSE
+  __m128 orgX, orgY, orgZ;
+  __m128 invDirX, invDirY, invDirZ;
+#else
+  float3 org, invDir;
+#endif
+};
+
+static inline RayBox4 MakeRayBox4(float3 a_org, float3 a_invDir)
+{
+  RayBox4 ray;
+#ifdef BVHRT_USE_SSE
+  ray.orgX    = _mm_set1_ps(a_org.x);
+  ray.orgY    = _mm_set1_ps(a_org.y);
+  ray.orgZ    = _mm_set1_ps(a_org.z);
+  ray.invDirX = _mm_set1_ps(a_invDir.x);
+  ray.invDirY = _mm_set1_ps(a_invDir.y);
+  ray.invDirZ = _mm_set1_ps(a_invDir.z);
+#else
+  ray.org     = a_org;
+  ray.invDir  = a_invDir;
+#endif
+  return ray;
+}
+
+// returns bit mask of hit children; entry distances are written to 'a_tEnter'
+//
+static inline int RayBox4Intersection(const RayBox4& a_ray, const cbvh::BVH4Node& a_node, float a_tNear, float a_tFar, float a_tEnter[4])
+{
+#ifdef BVHRT_USE_SSE
+  const __m128 t0x = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(a_node.boxMinX), a_ray.orgX), a_ray.invDirX);
+  const __m128 t1x = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(a_node.boxMaxX), a_ray.orgX), a_ray.invDirX);
+  const __m128 t0y = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(a_node.boxMinY), a_ray.orgY), a_ray.invDirY);
+  const __m128 t1y = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(a_node.boxMaxY), a_ray.orgY), a_ray.invDirY);
+  const __m128 t0z = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(a_node.boxMinZ), a_ray.orgZ), a_ray.invDirZ);
+  const __m128 t1z = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(a_node.boxMaxZ), a_ray.orgZ), a_ray.invDirZ);
+
+  const __m128 tMin = _mm_max_ps(_mm_max_ps(_mm_min_ps(t0x, t1x), _mm_min_ps(t0y, t1y)), _mm_max_ps(_mm_min_ps(t0z, t1z), _mm_set1_ps(a_tNear)));
+  const __m128 tMax = _mm_min_ps(_mm_min_ps(_mm_max_ps(t0x, t1x), _mm_max_ps(t0y, t1y)), _mm_min_ps(_mm_max_ps(t0z, t1z), _mm_set1_ps(a_tFar)));
+
+  // (+inf, +inf) boxes of empty slots pass the slab test for rays with infinite 'tFar' and non-negative direction
+  //
+  const __m128i empty = _mm_cmpeq_epi32(_mm_load_si128((const __m128i*)a_node.child), _mm_set1_epi32(-1));
+
+  _mm_storeu_ps(a_tEnter, tMin);
+  return _mm_movemask_ps(_mm_andnot_ps(_mm_castsi128_ps(empty), _mm_cmple_ps(tMin, tMax)));
+#else
+  int mask = 0;
+  for(int i = 0; i < 4; i++)
+  {
+    if(a_node.child[i] == cbvh::BVH4_EMPTY)
+      continue;
+    const float3 boxMin(a_node.boxMinX[i], a_node.boxMinY[i], a_node.boxMinZ[i]);
+    const float3 boxMax(a_node.boxMaxX[i], a_node.boxMaxY[i], a_node.boxMaxZ[i]);
+    if(RayBoxIntersection(a_ray.org, a_ray.invDir, boxMin, boxMax, a_tNear, a_tFar, a_tEnter[i]))
+      mask |= (1 << i);
+  }
+  return mask;
+#endif
+}
+
+#ifdef BVHRT_USE_SSE
+static inline __m128 DequantizeBounds(const uint8_t a_q[4], float a_origin, float a_scale)
+{
+  int packed;
+  memcpy(&packed, a_q, sizeof(int));
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i q32  = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero), zero);
+  return _mm_add_ps(_mm_set1_ps(a_origin), _mm_mul_ps(_mm_cvtepi32_ps(q32), _mm_set1_ps(a_scale)));
+}
+#endif
+
+static inline int RayBox4Intersection(const RayBox4& a_ray, const cbvh::BVH4QNode& a_node, float a_tNear, float a_tFar, float a_tEnter[4])
+{
+#ifdef BVHRT_USE_SSE
+  const __m128 t0x = _mm_mul_ps(_mm_sub_ps(DequantizeBounds(a_node.qMinX, a_node.origin[0], a_node.scale[0]), a_ray.orgX), a_ray.invDirX);
+  const __m128 t1x = _mm_mul_ps(_mm_sub_ps(DequantizeBounds(a_node.qMaxX, a_node.origin[0], a_node.scale[0]), a_ray.orgX), a_ray.invDirX);
+  const __m128 t0y = _mm_mul_ps(_mm_sub_ps(DequantizeBounds(a_node.qMinY, a_node.origin[1], a_node.scale[1]), a_ray.orgY), a_ray.invDirY);
+  const __m128 t1y = _mm_mul_ps(_mm_sub_ps(DequantizeBounds(a_node.qMaxY, a_node.origin[1], a_node.scale[1]), a_ray.orgY), a_ray.invDirY);
+  const __m128 t0z = _mm_mul_ps(_mm_sub_ps(DequantizeBounds(a_node.qMinZ, a_node.origin[2], a_node.scale[2]), a_ray.orgZ), a_ray.invDirZ);
+  const __m128 t1z = _mm_mul_ps(_mm_sub_ps(DequantizeBounds(a_node.qMaxZ, a_node.origin[2], a_node.scale[2]), a_ray.orgZ), a_ray.invDirZ);
+
+  const __m128 tMin = _mm_max_ps(_mm_max_ps(_mm_min_ps(t0x, t1x), _mm_min_ps(t0y, t1y)), _mm_max_ps(_mm_min_ps(t0z, t1z), _mm_set1_ps(a_tNear)));
+  const __m128 tMax = _mm_min_ps(_mm_min_ps(_mm_max_ps(t0x, t1x), _mm_max_ps(t0y, t1y)), _mm_min_ps(_mm_max_ps(t0z, t1z), _mm_set1_ps(a_tFar)));
+
+  // empty slots have inverted boxes which are not reliably missed by the slab test
+  //
+  const __m128i empty = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)a_node.child), _mm_set1_epi32(-1));
+
+  _mm_storeu_ps(a_tEnter, tMin);
+  return _mm_movemask_ps(_mm_andnot_ps(_mm_castsi128_ps(empty), _mm_cmple_ps(tMin, tMax)));
+#else
+  const float3 origin(a_node.origin[0], a_node.origin[1], a_node.origin[2]);
+  const float3 scale (a_node.scale[0],  a_node.scale[1],  a_node.scale[2]);
+  int mask = 0;
+  for(int i = 0; i < 4; i++)
+  {
+    if(a_node.child[i] == cbvh::BVH4_EMPTY)
+      continue;
+    const float3 boxMin = origin + float3(a_node.qMinX[i], a_node.qMinY[i], a_node.qMinZ[i]) * scale;
+    const float3 boxMax = origin + float3(a_node.qMaxX[i], a_node.qMaxY[i], a_node.qMaxZ[i]) * scale;
+    if(RayBoxIntersection(a_ray.org, a_ray.invDir, boxMin, boxMax, a_tNear, a_tFar, a_tEnter[i]))
+      mask |= (1 << i);
+  }
+  return mask;
+#endif
+}
+
+// 'a_leaf(first, count)' is called for every leaf that the ray enters; traversal stops if it returns true
+//
+template<typename LeafFunc>
+static void TraverseBVH2(const cbvh::BVHTree& a_tree, float3 a_org, float3 a_dir, float a_tNear, const float& a_tFar, LeafFunc a_leaf)
+{
+  const auto& nodes = a_tree.nodes;
+  if(nodes.empty())
+    return;
+
+  const float3 invDir = SafeInverse(a_dir);
+  float tEnter = 0.0f;
+  if(!RayBoxIntersection(a_org, invDir, nodes[0].boxMin, nodes[0].boxMax, a_tNear, a_tFar, tEnter))
+    return;
+
+  uint32_t stack[BVH_STACK_SIZE];
+  int      top    = 0;
+  uint32_t nodeId = 0;
+
+  while(true)
+  {
+    const cbvh::BVHNode& node = nodes[nodeId];
+    if(node.primsCount != 0)
+    {
+      if(a_leaf(node.leftOffset, node.primsCount))
+        return;
+    }
+    else
+    {
+      const cbvh::BVHNode& left  = nodes[node.leftOffset];
+      const cbvh::BVHNode& right = nodes[node.leftOffset + 1];
+      float tLeft, tRight;
+      const bool hitLeft  = RayBoxIntersection(a_org, invDir, left.boxMin,  left.boxMax,  a_tNear, a_tFar, tLeft);
+      const bool hitRight = RayBoxIntersection(a_org, invDir, right.boxMin, right.boxMax, a_tNear, a_tFar, tRight);
+
+      if(hitLeft && hitRight)
+      {
+        const bool leftFirst = (tLeft <= tRight);
+        assert(top < BVH_STACK_SIZE);
+        stack[top++] = leftFirst ? node.leftOffset + 1 : node.leftOffset;
+        nodeId       = leftFirst ? node.leftOffset : node.leftOffset + 1;
+        continue;
+      }
+      else if(hitLeft || hitRight)
+      {
+        nodeId = hitLeft ? node.leftOffset : node.leftOffset + 1;
+        continue;
+      }
+    }
+
+    if(top == 0)
+      break;
+    nodeId = stack[--top];
+  }
+}
+
+template<typename Tree, typename LeafFunc>
+static void TraverseBVH4(const Tree& a_tree, float3 a_org, float3 a_dir, float a_tNear, const float& a_tFar, LeafFunc a_leaf)
+{
+  const auto& nodes = a_tree.nodes;
+  if(nodes.empty())
+    return;
+
+  struct StackEntry
+  {
+    uint32_t child;
+    float    tEnter;
+  };
+
+  const RayBox4 ray = MakeRayBox4(a_org, SafeInverse(a_dir));
+  StackEntry stack[BVH4_STACK_SIZE];
+  int top = 0;
+  stack[top++] = {0, a_tNear};
+
+  while(top > 0)
+  {
+    const StackEntry entry = stack[--top];
+    if(entry.tEnter > a_tFar) // closer hit was found after this entry had been pushed
+      continue;
+
+    if(cbvh::IsLeaf4(entry.child))
+    {
+      if(a_leaf(cbvh::LeafFirst4(entry.child), cbvh::LeafCount4(entry.child)))
+        return;
+      continue;
+    }
+
+    const auto& node = nodes[entry.child];
+    float tEnter[4];
+    const int mask = RayBox4Intersection(ray, node, a_tNear, a_tFar, tEnter);
+    if(mask == 0)
+      continue;
+
+    // sort hit children by entry distance and push them far to near, so the nearest one is popped first
+    //
+    StackEntry hits[4];
+    int hitsNum = 0;
+    for(int i = 0; i < 4; i++)
+    {
+      if((mask & (1 << i)) == 0)
+        continue;
+      int j = hitsNum++;
+      for(; j > 0 && hits[j-1].tEnter < tEnter[i]; j--)
+        hits[j] = hits[j-1];
+      hits[j] = {node.child[i], tEnter[i]};
+    }
+    assert(top + hitsNum <= BVH4_STACK_SIZE);
+    for(int i = 0; i < hitsNum; i++)
+      stack[top++] = hits[i];
+  }
+}
+
+static inline float3 TransformDirection(const float4x4& a_matrix, float3 a_dir)
+{
+  const float4 res = a_matrix * float4(a_dir.x, a_dir.y, a_dir.z, 0.0f);
+  return float3(res.x, res.y, res.z);
+}
+
+BVHRT::BVHRT(BVHLayout a_layout) : m_layout(a_layout)
+{
+  SetBuildProfile(CRT_BuildProfile::HIGH, false);
+  m_geom.reserve(1024);
+  m_instances.reserve(2048);
+}
+
+// more SAH bins give better trees for the cost of build time; bigger leaves make trees smaller and faster to build
+//
+void BVHRT::SetBuildProfile(CRT_BuildProfile a_profile, bool a_robust)
+{
+  m_profile       = a_profile;
+  m_buildSettings = cbvh::BuildSettings();
+  switch(a_profile)
+  {
+  case CRT_BuildProfile::FAST:
+    m_buildSettings.binsNum        = 8;
+    m_buildSettings.maxPrimsInLeaf = 8;
+    break;
+  case CRT_BuildProfile::BALANCED:
+  case CRT_BuildProfile::REFIT:
+    m_buildSettings.binsNum        = 16;
+    m_buildSettings.maxPrimsInLeaf = 4;
+    break;
+  case CRT_BuildProfile::HIGH:
+  default:
+    m_buildSettings.binsNum        = 32;
+    m_buildSettings.maxPrimsInLeaf = 4;
+    break;
+  }
+}
+
+void BVHRT::ClearGeom()
+{
+  m_geom.clear();
+  m_instances.clear();
+  m_tlas = AccelTree();
+  m_tlasInstIds.clear();
+}
+
+const std::vector<uint32_t>& BVHRT::PrimIndices(const AccelTree& a_tree) const
+{
+  switch(a_tree.layout)
+  {
+  case BVHLayout::BVH4:            return a_tree.bvh4.primIndices;
+  case BVHLayout::BVH4_COMPRESSED: return a_tree.bvh4q.primIndices;
+  default:                         return a_tree.bvh2.primIndices;
+  }
+}
+
+size_t BVHRT::NodesBytes(const AccelTree& a_tree) const
+{
+  switch(a_tree.layout)
+  {
+  case BVHLayout::BVH4:            return a_tree.bvh4.nodes.size()  * sizeof(cbvh::BVH4Node);
+  case BVHLayout::BVH4_COMPRESSED: return a_tree.bvh4q.nodes.size() * sizeof(cbvh::BVH4QNode);
+  default:                         return a_tree.bvh2.nodes.size()  * sizeof(cbvh::BVHNode);
+  }
+}
+
+void BVHRT::BuildTree(AccelTree& a_tree, const std::vector<Box3f>& a_boxes, const cbvh::BuildSettings& a_settings, bool a_refit) const
+{
+  if(a_refit)
+  {
+    if(a_tree.layout == BVHLayout::BVH4_COMPRESSED)
+      cbvh::RefitBVH4Q(a_tree.bvh4q, a_boxes.data());
+    else if(a_tree.layout == BVHLayout::BVH4)
+      cbvh::RefitBVH4(a_tree.bvh4, a_boxes.data());
+    else
+      cbvh::RefitBVH2(a_tree.bvh2, a_boxes.data());
+    return;
+  }
+
+  a_tree        = AccelTree();
+  a_tree.layout = m_layout;
+  a_tree.bvh2   = cbvh::BuildBVH2(a_boxes.data(), a_boxes.size(), a_settings);
+  if(m_layout == BVHLayout::BVH2)
+    return;
+
+  // leaf offsets of 4-wide trees have 27 bits, larger trees stay binary
+  //
+  cbvh::BVH4Tree bvh4 = cbvh::CollapseBVH4(a_tree.bvh2);
+  if(bvh4.nodes.empty() && !a_tree.bvh2.nodes.empty())
+  {
+    std::cout << "BVHRT::BuildTree, " << a_boxes.size() << " primitives don't fit 4-wide tree, binary one is used" << std::endl;
+    a_tree.layout = BVHLayout::BVH2;
+    return;
+  }
+
+  a_tree.bvh2 = cbvh::BVHTree();
+  if(m_layout == BVHLayout::BVH4_COMPRESSED)
+    a_tree.bvh4q = cbvh::CompressBVH4(bvh4);
+  else
+    a_tree.bvh4 = std::move(bvh4);
+}
+
+template<typename LeafFunc>
+void BVHRT::Traverse(const AccelTree& a_tree, float3 a_org, float3 a_dir, float a_tNear, const float& a_tFar, LeafFunc a_leaf) const
+{
+  if(a_tree.layout == BVHLayout::BVH4_COMPRESSED)
+    TraverseBVH4(a_tree.bvh4q, a_org, a_dir, a_tNear, a_tFar, a_leaf);
+  else if(a_tree.layout == BVHLayout::BVH4)
+    TraverseBVH4(a_tree.bvh4, a_org, a_dir, a_tNear, a_tFar, a_leaf);
+  else
+    TraverseBVH2(a_tree.bvh2, a_org, a_dir, a_tNear, a_tFar, a_leaf);
+}
+
+void BVHRT::BuildGeom(GeomData& a_geom, const LiteMath::float4* a_vpos4f, size_t a_vertNumber, const uint32_t* a_triIndices, size_t a_indNumber, bool a_refit)
+{
+  const auto start = std::chrono::high_resolution_clock::now();
+
+  const size_t trisNum = a_indNumber / 3;
+  std::vector<Box3f> boxes(trisNum);
+  a_geom.box = Box3f();
+  for(size_t i = 0; i < trisNum; i++)
+  {
+    boxes[i] = cbvh::TriangleBox(a_vpos4f[a_triIndices[i*3+0]], a_vpos4f[a_triIndices[i*3+1]], a_vpos4f[a_triIndices[i*3+2]]);
+    a_geom.box.include(boxes[i]);
+  }
+
+  BuildTree(a_geom.tree, boxes, m_buildSettings, a_refit);
+
+  const auto& primIndices = PrimIndices(a_geom.tree);
+  if(a_geom.tree.layout == BVHLayout::BVH4_COMPRESSED)
+  {
+    std::vector<float4>().swap(a_geom.triangles);
+    a_geom.vertices.resize(a_vertNumber);
+    for(size_t i = 0; i < a_vertNumber; i++)
+      a_geom.vertices[i] = LiteMath::to_float3(a_vpos4f[i]);
+
+    a_geom.indices.resize(trisNum * 3);
+    for(size_t i = 0; i < trisNum; i++)
+    {
+      const uint32_t triId = primIndices[i];
+      for(size_t k = 0; k < 3; k++)
+        a_geom.indices[i*3+k] = a_triIndices[triId*3+k];
+    }
+  }
+  else
+  {
+    std::vector<float3>().swap(a_geom.vertices); // the tree of too large mesh may have fallen back to binary one
+    std::vector<uint32_t>().swap(a_geom.indices);
+    a_geom.triangles.resize(trisNum * 3);
+    for(size_t i = 0; i < trisNum; i++)
+    {
+      const uint32_t triId = primIndices[i];
+      for(size_t k = 0; k < 3; k++)
+        a_geom.triangles[i*3+k] = a_vpos4f[a_triIndices[triId*3+k]];
+    }
+  }
+
+  const auto end = std::chrono::high_resolution_clock::now();
+  m_updateStats.blasNum++;
+  m_updateStats.blasBuildMs += std::chrono::duration<float, std::milli>(end - start).count();
+}
+
+uint32_t BVHRT::AddGeom_Triangles4f(const LiteMath::float4* a_vpos4f, size_t a_vertNumber, const uint32_t* a_triIndices, size_t a_indNumber)
+{
+  if(a_vpos4f == nullptr)
+  {
+    std::cout << "BVHRT::AddGeom_Triangles4f, nullptr input: a_vpos4f" << std::endl;
+    return uint32_t(-1);
+  }
+
+  if(a_triIndices == nullptr)
+  {
+    std::cout << "BVHRT::AddGeom_Triangles4f, nullptr input: a_triIndices" << std::endl;
+    return uint32_t(-1);
+  }
+
+  m_geom.emplace_back();
+  BuildGeom(m_geom.back(), a_vpos4f, a_vertNumber, a_triIndices, a_indNumber, false);
+  return uint32_t(m_geom.size()-1);
+}
+
+void BVHRT::UpdateGeom_Triangles4f(uint32_t a_geomId, const LiteMath::float4* a_vpos4f, size_t a_vertNumber, const uint32_t* a_triIndices, size_t a_indNumber)
+{
+  if(a_geomId >= m_geom.size() || a_vpos4f == nullptr || a_triIndices == nullptr)
+    return;
+
+  // the same triangles number means the same topology, so the tree is only refitted
+  //
+  GeomData& geom  = m_geom[a_geomId];
+  const bool refit = (a_indNumber / 3 == PrimIndices(geom.tree).size());
+  BuildGeom(geom, a_vpos4f, a_vertNumber, a_triIndices, a_indNumber, refit);
+}
+
+void BVHRT::ClearScene()
+{
+  m_instances.clear();
+  m_tlas = AccelTree();
+  m_tlasInstIds.clear();
+}
+
+uint32_t BVHRT::AddInstance(uint32_t a_geomId, const LiteMath::float4x4& a_matrix)
+{
+  if(a_geomId >= m_geom.size())
+    return uint32_t(-1);
+
+  InstanceData inst;
+  inst.matrix    = a_matrix;
+  inst.invMatrix = LiteMath::inverse4x4(a_matrix);
+  inst.geomId    = a_geomId;
+  m_instances.push_back(inst);
+  return uint32_t(m_instances.size()-1);
+}
+
+void BVHRT::UpdateInstance(uint32_t a_instanceId, const LiteMath::float4x4& a_matrix)
+{
+  if(a_instanceId >= m_instances.size())
+    return;
+
+  m_instances[a_instanceId].matrix    = a_matrix;
+  m_instances[a_instanceId].invMatrix = LiteMath::inverse4x4(a_matrix);
+}
+
+void BVHRT::UpdateInstances(const uint32_t* a_instanceIds, const LiteMath::float4x4* a_matrices, size_t a_count)
+{
+  // inverse matrices of different instances are computed in parallel, so ids must be unique
+  //
+  const int count = int(a_count);
+  #pragma omp parallel for
+  for(int i = 0; i < count; i++)
+    UpdateInstance(a_instanceIds[i], a_matrices[i]);
+  CommitScene();
+}
+
+void BVHRT::CommitScene()
+{
+  const auto start = std::chrono::high_resolution_clock::now();
+
+  // empty geometry has empty box, which has neither center nor area for SAH, so its instances are skipped
+  //
+  std::vector<uint32_t> instIds;
+  std::vector<Box3f>    boxes;
+  instIds.reserve(m_instances.size());
+  boxes.reserve(m_instances.size());
+  for(size_t i = 0; i < m_instances.size(); i++)
+  {
+    const Box3f& geomBox = m_geom[m_instances[i].geomId].box;
+    if(geomBox.empty())
+      continue;
+    instIds.push_back(uint32_t(i));
+    boxes.push_back(cbvh::TransformBox(m_instances[i].matrix, geomBox));
+  }
+
+  // REFIT profile keeps the tree over instances while they are the same, only the bounds are updated
+  //
+  const bool refit = (m_profile == CRT_BuildProfile::REFIT) && !instIds.empty() && instIds == m_tlasInstIds;
+  m_tlasInstIds    = std::move(instIds);
+
+  cbvh::BuildSettings tlasSettings = m_buildSettings;
+  tlasSettings.maxPrimsInLeaf = 1;
+  BuildTree(m_tlas, boxes, tlasSettings, refit);
+
+  const auto end = std::chrono::high_resolution_clock::now();
+  m_buildStats             = m_updateStats;
+  m_buildStats.tlasBuildMs = std::chrono::duration<float, std::milli>(end - start).count();
+  m_updateStats            = CRT_BuildStats();
+}
+
+template<bool ANY_HIT>
+bool BVHRT::TraceBLAS(const GeomData& a_geom, float3 a_org, float3 a_dir, float a_tNear, uint32_t a_instId, TraceHit& a_hit) const
+{
+  const auto& primIndices = PrimIndices(a_geom.tree);
+  const bool  indexed     = (a_geom.tree.layout == BVHLayout::BVH4_COMPRESSED);
+  bool found = false;
+  Traverse(a_geom.tree, a_org, a_dir, a_tNear, a_hit.t, [&](uint32_t a_first, uint32_t a_count) {
+    for(uint32_t i = a_first; i < a_first + a_count; i++)
+    {
+      float3 v0, v1, v2;
+      if(indexed)
+      {
+        v0 = a_geom.vertices[a_geom.indices[i*3+0]];
+        v1 = a_geom.vertices[a_geom.indices[i*3+1]];
+        v2 = a_geom.vertices[a_geom.indices[i*3+2]];
+      }
+      else
+      {
+        v0 = LiteMath::to_float3(a_geom.triangles[i*3+0]);
+        v1 = LiteMath::to_float3(a_geom.triangles[i*3+1]);
+        v2 = LiteMath::to_float3(a_geom.triangles[i*3+2]);
+      }
+
+      float t, u, v;
+      if(RayTriangleIntersection(a_org, a_dir, v0, v1, v2, a_tNear, a_hit.t, t, u, v))
+      {
+        a_hit.t      = t;
+        a_hit.u      = u;
+        a_hit.v      = v;
+        a_hit.primId = primIndices[i];
+        a_hit.instId = a_instId;
+        found        = true;
+        if(ANY_HIT)
+          return true;
+      }
+    }
+    return false;
+  });
+  return found;
+}
+
+template<bool ANY_HIT>
+bool BVHRT::TraceTLAS(float3 a_org, float3 a_dir, float a_tNear, TraceHit& a_hit) const
+{
+  const auto& primIndices = PrimIndices(m_tlas);
+  bool found = false;
+  Traverse(m_tlas, a_org, a_dir, a_tNear, a_hit.t, [&](uint32_t a_first, uint32_t a_count) {
+    for(uint32_t i = a_first; i < a_first + a_count; i++)
+    {
+      // instance matrices are affine, so 't' along transformed (not normalized) direction is the same as in world space
+      //
+      const uint32_t      instId = m_tlasInstIds[primIndices[i]];
+      const InstanceData& inst   = m_instances[instId];
+      const float3 org = inst.invMatrix * a_org;
+      const float3 dir = TransformDirection(inst.invMatrix, a_dir);
+      found = TraceBLAS<ANY_HIT>(m_geom[inst.geomId], org, dir, a_tNear, instId, a_hit) || found;
+      if(ANY_HIT && found)
+        return true;
+    }
+    return false;
+  });
+  return found;
+}
+
+CRT_Hit BVHRT::NearestHit(float4 posAndNear, float4 dirAndFar) const
+{
+  TraceHit hit;
+  hit.t = dirAndFar.w;
+  TraceTLAS<false>(LiteMath::to_float3(posAndNear), LiteMath::to_float3(dirAndFar), posAndNear.w, hit);
+
+  CRT_Hit result;
+  result.t = hit.t;
+  if(hit.primId != uint32_t(-1))
+  {
+    result.geomId    = m_instances[hit.instId].geomId;
+    result.instId    = hit.instId;
+    result.primId    = hit.primId;
+    result.coords[1] = hit.u;
+    result.coords[0] = hit.v;
+    result.coords[2] = 1.0f - hit.v - hit.u;
+  }
+  else
+  {
+    result.geomId = uint32_t(-1);
+    result.instId = uint32_t(-1);
+    result.primId = uint32_t(-1);
+  }
+  return result;
+}
+
+bool BVHRT::AnyHit(float4 posAndNear, float4 dirAndFar) const
+{
+  TraceHit hit;
+  hit.t = dirAndFar.w;
+  return TraceTLAS<true>(LiteMath::to_float3(posAndNear), LiteMath::to_float3(dirAndFar), posAndNear.w, hit);
+}
+
+CRT_Hit BVHRT::RayQuery_NearestHit(LiteMath::float4 posAndNear, LiteMath::float4 dirAndFar)
+{
+  return NearestHit(posAndNear, dirAndFar);
+}
+
+bool BVHRT::RayQuery_AnyHit(LiteMath::float4 posAndNear, LiteMath::float4 dirAndFar)
+{
+  return AnyHit(posAndNear, dirAndFar);
+}
+
+void BVHRT::RayQuery_NearestHitBatch(const CRT_RaysSoA& a_rays, CRT_Hit* out_hits)
+{
+  for(size_t i = 0; i < a_rays.count; i++)
+    out_hits[i] = NearestHit(float4(a_rays.orgX[i], a_rays.orgY[i], a_rays.orgZ[i], a_rays.tNear[i]),
+                             float4(a_rays.dirX[i], a_rays.dirY[i], a_rays.dirZ[i], a_rays.tFar[i]));
+}
+
+void BVHRT::RayQuery_AnyHitBatch(const CRT_RaysSoA& a_rays, bool* out_hits)
+{
+  for(size_t i = 0; i < a_rays.count; i++)
+    out_hits[i] = AnyHit(float4(a_rays.orgX[i], a_rays.orgY[i], a_rays.orgZ[i], a_rays.tNear[i]),
+                         float4(a_rays.dirX[i], a_rays.dirY[i], a_rays.dirZ[i], a_rays.tFar[i]));
+}
+
+CRT_MemoryStats BVHRT::GetMemoryStats() const
+{
+  CRT_MemoryStats stats;
+  stats.nodesBytes = NodesBytes(m_tlas);
+  stats.primitivesBytes = (PrimIndices(m_tlas).size() + m_tlasInstIds.size()) * sizeof(uint32_t);
+  for(const auto& geom : m_geom)
+  {
+    stats.nodesBytes      += NodesBytes(geom.tree);
+    stats.primitivesBytes += PrimIndices(geom.tree).size() * sizeof(uint32_t) + geom.triangles.size() * sizeof(float4) +
+                             geom.vertices.size() * sizeof(float3) + geom.indices.size() * sizeof(uint32_t);
+  }
+  stats.totalBytes = stats.nodesBytes + stats.primitivesBytes + m_instances.size() * sizeof(InstanceData);
+  return stats;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+ISceneObject* CreateBVH2CommonRT() { return new BVHRT(BVHLayout::BVH2); }
+ISceneObject* CreateBVH4CommonRT() { return new BVHRT(BVHLayout::BVH4); }
+ISceneObject* CreateBVH4CompressedRT() { return new BVHRT(BVHLayout::BVH4_COMPRESSED); }
@@ -0,0 +1,28 @@
+#include <iostream>
+#include <string>
+
+#include "CrossRT.h"
+
+ISceneObject* CreateSceneRT(const char* a_impleName)
+{
+  const std::string name = (a_impleName == nullptr) ? "" : a_impleName;
+
+  if(name == "BVH2Common")
+    return CreateBVH2CommonRT();
+  else if(name == "BVH4Common")
+    return CreateBVH4CommonRT();
+  else if(name == "BVH4Compressed")
+    return CreateBVH4CompressedRT();
+#ifdef USE_EMBREE
+  if(name == "" || name == "Embree")
+    return CreateEmbreeRT();
+#else
+  if(name == "")
+    return CreateBVH2CommonRT();
+#endif
+
+  std::cout << "CreateSceneRT: unknown implementation '" << name << "', using default one" << std::endl;
+  return CreateSceneRT("");
+}
+
+void DeleteSceneRT(ISceneObject* a_pScene)  { delete a_pScene; }
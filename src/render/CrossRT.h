@@ -2,6 +2,7 @@
 
 #include <cstdint>
 #include <cstddef>
+#include <vector>
 #include "LiteMath.h"
 
 /**
@@ -16,6 +17,53 @@ struct CRT_Hit
   float    coords[4]; ///< custom intersection data; for triangles coords[0] and coords[1] stores baricentric coords (u,v)
 };
 
+/**
+\brief Structure-of-arrays ray batch for RayQuery_NearestHitBatch and RayQuery_AnyHitBatch
+*/
+struct CRT_RaysSoA
+{
+  const float* orgX;  ///< ray origins, x coordinate
+  const float* orgY;  ///< ray origins, y coordinate
+  const float* orgZ;  ///< ray origins, z coordinate
+  const float* tNear; ///< ray segment start
+  const float* dirX;  ///< ray directions, x coordinate
+  const float* dirY;  ///< ray directions, y coordinate
+  const float* dirZ;  ///< ray directions, z coordinate
+  const float* tFar;  ///< ray segment end
+  size_t       count; ///< number of rays; all arrays above should have at least 'count' elements
+};
+
+/**
+\brief Memory occupied by CPU acceleration structure, see ISceneObject::GetMemoryStats
+*/
+struct CRT_MemoryStats
+{
+  size_t nodesBytes      = 0; ///< BVH nodes of all levels; 0 if backend does not expose it
+  size_t primitivesBytes = 0; ///< triangle data and primitive indices referenced by leaves; 0 if backend does not expose it
+  size_t totalBytes      = 0; ///< everything allocated by backend for the scene
+};
+
+/**
+\brief Trade-off between acceleration structure build time and ray tracing speed, see ISceneObject::SetBuildProfile
+*/
+enum class CRT_BuildProfile
+{
+  FAST     = 0, ///< fastest build, e.g. for interactive scene editing
+  BALANCED = 1, ///< medium build quality and memory-compact structures
+  HIGH     = 2, ///< best traversal speed, e.g. for final frame rendering; default
+  REFIT    = 3, ///< build suitable for updates (low quality dynamic scenes for Embree), then geometry updates only refit existing trees (animation)
+};
+
+/**
+\brief Acceleration structure build timings, see ISceneObject::GetBuildStats
+*/
+struct CRT_BuildStats
+{
+  uint32_t blasNum     = 0;    ///< bottom level structures built or updated since previous CommitScene
+  float    blasBuildMs = 0.0f; ///< wall time spent on them
+  float    tlasBuildMs = 0.0f; ///< wall time spent on top level in the last CommitScene
+};
+
 /**
 \brief API to ray-scene intersection on CPU
 */
@@ -28,6 +76,14 @@ struct ISceneObject
   \brief clear everything 
   */
   virtual void ClearGeom() = 0; 
+
+  /**
+  \brief Set build profile for geometry that is added after this call and for the top level structure
+  \param a_profile - see CRT_BuildProfile
+  \param a_robust  - avoid traversal optimizations that reduce arithmetic accuracy (RTC_SCENE_FLAG_ROBUST for Embree)
+  Default implementation ignores the profile.
+  */
+  virtual void SetBuildProfile(CRT_BuildProfile a_profile, bool a_robust = false) { }
   
   /**
   \brief Add geometry of type 'Triangles' to 'internal geometry library' of scene object and return geometry id
@@ -38,6 +94,31 @@ struct ISceneObject
   \return id of added geometry
   */
   virtual uint32_t AddGeom_Triangles4f(const LiteMath::float4* a_vpos4f, size_t a_vertNumber, const uint32_t* a_triIndices, size_t a_indNumber) = 0;
+
+  /**
+  \brief Add geometry of type 'Triangles' which vertex positions are stored with arbitrary stride, e.g. inside of interleaved vertex buffer
+  \param a_vertData   - base pointer of vertex buffer
+  \param a_vertOffset - offset in bytes of the first vertex position from 'a_vertData'; should be multiple of 4
+  \param a_vertStride - distance in bytes between consecutive vertices; should be multiple of 4, at least 16 bytes must be readable from the last position
+  \param a_vertNumber - vertices number
+  \param a_triIndices - triangle indices (standart index buffer)
+  \param a_indNumber  - number of indices, shiuld be equal to 3*triaglesNum in your mesh
+  \return id of added geometry
+
+  Implementation may reference vertex and index data without copying (Embree does), so they must be alive and unchanged 
+  until ClearGeom() or until this geometry is updated with UpdateGeom_Triangles4f. Default implementation copies positions to float4 array and calls AddGeom_Triangles4f.
+  */
+  virtual uint32_t AddGeom_Triangles3fStrided(const void* a_vertData, size_t a_vertOffset, size_t a_vertStride, size_t a_vertNumber, 
+                                              const uint32_t* a_triIndices, size_t a_indNumber)
+  {
+    std::vector<LiteMath::float4> vpos4f(a_vertNumber);
+    for(size_t i = 0; i < a_vertNumber; i++)
+    {
+      const float* pos = reinterpret_cast<const float*>(reinterpret_cast<const char*>(a_vertData) + a_vertOffset + i*a_vertStride);
+      vpos4f[i] = LiteMath::float4(pos[0], pos[1], pos[2], 1.0f);
+    }
+    return AddGeom_Triangles4f(vpos4f.data(), vpos4f.size(), a_triIndices, a_indNumber);
+  }
   
   /**
   \brief Update geometry for triangle mesh to 'internal geometry library' of scene object and return geometry id
@@ -47,6 +128,7 @@ struct ISceneObject
    * change geometry type with this fuction (from 'Triangles' to 'Spheres' for examples). 
    * increase geometry size (no 'a_vertNumber', neither 'a_indNumber') with this fuction (but it is allowed to make it smaller than original geometry size which was set by 'AddGeom_Triangles4f')
   So if you added 'Triangles' and got geom_id == 3, than you will have triangle mesh on geom_id == 3 forever and with the size.
+  If indices are not changed, acceleration structure is refitted instead of rebuilt. Call CommitScene() after updates to update top level.
   */
   virtual void UpdateGeom_Triangles4f(uint32_t a_geomId, const LiteMath::float4* a_vpos4f, size_t a_vertNumber, const uint32_t* a_triIndices, size_t a_indNumber) = 0;
   
@@ -56,7 +138,8 @@ struct ISceneObject
   virtual void ClearScene() = 0; ///< 
 
   /**
-  \brief Finish instancing and build top level acceleration structure
+  \brief Finish instancing and build top level acceleration structure. Implementation may defer building of 
+  bottom level structures for added geometry until this call (Embree does and builds small meshes concurrently)
   */
   virtual void CommitScene() = 0; ///< 
   
@@ -74,6 +157,20 @@ struct ISceneObject
   \param a_matrixData - float4x4 matrix, the layout is column-major
   */
   virtual void     UpdateInstance(uint32_t a_instanceId, const LiteMath::float4x4& a_matrix) = 0; 
+
+  /**
+  \brief Update matrices of many instances and then the top level structure once, so changes are visible to ray queries right after the call
+  \param a_instanceIds - ids returned by AddInstance, without repetitions
+  \param a_matrices    - new float4x4 matrices in the same order, the layout is column-major
+  \param a_count       - number of instances
+  Default implementation calls UpdateInstance for each instance and then CommitScene().
+  */
+  virtual void     UpdateInstances(const uint32_t* a_instanceIds, const LiteMath::float4x4* a_matrices, size_t a_count)
+  {
+    for(size_t i = 0; i < a_count; i++)
+      UpdateInstance(a_instanceIds[i], a_matrices[i]);
+    CommitScene();
+  }
  
   /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
   /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -96,10 +193,50 @@ struct ISceneObject
   */
   virtual bool    RayQuery_AnyHit(LiteMath::float4 posAndNear, LiteMath::float4 dirAndFar) = 0;
 
+  /**
+  \brief Find nearest intersection for each ray of a batch. Default implementation calls RayQuery_NearestHit for every ray
+  \param a_rays       - input rays in SoA layout
+  \param out_hits     - output array of a_rays.count closest hit surface infos
+  */
+  virtual void    RayQuery_NearestHitBatch(const CRT_RaysSoA& a_rays, CRT_Hit* out_hits)
+  {
+    for(size_t i = 0; i < a_rays.count; i++)
+      out_hits[i] = RayQuery_NearestHit(LiteMath::float4(a_rays.orgX[i], a_rays.orgY[i], a_rays.orgZ[i], a_rays.tNear[i]),
+                                        LiteMath::float4(a_rays.dirX[i], a_rays.dirY[i], a_rays.dirZ[i], a_rays.tFar[i]));
+  }
+
+  /**
+  \brief Find any hit for each ray of a batch. Default implementation calls RayQuery_AnyHit for every ray
+  \param a_rays       - input rays in SoA layout
+  \param out_hits     - output array of a_rays.count flags, true if a hit is found for the corresponding ray
+  */
+  virtual void    RayQuery_AnyHitBatch(const CRT_RaysSoA& a_rays, bool* out_hits)
+  {
+    for(size_t i = 0; i < a_rays.count; i++)
+      out_hits[i] = RayQuery_AnyHit(LiteMath::float4(a_rays.orgX[i], a_rays.orgY[i], a_rays.orgZ[i], a_rays.tNear[i]),
+                                    LiteMath::float4(a_rays.dirX[i], a_rays.dirY[i], a_rays.dirZ[i], a_rays.tFar[i]));
+  }
+
+  /**
+  \brief Get memory occupied by acceleration structures and internal copies of geometry. Default implementation returns zeroes
+  */
+  virtual CRT_MemoryStats GetMemoryStats() const { return CRT_MemoryStats(); }
+
+  /**
+  \brief Get build timings of the last CommitScene(). Default implementation returns zeroes
+  */
+  virtual CRT_BuildStats  GetBuildStats() const { return CRT_BuildStats(); }
+
 };
 
 ISceneObject* CreateEmbreeRT();
+ISceneObject* CreateBVH2CommonRT();
+ISceneObject* CreateBVH4CommonRT();
+ISceneObject* CreateBVH4CompressedRT();
 //ISceneObject* CreateVulkanRTX(VkDevice a_device, VkPhysicalDevice a_physDevice, uint32_t a_transferQId, uint32_t a_graphicsQId);
 
+/**
+\brief Create CPU ray tracing backend by name: "Embree", "BVH2Common", "BVH4Common" or "BVH4Compressed". Empty name selects default backend (Embree if it is available)
+*/
 ISceneObject* CreateSceneRT(const char* a_impleName); 
 void          DeleteSceneRT(ISceneObject* a_pScene);
@@ -2,6 +2,15 @@
 #include <vector>
 #include <unordered_map>
 #include <cassert>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
 
 #include "CrossRT.h"
 #include "embree3/rtcore.h"
@@ -12,8 +21,11 @@ public:
   EmbreeRT();
   ~EmbreeRT();
   void ClearGeom() override;
+  void SetBuildProfile(CRT_BuildProfile a_profile, bool a_robust) override;
   
   uint32_t AddGeom_Triangles4f(const LiteMath::float4* a_vpos4f, size_t a_vertNumber, const uint32_t* a_triIndices, size_t a_indNumber) override;
+  uint32_t AddGeom_Triangles3fStrided(const void* a_vertData, size_t a_vertOffset, size_t a_vertStride, size_t a_vertNumber, 
+                                      const uint32_t* a_triIndices, size_t a_indNumber) override;
   void     UpdateGeom_Triangles4f(uint32_t a_geomId, const LiteMath::float4* a_vpos4f, size_t a_vertNumber, const uint32_t* a_triIndices, size_t a_indNumber) override;
 
   void ClearScene() override; 
@@ -21,17 +33,57 @@ public:
   
   uint32_t AddInstance(uint32_t a_geomId, const LiteMath::float4x4& a_matrix) override;
   void     UpdateInstance(uint32_t a_instanceId, const LiteMath::float4x4& a_matrix) override;
+  void     UpdateInstances(const uint32_t* a_instanceIds, const LiteMath::float4x4* a_matrices, size_t a_count) override;
 
   CRT_Hit  RayQuery_NearestHit(LiteMath::float4 posAndNear, LiteMath::float4 dirAndFar) override;
   bool     RayQuery_AnyHit(LiteMath::float4 posAndNear, LiteMath::float4 dirAndFar) override;
 
+  void     RayQuery_NearestHitBatch(const CRT_RaysSoA& a_rays, CRT_Hit* out_hits) override;
+  void     RayQuery_AnyHitBatch(const CRT_RaysSoA& a_rays, bool* out_hits) override;
+
+  CRT_MemoryStats GetMemoryStats() const override;
+  CRT_BuildStats  GetBuildStats()  const override { return m_buildStats; }
+
 protected:
+  uint32_t AddMeshScene(RTCGeometry a_geom, size_t a_vertNumber, size_t a_indNumber, RTCBuffer a_vertBuf, RTCBuffer a_indBuf);
+  void     AttachOwnBuffers(RTCGeometry a_geom, RTCBuffer a_vertBuf, size_t a_vertNumber, RTCBuffer a_indBuf, size_t a_indNumber);
+  void     NewTopLevelScene();
+
+  template<int N, typename RayHitN> void NearestHitPackets(const CRT_RaysSoA& a_rays, CRT_Hit* out_hits);
+  template<int N, typename RayN>    void AnyHitPackets    (const CRT_RaysSoA& a_rays, bool* out_hits);
+
+  CRT_Hit  HitFromEmbree(float a_tfar, unsigned a_geomID, unsigned a_instID, unsigned a_primID, float a_u, float a_v) const;
+
   RTCDevice m_device = nullptr;
   RTCScene  m_scene  = nullptr;
+  int       m_packetSize = 1; ///< widest packet natively supported by device ISA (1, 4, 8 or 16)
+
+  static constexpr size_t SMALL_BLAS_TRIANGLES = 16384; ///< smaller mesh scenes are committed concurrently with each other in CommitScene
+
+  RTCBuildQuality m_sceneQuality = RTC_BUILD_QUALITY_HIGH; ///< for mesh scenes and top level
+  RTCBuildQuality m_geomQuality  = RTC_BUILD_QUALITY_HIGH; ///< for triangle geometries; REFIT allows updates without rebuild
+  RTCSceneFlags   m_sceneFlags   = RTC_SCENE_FLAG_NONE;
+  std::atomic<int64_t> m_memoryUsed{0}; ///< bytes allocated by the device, tracked with memory monitor callback
+
+  struct MeshGeom
+  {
+    RTCGeometry geom         = nullptr;
+    size_t      vertNum      = 0; ///< current number of vertices and indices
+    size_t      indNum       = 0;
+    size_t      vertCapacity = 0; ///< the ones geometry was added with; updates can't exceed them
+    size_t      indCapacity  = 0;
+    RTCBuffer   vertBuf      = nullptr; ///< buffers of capacity size owned by geometry; null if they reference user memory, see AddGeom_Triangles3fStrided
+    RTCBuffer   indBuf       = nullptr;
+  };
 
   std::vector<RTCScene>    m_blas;
+  std::vector<MeshGeom>    m_meshGeom; ///< triangle geometry attached to the corresponding 'm_blas' scene
   std::vector<RTCGeometry> m_inst;
   std::vector<uint32_t>    m_geomIdByInstId;
+
+  std::vector<uint32_t>    m_pendingBlas; ///< mesh scenes that are added but not committed yet, they are built in CommitScene
+  CRT_BuildStats           m_buildStats;   ///< of the last CommitScene
+  CRT_BuildStats           m_updateStats;  ///< geometry updates since the last CommitScene
 };
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -63,12 +115,81 @@ void error_handler(void* userPtr, const RTCError code, const char* str)
 }
 
 
+// select the widest Embree ISA that both CPU and OS (saved vector registers state) support
+//
+static std::string HostEmbreeISA()
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+  int info[4] = {};
+  __cpuid(info, 0);
+  const int maxLeaf = info[0];
+
+  __cpuid(info, 1);
+  const bool sse42   = (info[2] & (1 << 20)) != 0;
+  const bool osxsave = (info[2] & (1 << 27)) != 0;
+  const bool avx     = (info[2] & (1 << 28)) != 0;
+
+  const unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+  const bool osAVX    = (xcr0 & 0x06) == 0x06;
+  const bool osAVX512 = (xcr0 & 0xE6) == 0xE6;
+
+  bool avx2 = false, avx512 = false;
+  if(maxLeaf >= 7)
+  {
+    __cpuidex(info, 7, 0);
+    avx2   = (info[1] & (1 << 5))  != 0;
+    avx512 = (info[1] & (1 << 16)) != 0 && (info[1] & (1 << 17)) != 0 && (info[1] & (1 << 30)) != 0 && (info[1] & (1 << 31)) != 0;
+  }
+
+  if(avx512 && osAVX512)     return "avx512";
+  else if(avx2 && osAVX)     return "avx2";
+  else if(avx && osAVX)      return "avx";
+  else if(sse42)             return "sse4.2";
+  return "sse2";
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq") && __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vl"))
+    return "avx512";
+  else if(__builtin_cpu_supports("avx2"))
+    return "avx2";
+  else if(__builtin_cpu_supports("avx"))
+    return "avx";
+  else if(__builtin_cpu_supports("sse4.2"))
+    return "sse4.2";
+  return "sse2";
+#else
+  return ""; // non x86 host, let Embree decide
+#endif
+}
+
+static bool memory_monitor(void* userPtr, ssize_t bytes, bool post)
+{
+  auto* pCounter = reinterpret_cast<std::atomic<int64_t>*>(userPtr);
+  pCounter->fetch_add(int64_t(bytes));
+  return true;
+}
+
 EmbreeRT::EmbreeRT()
 {
-  m_device = rtcNewDevice("isa=avx2");
+  // Embree falls back to the best ISA it was compiled with if the requested one is not available in the library
+  //
+  const std::string isa    = HostEmbreeISA();
+  const std::string config = isa.empty() ? std::string() : "isa=" + isa;
+  m_device = rtcNewDevice(config.c_str());
   m_scene  = nullptr;
   
   rtcSetDeviceErrorFunction(m_device, error_handler, nullptr);
+  rtcSetDeviceMemoryMonitorFunction(m_device, memory_monitor, &m_memoryUsed);
+
+  if(rtcGetDeviceProperty(m_device, RTC_DEVICE_PROPERTY_NATIVE_RAY16_SUPPORTED))
+    m_packetSize = 16;
+  else if(rtcGetDeviceProperty(m_device, RTC_DEVICE_PROPERTY_NATIVE_RAY8_SUPPORTED))
+    m_packetSize = 8;
+  else if(rtcGetDeviceProperty(m_device, RTC_DEVICE_PROPERTY_NATIVE_RAY4_SUPPORTED))
+    m_packetSize = 4;
+  else
+    m_packetSize = 1;
+
   m_blas.reserve(1024);
   m_inst.reserve(2048);
   m_geomIdByInstId.reserve(m_inst.capacity());
@@ -76,21 +197,82 @@ EmbreeRT::EmbreeRT()
 
 EmbreeRT::~EmbreeRT()
 {
+  for(auto& mesh : m_meshGeom)
+  {
+    if(mesh.vertBuf != nullptr)
+      rtcReleaseBuffer(mesh.vertBuf);
+    if(mesh.indBuf != nullptr)
+      rtcReleaseBuffer(mesh.indBuf);
+  }
   rtcReleaseScene(m_scene);
   rtcReleaseDevice(m_device);
 }
 
+void EmbreeRT::NewTopLevelScene()
+{
+  if(m_scene != nullptr)
+    rtcReleaseScene(m_scene);
+  m_scene = rtcNewScene(m_device);
+  rtcSetSceneBuildQuality(m_scene, m_sceneQuality);
+  rtcSetSceneFlags(m_scene, m_sceneFlags);
+}
+
+void EmbreeRT::SetBuildProfile(CRT_BuildProfile a_profile, bool a_robust)
+{
+  switch(a_profile)
+  {
+  case CRT_BuildProfile::FAST:
+    m_sceneQuality = RTC_BUILD_QUALITY_LOW;
+    m_geomQuality  = RTC_BUILD_QUALITY_LOW;
+    m_sceneFlags   = RTC_SCENE_FLAG_DYNAMIC;
+    break;
+  case CRT_BuildProfile::BALANCED:
+    m_sceneQuality = RTC_BUILD_QUALITY_MEDIUM;
+    m_geomQuality  = RTC_BUILD_QUALITY_MEDIUM;
+    m_sceneFlags   = RTC_SCENE_FLAG_COMPACT;
+    break;
+  case CRT_BuildProfile::REFIT: // Embree refits geometry only in dynamic scenes of low quality
+    m_sceneQuality = RTC_BUILD_QUALITY_LOW;
+    m_geomQuality  = RTC_BUILD_QUALITY_REFIT;
+    m_sceneFlags   = RTC_SCENE_FLAG_DYNAMIC;
+    break;
+  case CRT_BuildProfile::HIGH:
+  default:
+    m_sceneQuality = RTC_BUILD_QUALITY_HIGH;
+    m_geomQuality  = RTC_BUILD_QUALITY_HIGH;
+    m_sceneFlags   = RTC_SCENE_FLAG_NONE;
+    break;
+  }
+
+  if(a_robust)
+    m_sceneFlags = RTCSceneFlags(m_sceneFlags | RTC_SCENE_FLAG_ROBUST);
+
+  // existing top level gets new settings on the next commit
+  //
+  if(m_scene != nullptr)
+  {
+    rtcSetSceneBuildQuality(m_scene, m_sceneQuality);
+    rtcSetSceneFlags(m_scene, m_sceneFlags);
+  }
+}
+
 void EmbreeRT::ClearGeom()
 {
   for(auto& scn : m_blas)
     rtcReleaseScene(scn);
+  for(auto& mesh : m_meshGeom)
+  {
+    if(mesh.vertBuf != nullptr)
+      rtcReleaseBuffer(mesh.vertBuf);
+    if(mesh.indBuf != nullptr)
+      rtcReleaseBuffer(mesh.indBuf);
+  }
   
-  if(m_scene != nullptr)
-    rtcReleaseScene(m_scene);
-  m_scene = rtcNewScene(m_device);
-  rtcSetSceneBuildQuality(m_scene, RTC_BUILD_QUALITY_HIGH);
+  NewTopLevelScene();
 
   m_blas.resize(0);
+  m_meshGeom.resize(0);
+  m_pendingBlas.resize(0);
   m_inst.resize(0);
   m_geomIdByInstId.resize(0);
 }
@@ -110,41 +292,153 @@ uint32_t EmbreeRT::AddGeom_Triangles4f(const LiteMath::float4* a_vpos4f, size_t
   }
 
   RTCGeometry geom = rtcNewGeometry(m_device, RTC_GEOMETRY_TYPE_TRIANGLE);
+  RTCBuffer vertBuf = rtcNewBuffer(m_device, a_vertNumber*4*sizeof(float));
+  RTCBuffer indBuf  = rtcNewBuffer(m_device, a_indNumber*sizeof(unsigned));
+
+  memcpy(rtcGetBufferData(vertBuf), a_vpos4f,     a_vertNumber*4*sizeof(float));
+  memcpy(rtcGetBufferData(indBuf),  a_triIndices, a_indNumber*sizeof(unsigned));
+  AttachOwnBuffers(geom, vertBuf, a_vertNumber, indBuf, a_indNumber);
+
+  return AddMeshScene(geom, a_vertNumber, a_indNumber, vertBuf, indBuf);
+}
+
+void EmbreeRT::AttachOwnBuffers(RTCGeometry a_geom, RTCBuffer a_vertBuf, size_t a_vertNumber, RTCBuffer a_indBuf, size_t a_indNumber)
+{
+  rtcSetGeometryBuffer(a_geom, RTC_BUFFER_TYPE_VERTEX, 0, RTC_FORMAT_FLOAT3, a_vertBuf, 0, 4*sizeof(float),    a_vertNumber);
+  rtcSetGeometryBuffer(a_geom, RTC_BUFFER_TYPE_INDEX,  0, RTC_FORMAT_UINT3,  a_indBuf,  0, 3*sizeof(unsigned), a_indNumber/3);
+}
+
+uint32_t EmbreeRT::AddGeom_Triangles3fStrided(const void* a_vertData, size_t a_vertOffset, size_t a_vertStride, size_t a_vertNumber, 
+                                              const uint32_t* a_triIndices, size_t a_indNumber)
+{
+  if(a_vertData == nullptr)
+  {
+    std::cout << "EmbreeRT::AddGeom_Triangles3fStrided, nullptr input: a_vertData" << std::endl;
+    return uint32_t(-1);
+  }
+
+  if(a_triIndices == nullptr)
+  {
+    std::cout << "EmbreeRT::AddGeom_Triangles3fStrided, nullptr input: a_triIndices" << std::endl;
+    return uint32_t(-1);
+  }
 
-  float* vertices   = (float*)    rtcSetNewGeometryBuffer(geom, RTC_BUFFER_TYPE_VERTEX, 0, RTC_FORMAT_FLOAT3, 4*sizeof(float),    a_vertNumber);
-  unsigned* indices = (unsigned*) rtcSetNewGeometryBuffer(geom, RTC_BUFFER_TYPE_INDEX,  0,  RTC_FORMAT_UINT3, 3*sizeof(unsigned), a_indNumber/3);
+  // Embree reads vertex and index data directly from user memory, no copies are made
+  //
+  RTCGeometry geom = rtcNewGeometry(m_device, RTC_GEOMETRY_TYPE_TRIANGLE);
+  rtcSetSharedGeometryBuffer(geom, RTC_BUFFER_TYPE_VERTEX, 0, RTC_FORMAT_FLOAT3, a_vertData,   a_vertOffset, a_vertStride,       a_vertNumber);
+  rtcSetSharedGeometryBuffer(geom, RTC_BUFFER_TYPE_INDEX,  0, RTC_FORMAT_UINT3,  a_triIndices, 0,            3*sizeof(unsigned), a_indNumber/3);
 
-  memcpy(vertices, a_vpos4f, a_vertNumber*4*sizeof(float));
-  memcpy(indices,  a_triIndices, a_indNumber*sizeof(unsigned));
+  return AddMeshScene(geom, a_vertNumber, a_indNumber, nullptr, nullptr);
+}
 
-  rtcCommitGeometry(geom);
+uint32_t EmbreeRT::AddMeshScene(RTCGeometry a_geom, size_t a_vertNumber, size_t a_indNumber, RTCBuffer a_vertBuf, RTCBuffer a_indBuf)
+{
+  rtcSetGeometryBuildQuality(a_geom, m_geomQuality);
+  rtcCommitGeometry(a_geom);
 
   // attach 'geom' to 'meshScene' and then remember 'meshScene' in 'm_blas'
   //
   auto meshScene = rtcNewScene(m_device);
-  rtcSetSceneBuildQuality(meshScene, RTC_BUILD_QUALITY_HIGH);
+  rtcSetSceneBuildQuality(meshScene, m_sceneQuality);
+  rtcSetSceneFlags(meshScene, m_sceneFlags);
   
   /*uint32_t geomId = */
-  rtcAttachGeometry(meshScene, geom);
-  rtcReleaseGeometry(geom);
+  rtcAttachGeometry(meshScene, a_geom);
+  rtcReleaseGeometry(a_geom);
   m_blas.push_back(meshScene);
-
-  rtcCommitScene(meshScene);
+  m_meshGeom.push_back({a_geom, a_vertNumber, a_indNumber, a_vertNumber, a_indNumber, a_vertBuf, a_indBuf});
+  
+  // many small meshes are built serially much slower than together, so commit is deferred until CommitScene
+  //
+  m_pendingBlas.push_back(uint32_t(m_blas.size()-1));
   return uint32_t(m_blas.size()-1);
 }
 
 void EmbreeRT::UpdateGeom_Triangles4f(uint32_t a_geomId, const LiteMath::float4* a_vpos4f, size_t a_vertNumber, const uint32_t* a_triIndices, size_t a_indNumber)
 {
-  std::cout << "EmbreeRT::UpdateGeom_Triangles4f is not implemented yet!" << std::endl;  
+  if(a_geomId >= m_blas.size())
+  {
+    std::cout << "EmbreeRT::UpdateGeom_Triangles4f, bad geometry id: " << a_geomId << std::endl;
+    return;
+  }
+
+  if(a_vpos4f == nullptr || a_triIndices == nullptr)
+  {
+    std::cout << "EmbreeRT::UpdateGeom_Triangles4f, nullptr input" << std::endl;
+    return;
+  }
+
+  MeshGeom& mesh = m_meshGeom[a_geomId];
+  if(a_vertNumber > mesh.vertCapacity || a_indNumber > mesh.indCapacity)
+  {
+    std::cout << "EmbreeRT::UpdateGeom_Triangles4f, geometry can't grow: (" << a_vertNumber << ", " << a_indNumber << ") > (" 
+              << mesh.vertCapacity << ", " << mesh.indCapacity << ")" << std::endl;
+    return;
+  }
+
+  const unsigned* oldIndices = (const unsigned*)rtcGetGeometryBufferData(mesh.geom, RTC_BUFFER_TYPE_INDEX, 0);
+  const bool sameTopology = (a_vertNumber == mesh.vertNum) && (a_indNumber == mesh.indNum) && 
+                            (memcmp(oldIndices, a_triIndices, a_indNumber*sizeof(unsigned)) == 0);
+
+  // shared buffers are never written, geometry gets its own buffers of capacity size on the first update;
+  // own buffers are always updated in place, smaller geometry only changes the items count
+  //
+  const bool wasShared = (mesh.vertBuf == nullptr);
+  if(wasShared)
+  {
+    mesh.vertBuf = rtcNewBuffer(m_device, mesh.vertCapacity*4*sizeof(float));
+    mesh.indBuf  = rtcNewBuffer(m_device, mesh.indCapacity*sizeof(unsigned));
+  }
+
+  memcpy(rtcGetBufferData(mesh.vertBuf), a_vpos4f, a_vertNumber*4*sizeof(float));
+  if(!sameTopology || wasShared)
+    memcpy(rtcGetBufferData(mesh.indBuf), a_triIndices, a_indNumber*sizeof(unsigned));
+
+  if(a_vertNumber != mesh.vertNum || a_indNumber != mesh.indNum || wasShared)
+    AttachOwnBuffers(mesh.geom, mesh.vertBuf, a_vertNumber, mesh.indBuf, a_indNumber);
+  else
+  {
+    rtcUpdateGeometryBuffer(mesh.geom, RTC_BUFFER_TYPE_VERTEX, 0);
+    if(!sameTopology)
+      rtcUpdateGeometryBuffer(mesh.geom, RTC_BUFFER_TYPE_INDEX, 0);
+  }
+
+  // refit keeps BVH topology and only updates bounds; it is much faster than rebuild for deforming meshes.
+  // Embree refits geometry only in dynamic scenes of low quality, otherwise REFIT geometry quality is ignored
+  //
+  if(sameTopology)
+  {
+    rtcSetSceneBuildQuality(m_blas[a_geomId], RTC_BUILD_QUALITY_LOW);
+    rtcSetSceneFlags(m_blas[a_geomId], RTCSceneFlags(m_sceneFlags | RTC_SCENE_FLAG_DYNAMIC));
+    rtcSetGeometryBuildQuality(mesh.geom, RTC_BUILD_QUALITY_REFIT);
+  }
+  else
+    rtcSetGeometryBuildQuality(mesh.geom, (m_geomQuality == RTC_BUILD_QUALITY_REFIT) ? m_sceneQuality : m_geomQuality);
+
+  mesh.vertNum = a_vertNumber;
+  mesh.indNum  = a_indNumber;
+  const auto start = std::chrono::high_resolution_clock::now();
+  rtcCommitGeometry(mesh.geom);
+  rtcCommitScene(m_blas[a_geomId]);
+  const auto end = std::chrono::high_resolution_clock::now();
+  m_updateStats.blasNum++;
+  m_updateStats.blasBuildMs += std::chrono::duration<float, std::milli>(end - start).count();
+
+  // instances cache bounds of the instanced scene, so they should be committed too; the TLAS itself is rebuilt in CommitScene
+  //
+  for(size_t instId = 0; instId < m_inst.size(); instId++)
+  {
+    if(m_geomIdByInstId[instId] == a_geomId)
+      rtcCommitGeometry(m_inst[instId]);
+  }
 }
 
 void EmbreeRT::ClearScene()
 {
   m_inst.resize(0);
-  if(m_scene != nullptr)
-    rtcReleaseScene(m_scene);
-  m_scene = rtcNewScene(m_device);
-  rtcSetSceneBuildQuality(m_scene, RTC_BUILD_QUALITY_HIGH);
+  m_geomIdByInstId.resize(0);
+  NewTopLevelScene();
 } 
 
 uint32_t EmbreeRT::AddInstance(uint32_t a_geomId, const LiteMath::float4x4& a_matrix)
@@ -171,7 +465,46 @@ uint32_t EmbreeRT::AddInstance(uint32_t a_geomId, const LiteMath::float4x4& a_ma
 
 void EmbreeRT::CommitScene()
 {
+  const auto start = std::chrono::high_resolution_clock::now();
+
+  // large scenes are committed one by one, Embree builds each of them in parallel itself. Builds of small scenes hardly
+  // scale, so they are committed concurrently: each worker takes whole scenes. Workers are own threads instead of OpenMP ones,
+  // because Embree allows commits of different scenes from different application threads, but its scheduler is not meant
+  // to be entered from OpenMP worker threads.
+  //
+  const int pendingNum = int(m_pendingBlas.size());
+  std::vector<uint32_t> smallBlas;
+  for(uint32_t blasId : m_pendingBlas)
+  {
+    if(m_meshGeom[blasId].indNum / 3 >= SMALL_BLAS_TRIANGLES)
+      rtcCommitScene(m_blas[blasId]);
+    else
+      smallBlas.push_back(blasId);
+  }
+
+  std::atomic<size_t> nextSmall{0};
+  auto commitSmall = [&]() {
+    for(size_t i = nextSmall++; i < smallBlas.size(); i = nextSmall++)
+      rtcCommitScene(m_blas[smallBlas[i]]);
+  };
+  const size_t workersNum = std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u), smallBlas.size());
+  std::vector<std::thread> workers;
+  for(size_t i = 1; i < workersNum; i++)
+    workers.emplace_back(commitSmall);
+  commitSmall();
+  for(auto& worker : workers)
+    worker.join();
+  m_pendingBlas.resize(0);
+
+  const auto blasDone = std::chrono::high_resolution_clock::now();
   rtcCommitScene(m_scene);
+  const auto end = std::chrono::high_resolution_clock::now();
+
+  m_buildStats              = m_updateStats;
+  m_buildStats.blasNum     += uint32_t(pendingNum);
+  m_buildStats.blasBuildMs += std::chrono::duration<float, std::milli>(blasDone - start).count();
+  m_buildStats.tlasBuildMs  = std::chrono::duration<float, std::milli>(end - blasDone).count();
+  m_updateStats             = CRT_BuildStats();
 }  
 
 
@@ -184,6 +517,20 @@ void  EmbreeRT::UpdateInstance(uint32_t a_instanceId, const LiteMath::float4x4&
   rtcCommitGeometry(m_inst[a_instanceId]);
 }
 
+void EmbreeRT::UpdateInstances(const uint32_t* a_instanceIds, const LiteMath::float4x4* a_matrices, size_t a_count)
+{
+  // instance geometries are committed one by one, but the top level scene is committed once for all of them
+  //
+  for(size_t i = 0; i < a_count; i++)
+  {
+    if(a_instanceIds[i] >= m_inst.size())
+      continue;
+    rtcSetGeometryTransform(m_inst[a_instanceIds[i]], 0, RTC_FORMAT_FLOAT4X4_COLUMN_MAJOR, (const float*)&a_matrices[i]);
+    rtcCommitGeometry(m_inst[a_instanceIds[i]]);
+  }
+  CommitScene();
+}
+
 CRT_Hit  EmbreeRT::RayQuery_NearestHit(LiteMath::float4 posAndNear, LiteMath::float4 dirAndFar)
 {    
   // The intersect context can be used to set intersection
@@ -217,25 +564,29 @@ CRT_Hit  EmbreeRT::RayQuery_NearestHit(LiteMath::float4 posAndNear, LiteMath::fl
   // 
   rtcIntersect1(m_scene, &context, &rayhit);
 
+  return HitFromEmbree(rayhit.ray.tfar, rayhit.hit.geomID, rayhit.hit.instID[0], rayhit.hit.primID, rayhit.hit.u, rayhit.hit.v);
+}
+
+CRT_Hit EmbreeRT::HitFromEmbree(float a_tfar, unsigned a_geomID, unsigned a_instID, unsigned a_primID, float a_u, float a_v) const
+{
   CRT_Hit result;
-  if(rayhit.hit.geomID != RTC_INVALID_GEOMETRY_ID)
+  if(a_geomID != RTC_INVALID_GEOMETRY_ID)
   {
-    result.t      = rayhit.ray.tfar;
-    result.geomId = m_geomIdByInstId[rayhit.hit.instID[0]];
-    result.instId = rayhit.hit.instID[0];
-    result.primId = rayhit.hit.primID;
-    result.coords[1] = rayhit.hit.u;
-    result.coords[0] = rayhit.hit.v;
-    result.coords[2] = 1.0f - rayhit.hit.v - rayhit.hit.u;
+    result.t      = a_tfar;
+    result.geomId = m_geomIdByInstId[a_instID];
+    result.instId = a_instID;
+    result.primId = a_primID;
+    result.coords[1] = a_u;
+    result.coords[0] = a_v;
+    result.coords[2] = 1.0f - a_v - a_u;
   }
   else
   {
-    result.t      = rayhit.ray.tfar;
+    result.t      = a_tfar;
     result.geomId = uint32_t(-1);
     result.instId = uint32_t(-1);
     result.primId = uint32_t(-1);
   }
-
   return result;
 }
 
@@ -268,13 +619,117 @@ bool EmbreeRT::RayQuery_AnyHit(LiteMath::float4 posAndNear, LiteMath::float4 dir
   return (ray.tfar < 0.0f);
 }
 
-/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static inline void IntersectN(const int* valid, RTCScene scene, RTCIntersectContext* context, RTCRayHit4*  rayhit) { rtcIntersect4 (valid, scene, context, rayhit); }
+static inline void IntersectN(const int* valid, RTCScene scene, RTCIntersectContext* context, RTCRayHit8*  rayhit) { rtcIntersect8 (valid, scene, context, rayhit); }
+static inline void IntersectN(const int* valid, RTCScene scene, RTCIntersectContext* context, RTCRayHit16* rayhit) { rtcIntersect16(valid, scene, context, rayhit); }
 
-ISceneObject* CreateEmbreeRT() { return new EmbreeRT; }
+static inline void OccludedN(const int* valid, RTCScene scene, RTCIntersectContext* context, RTCRay4*  ray) { rtcOccluded4 (valid, scene, context, ray); }
+static inline void OccludedN(const int* valid, RTCScene scene, RTCIntersectContext* context, RTCRay8*  ray) { rtcOccluded8 (valid, scene, context, ray); }
+static inline void OccludedN(const int* valid, RTCScene scene, RTCIntersectContext* context, RTCRay16* ray) { rtcOccluded16(valid, scene, context, ray); }
 
-ISceneObject* CreateSceneRT(const char* a_impleName) 
-{ 
-  return CreateEmbreeRT();
+template<int N, typename RayN>
+static inline void FillRayPacket(RayN& ray, int* valid, const CRT_RaysSoA& a_rays, size_t a_start, size_t a_packetSize)
+{
+  for(size_t i = 0; i < N; i++)
+  {
+    const size_t rayId = a_start + std::min(i, a_packetSize - 1); // replicate last ray into inactive lanes
+    valid[i] = (i < a_packetSize) ? -1 : 0;
+
+    ray.org_x[i] = a_rays.orgX [rayId];
+    ray.org_y[i] = a_rays.orgY [rayId];
+    ray.org_z[i] = a_rays.orgZ [rayId];
+    ray.tnear[i] = a_rays.tNear[rayId];
+    ray.dir_x[i] = a_rays.dirX [rayId];
+    ray.dir_y[i] = a_rays.dirY [rayId];
+    ray.dir_z[i] = a_rays.dirZ [rayId];
+    ray.tfar [i] = a_rays.tFar [rayId];
+    ray.time [i] = 0.0f;
+    ray.mask [i] = -1;
+    ray.id   [i] = uint32_t(i);
+    ray.flags[i] = 0;
+  }
+}
+
+template<int N, typename RayHitN>
+void EmbreeRT::NearestHitPackets(const CRT_RaysSoA& a_rays, CRT_Hit* out_hits)
+{
+  // one context per batch instead of one per ray
+  //
+  struct RTCIntersectContext context;
+  rtcInitIntersectContext(&context);
+  context.flags = RTC_INTERSECT_CONTEXT_FLAG_COHERENT;
+
+  alignas(64) RayHitN rayhit;
+  alignas(64) int valid[N];
+
+  for(size_t start = 0; start < a_rays.count; start += N)
+  {
+    const size_t packetSize = std::min(size_t(N), a_rays.count - start);
+    FillRayPacket<N>(rayhit.ray, valid, a_rays, start, packetSize);
+    for(size_t i = 0; i < N; i++)
+    {
+      rayhit.hit.geomID   [i] = RTC_INVALID_GEOMETRY_ID;
+      rayhit.hit.instID[0][i] = RTC_INVALID_GEOMETRY_ID;
+    }
+
+    IntersectN(valid, m_scene, &context, &rayhit);
+
+    for(size_t i = 0; i < packetSize; i++)
+      out_hits[start + i] = HitFromEmbree(rayhit.ray.tfar[i], rayhit.hit.geomID[i], rayhit.hit.instID[0][i], rayhit.hit.primID[i], rayhit.hit.u[i], rayhit.hit.v[i]);
+  }
+}
+
+template<int N, typename RayN>
+void EmbreeRT::AnyHitPackets(const CRT_RaysSoA& a_rays, bool* out_hits)
+{
+  struct RTCIntersectContext context;
+  rtcInitIntersectContext(&context);
+  context.flags = RTC_INTERSECT_CONTEXT_FLAG_COHERENT;
+
+  alignas(64) RayN ray;
+  alignas(64) int valid[N];
+
+  for(size_t start = 0; start < a_rays.count; start += N)
+  {
+    const size_t packetSize = std::min(size_t(N), a_rays.count - start);
+    FillRayPacket<N>(ray, valid, a_rays, start, packetSize);
+
+    OccludedN(valid, m_scene, &context, &ray);
+
+    for(size_t i = 0; i < packetSize; i++)
+      out_hits[start + i] = (ray.tfar[i] < 0.0f);
+  }
+}
+
+void EmbreeRT::RayQuery_NearestHitBatch(const CRT_RaysSoA& a_rays, CRT_Hit* out_hits)
+{
+  switch(m_packetSize)
+  {
+  case 16: NearestHitPackets<16, RTCRayHit16>(a_rays, out_hits); break;
+  case 8 : NearestHitPackets<8,  RTCRayHit8> (a_rays, out_hits); break;
+  case 4 : NearestHitPackets<4,  RTCRayHit4> (a_rays, out_hits); break;
+  default: ISceneObject::RayQuery_NearestHitBatch(a_rays, out_hits); break;
+  }
 }
 
-void DeleteSceneRT(ISceneObject* a_pScene)  { delete a_pScene; }
\ No newline at end of file
+void EmbreeRT::RayQuery_AnyHitBatch(const CRT_RaysSoA& a_rays, bool* out_hits)
+{
+  switch(m_packetSize)
+  {
+  case 16: AnyHitPackets<16, RTCRay16>(a_rays, out_hits); break;
+  case 8 : AnyHitPackets<8,  RTCRay8> (a_rays, out_hits); break;
+  case 4 : AnyHitPackets<4,  RTCRay4> (a_rays, out_hits); break;
+  default: ISceneObject::RayQuery_AnyHitBatch(a_rays, out_hits); break;
+  }
+}
+
+CRT_MemoryStats EmbreeRT::GetMemoryStats() const
+{
+  CRT_MemoryStats stats;
+  stats.totalBytes = size_t(std::max<int64_t>(m_memoryUsed.load(), 0));
+  return stats;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+ISceneObject* CreateEmbreeRT() { return new EmbreeRT; }
\ No newline at end of file
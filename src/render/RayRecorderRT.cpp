@@ -0,0 +1,157 @@
+#include "RayRecorderRT.h"
+
+#include <cstring>
+#include <iostream>
+
+static const char RAY_LOG_MAGIC[8] = {'C', 'R', 'T', 'R', 'A', 'Y', 'S', '\0'};
+
+RayRecorderRT::RayRecorderRT(std::shared_ptr<ISceneObject> a_pScene, const std::string& a_path) : m_pScene(a_pScene)
+{
+  m_file.open(a_path, std::ios::binary | std::ios::trunc);
+  if(!m_file.is_open())
+  {
+    std::cout << "RayRecorderRT: can't open " << a_path << " for writing, rays are not recorded" << std::endl;
+    return;
+  }
+
+  CRT_RayLogHeader header = {};
+  memcpy(header.magic, RAY_LOG_MAGIC, sizeof(header.magic));
+  header.version = CRT_RAY_LOG_VERSION;
+  m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+RayRecorderRT::~RayRecorderRT()
+{
+  std::lock_guard<std::mutex> guard(m_lock);
+  FlushChunk(CRT_RAY_QUERY_NEAREST);
+  FlushChunk(CRT_RAY_QUERY_ANY);
+}
+
+void RayRecorderRT::FlushChunk(CRT_RayQueryType a_type)
+{
+  ChunkData& chunk = m_chunks[a_type];
+  if(chunk.Size() == 0 || !m_file.is_open())
+    return;
+
+  CRT_RayLogChunk chunkHeader = {};
+  chunkHeader.queryType = a_type;
+  chunkHeader.raysNum   = uint32_t(chunk.Size());
+  m_file.write(reinterpret_cast<const char*>(&chunkHeader), sizeof(chunkHeader));
+  for(auto& arr : chunk.arrays)
+  {
+    m_file.write(reinterpret_cast<const char*>(arr.data()), arr.size() * sizeof(float));
+    arr.clear();
+  }
+}
+
+void RayRecorderRT::Record(CRT_RayQueryType a_type, const LiteMath::float4& a_posAndNear, const LiteMath::float4& a_dirAndFar)
+{
+  std::lock_guard<std::mutex> guard(m_lock);
+  ChunkData& chunk = m_chunks[a_type];
+  for(int i = 0; i < 4; i++)
+  {
+    chunk.arrays[i + 0].push_back(a_posAndNear[i]);
+    chunk.arrays[i + 4].push_back(a_dirAndFar[i]);
+  }
+  m_recordedNum++;
+  if(chunk.Size() >= CHUNK_RAYS)
+    FlushChunk(a_type);
+}
+
+void RayRecorderRT::Record(CRT_RayQueryType a_type, const CRT_RaysSoA& a_rays)
+{
+  const float* src[8] = {a_rays.orgX, a_rays.orgY, a_rays.orgZ, a_rays.tNear, a_rays.dirX, a_rays.dirY, a_rays.dirZ, a_rays.tFar};
+
+  std::lock_guard<std::mutex> guard(m_lock);
+  ChunkData& chunk = m_chunks[a_type];
+  for(int i = 0; i < 8; i++)
+    chunk.arrays[i].insert(chunk.arrays[i].end(), src[i], src[i] + a_rays.count);
+  m_recordedNum += a_rays.count;
+  if(chunk.Size() >= CHUNK_RAYS)
+    FlushChunk(a_type);
+}
+
+CRT_Hit RayRecorderRT::RayQuery_NearestHit(LiteMath::float4 posAndNear, LiteMath::float4 dirAndFar)
+{
+  Record(CRT_RAY_QUERY_NEAREST, posAndNear, dirAndFar);
+  return m_pScene->RayQuery_NearestHit(posAndNear, dirAndFar);
+}
+
+bool RayRecorderRT::RayQuery_AnyHit(LiteMath::float4 posAndNear, LiteMath::float4 dirAndFar)
+{
+  Record(CRT_RAY_QUERY_ANY, posAndNear, dirAndFar);
+  return m_pScene->RayQuery_AnyHit(posAndNear, dirAndFar);
+}
+
+void RayRecorderRT::RayQuery_NearestHitBatch(const CRT_RaysSoA& a_rays, CRT_Hit* out_hits)
+{
+  Record(CRT_RAY_QUERY_NEAREST, a_rays);
+  m_pScene->RayQuery_NearestHitBatch(a_rays, out_hits);
+}
+
+void RayRecorderRT::RayQuery_AnyHitBatch(const CRT_RaysSoA& a_rays, bool* out_hits)
+{
+  Record(CRT_RAY_QUERY_ANY, a_rays);
+  m_pScene->RayQuery_AnyHitBatch(a_rays, out_hits);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool RayLogReader::Open(const std::string& a_path)
+{
+  m_chunks.clear();
+  if(!m_file.Open(a_path))
+  {
+    std::cout << "RayLogReader: can't open " << a_path << std::endl;
+    return false;
+  }
+
+  const auto* header = m_file.At<CRT_RayLogHeader>(0);
+  if(m_file.Size() < sizeof(CRT_RayLogHeader) || memcmp(header->magic, RAY_LOG_MAGIC, sizeof(header->magic)) != 0 || header->version != CRT_RAY_LOG_VERSION)
+  {
+    std::cout << "RayLogReader: " << a_path << " is not a ray log of version " << CRT_RAY_LOG_VERSION << std::endl;
+    m_file.Close();
+    return false;
+  }
+
+  size_t offset = sizeof(CRT_RayLogHeader);
+  while(offset + sizeof(CRT_RayLogChunk) <= m_file.Size())
+  {
+    const auto* chunkHeader = m_file.At<CRT_RayLogChunk>(offset);
+    const size_t raysNum    = chunkHeader->raysNum;
+    const size_t dataOffset = offset + sizeof(CRT_RayLogChunk);
+    if(chunkHeader->queryType > CRT_RAY_QUERY_ANY || dataOffset + raysNum * 8 * sizeof(float) > m_file.Size())
+    {
+      std::cout << "RayLogReader: " << a_path << " is truncated at offset " << offset << ", the rest is ignored" << std::endl;
+      break;
+    }
+
+    const float* data = m_file.At<float>(dataOffset);
+    Chunk chunk;
+    chunk.type       = CRT_RayQueryType(chunkHeader->queryType);
+    chunk.rays.orgX  = data + 0 * raysNum;
+    chunk.rays.orgY  = data + 1 * raysNum;
+    chunk.rays.orgZ  = data + 2 * raysNum;
+    chunk.rays.tNear = data + 3 * raysNum;
+    chunk.rays.dirX  = data + 4 * raysNum;
+    chunk.rays.dirY  = data + 5 * raysNum;
+    chunk.rays.dirZ  = data + 6 * raysNum;
+    chunk.rays.tFar  = data + 7 * raysNum;
+    chunk.rays.count = raysNum;
+    m_chunks.push_back(chunk);
+
+    offset = dataOffset + raysNum * 8 * sizeof(float);
+  }
+
+  return true;
+}
+
+size_t RayLogReader::RaysNum(CRT_RayQueryType a_type) const
+{
+  size_t res = 0;
+  for(const auto& chunk : m_chunks)
+    if(chunk.type == a_type)
+      res += chunk.rays.count;
+  return res;
+}
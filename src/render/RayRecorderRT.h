@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "CrossRT.h"
+#include "utils/mapped_file.h"
+
+/**
+\brief Ray log file layout: CRT_RayLogHeader, then chunks. Each chunk is CRT_RayLogChunk followed by 8 float arrays
+of 'raysNum' elements in CRT_RaysSoA order: orgX, orgY, orgZ, tNear, dirX, dirY, dirZ, tFar.
+So, chunk data can be passed to batched ray queries directly from the mapped file.
+*/
+struct CRT_RayLogHeader
+{
+  char     magic[8];       ///< "CRTRAYS\0"
+  uint32_t version;        ///< CRT_RAY_LOG_VERSION
+  uint32_t reserved;
+};
+
+enum CRT_RayQueryType : uint32_t
+{
+  CRT_RAY_QUERY_NEAREST = 0, ///< RayQuery_NearestHit
+  CRT_RAY_QUERY_ANY     = 1, ///< RayQuery_AnyHit
+};
+
+struct CRT_RayLogChunk
+{
+  uint32_t queryType;      ///< CRT_RayQueryType
+  uint32_t raysNum;
+};
+
+static constexpr uint32_t CRT_RAY_LOG_VERSION = 1;
+
+/**
+\brief Forwards all calls to another ISceneObject and writes every queried ray to a ray log file.
+Rays are written in the order they are issued, but nearest and any hit queries are grouped in separate chunks.
+Rays of concurrent queries are serialized with a lock, so recording slows down multithreaded tracing.
+*/
+class RayRecorderRT : public ISceneObject
+{
+public:
+  RayRecorderRT(std::shared_ptr<ISceneObject> a_pScene, const std::string& a_path);
+  ~RayRecorderRT() override;
+
+  void     ClearGeom() override                                                 { m_pScene->ClearGeom(); }
+  void     SetBuildProfile(CRT_BuildProfile a_profile, bool a_robust) override  { m_pScene->SetBuildProfile(a_profile, a_robust); }
+  uint32_t AddGeom_Triangles4f(const LiteMath::float4* a_vpos4f, size_t a_vertNumber, const uint32_t* a_triIndices, size_t a_indNumber) override
+  {
+    return m_pScene->AddGeom_Triangles4f(a_vpos4f, a_vertNumber, a_triIndices, a_indNumber);
+  }
+  uint32_t AddGeom_Triangles3fStrided(const void* a_vertData, size_t a_vertOffset, size_t a_vertStride, size_t a_vertNumber,
+                                      const uint32_t* a_triIndices, size_t a_indNumber) override
+  {
+    return m_pScene->AddGeom_Triangles3fStrided(a_vertData, a_vertOffset, a_vertStride, a_vertNumber, a_triIndices, a_indNumber);
+  }
+  void     UpdateGeom_Triangles4f(uint32_t a_geomId, const LiteMath::float4* a_vpos4f, size_t a_vertNumber, const uint32_t* a_triIndices, size_t a_indNumber) override
+  {
+    m_pScene->UpdateGeom_Triangles4f(a_geomId, a_vpos4f, a_vertNumber, a_triIndices, a_indNumber);
+  }
+  void     ClearScene()  override                                                      { m_pScene->ClearScene(); }
+  void     CommitScene() override                                                      { m_pScene->CommitScene(); }
+  uint32_t AddInstance(uint32_t a_geomId, const LiteMath::float4x4& a_matrix) override { return m_pScene->AddInstance(a_geomId, a_matrix); }
+  void     UpdateInstance(uint32_t a_instanceId, const LiteMath::float4x4& a_matrix) override { m_pScene->UpdateInstance(a_instanceId, a_matrix); }
+  void     UpdateInstances(const uint32_t* a_instanceIds, const LiteMath::float4x4* a_matrices, size_t a_count) override
+  {
+    m_pScene->UpdateInstances(a_instanceIds, a_matrices, a_count);
+  }
+
+  CRT_Hit  RayQuery_NearestHit(LiteMath::float4 posAndNear, LiteMath::float4 dirAndFar) override;
+  bool     RayQuery_AnyHit(LiteMath::float4 posAndNear, LiteMath::float4 dirAndFar) override;
+  void     RayQuery_NearestHitBatch(const CRT_RaysSoA& a_rays, CRT_Hit* out_hits) override;
+  void     RayQuery_AnyHitBatch(const CRT_RaysSoA& a_rays, bool* out_hits) override;
+
+  CRT_MemoryStats GetMemoryStats() const override { return m_pScene->GetMemoryStats(); }
+  CRT_BuildStats  GetBuildStats()  const override { return m_pScene->GetBuildStats(); }
+
+  size_t RecordedRaysNum() const { return m_recordedNum; }
+
+private:
+  struct ChunkData
+  {
+    std::vector<float> arrays[8]; ///< in CRT_RaysSoA order
+    size_t Size() const { return arrays[0].size(); }
+  };
+
+  void Record(CRT_RayQueryType a_type, const LiteMath::float4& a_posAndNear, const LiteMath::float4& a_dirAndFar);
+  void Record(CRT_RayQueryType a_type, const CRT_RaysSoA& a_rays);
+  void FlushChunk(CRT_RayQueryType a_type); ///< must be called under m_lock
+
+  static constexpr size_t CHUNK_RAYS = 65536;
+
+  std::shared_ptr<ISceneObject> m_pScene;
+  std::ofstream                 m_file;
+  std::mutex                    m_lock;
+  ChunkData                     m_chunks[2]; ///< indexed by CRT_RayQueryType
+  size_t                        m_recordedNum = 0;
+};
+
+/**
+\brief Memory-mapped ray log for replay; CRT_RaysSoA of every chunk points directly to the mapped file
+*/
+class RayLogReader
+{
+public:
+  struct Chunk
+  {
+    CRT_RayQueryType type;
+    CRT_RaysSoA      rays;
+  };
+
+  bool Open(const std::string& a_path); ///< returns false and prints message if file is absent or corrupted
+
+  const std::vector<Chunk>& Chunks() const { return m_chunks; }
+  size_t RaysNum(CRT_RayQueryType a_type) const;
+
+private:
+  MappedFile         m_file;
+  std::vector<Chunk> m_chunks;
+};
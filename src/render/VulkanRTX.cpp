@@ -81,7 +81,15 @@ void VulkanRTX::CommitScene()
 
 void VulkanRTX::UpdateInstance(uint32_t a_instanceId, const LiteMath::float4x4& a_matrix)
 {
-  std::cout << "[VulkanRTX::UpdateInstance]: not implemented" << std::endl;
+  UpdateInstances(&a_instanceId, &a_matrix, 1);
+}
+
+// only entries of moved instances are copied to the instance buffer, then top level is refitted in place without touching BLAS
+void VulkanRTX::UpdateInstances(const uint32_t* a_instanceIds, const LiteMath::float4x4* a_matrices, size_t a_count)
+{
+  m_pScnMgr->UpdateInstanceMatrices(a_instanceIds, a_matrices, a_count);
+  m_pScnMgr->UpdateTLAS(a_instanceIds, a_count);
+  m_accel = m_pScnMgr->GetTLAS();
 }
 
 CRT_Hit VulkanRTX::RayQuery_NearestHit(LiteMath::float4 posAndNear, LiteMath::float4 dirAndFar)
@@ -0,0 +1,485 @@
+#include "cbvh.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+namespace cbvh
+{
+  static constexpr uint32_t MAX_BINS = 64;
+
+  struct SAHBin
+  {
+    Box3f    box;
+    uint32_t count = 0;
+  };
+
+  struct BuildContext
+  {
+    const Box3f*          primBoxes;
+    std::vector<float3>   centers;
+    BuildSettings         settings;
+    BVHNode*              nodes;
+    uint32_t*             indices;
+    std::atomic<uint32_t> nodesNum{1};
+  };
+
+  static void MakeLeaf(BVHNode& a_node, uint32_t a_begin, uint32_t a_count)
+  {
+    a_node.leftOffset = a_begin;
+    a_node.primsCount = a_count;
+  }
+
+  static uint32_t CeilLog2(uint32_t a_value)
+  {
+    uint32_t res = 0;
+    while((1ull << res) < a_value)
+      res++;
+    return res;
+  }
+
+  static void BuildNode(BuildContext& ctx, uint32_t a_nodeId, uint32_t a_begin, uint32_t a_end, uint32_t a_depth)
+  {
+    Box3f nodeBox, centerBox;
+    for(uint32_t i = a_begin; i < a_end; i++)
+    {
+      nodeBox.include(ctx.primBoxes[ctx.indices[i]]);
+      centerBox.include(ctx.centers[ctx.indices[i]]);
+    }
+
+    BVHNode& node = ctx.nodes[a_nodeId];
+    node.boxMin = nodeBox.boxMin;
+    node.boxMax = nodeBox.boxMax;
+
+    const uint32_t count   = a_end - a_begin;
+    const uint32_t maxLeaf = std::min(ctx.settings.maxPrimsInLeaf, MAX_PRIMS_IN_LEAF);
+    if(count == 1)
+    {
+      MakeLeaf(node, a_begin, count);
+      return;
+    }
+
+    // degenerate inputs can make SAH splits very unbalanced; median split halves the primitives, so the rest of subtree
+    // gets exactly CeilLog2(count) levels deep and the whole tree never exceeds MAX_TREE_DEPTH
+    //
+    if(a_depth + CeilLog2(count) >= MAX_TREE_DEPTH)
+    {
+      const float3 extent = centerBox.boxMax - centerBox.boxMin;
+      const int    axis   = (extent.x >= extent.y && extent.x >= extent.z) ? 0 : (extent.y >= extent.z ? 1 : 2);
+      const uint32_t middle = a_begin + count / 2;
+      std::nth_element(ctx.indices + a_begin, ctx.indices + middle, ctx.indices + a_end, [&](uint32_t a, uint32_t b) {
+        return ctx.centers[a][axis] < ctx.centers[b][axis];
+      });
+
+      const uint32_t leftId = ctx.nodesNum.fetch_add(2);
+      node.leftOffset = leftId;
+      node.primsCount = 0;
+      BuildNode(ctx, leftId,     a_begin, middle, a_depth + 1);
+      BuildNode(ctx, leftId + 1, middle,  a_end,  a_depth + 1);
+      return;
+    }
+
+    // find the best split plane among bins borders of all 3 axes
+    //
+    const uint32_t binsNum = std::max(2u, std::min(ctx.settings.binsNum, MAX_BINS));
+    float    bestCost  = std::numeric_limits<float>::max();
+    int      bestAxis  = -1;
+    uint32_t bestSplit = 0;
+
+    for(int axis = 0; axis < 3; axis++)
+    {
+      const float lo     = centerBox.boxMin[axis];
+      const float extent = centerBox.boxMax[axis] - lo;
+      if(extent <= 0.0f)
+        continue;
+
+      const float scale = float(binsNum) * (1.0f - 1e-5f) / extent;
+      SAHBin bins[MAX_BINS];
+      for(uint32_t i = a_begin; i < a_end; i++)
+      {
+        const uint32_t primId = ctx.indices[i];
+        const uint32_t binId  = std::min(binsNum - 1, uint32_t(scale * (ctx.centers[primId][axis] - lo)));
+        bins[binId].count++;
+        bins[binId].box.include(ctx.primBoxes[primId]);
+      }
+
+      float    rightArea [MAX_BINS];
+      uint32_t rightCount[MAX_BINS];
+      Box3f    acc;
+      uint32_t accCount = 0;
+      for(uint32_t b = binsNum - 1; b > 0; b--)
+      {
+        acc.include(bins[b].box);
+        accCount     += bins[b].count;
+        rightArea[b]  = acc.halfArea();
+        rightCount[b] = accCount;
+      }
+
+      acc      = Box3f();
+      accCount = 0;
+      for(uint32_t b = 0; b < binsNum - 1; b++)
+      {
+        acc.include(bins[b].box);
+        accCount += bins[b].count;
+        if(accCount == 0 || rightCount[b + 1] == 0)
+          continue;
+        const float cost = acc.halfArea() * float(accCount) + rightArea[b + 1] * float(rightCount[b + 1]);
+        if(cost < bestCost)
+        {
+          bestCost  = cost;
+          bestAxis  = axis;
+          bestSplit = b + 1;
+        }
+      }
+    }
+
+    const float nodeArea  = nodeBox.halfArea();
+    const float splitCost = ctx.settings.traversalCost + (nodeArea > 0.0f ? bestCost / nodeArea : bestCost);
+    const float leafCost  = float(count);
+
+    if(count <= maxLeaf && (bestAxis < 0 || leafCost <= splitCost))
+    {
+      MakeLeaf(node, a_begin, count);
+      return;
+    }
+
+    uint32_t middle = a_begin + count / 2;
+    if(bestAxis >= 0)
+    {
+      const float lo    = centerBox.boxMin[bestAxis];
+      const float scale = float(binsNum) * (1.0f - 1e-5f) / (centerBox.boxMax[bestAxis] - lo);
+      uint32_t* pivot   = std::partition(ctx.indices + a_begin, ctx.indices + a_end, [&](uint32_t primId) {
+        return std::min(binsNum - 1, uint32_t(scale * (ctx.centers[primId][bestAxis] - lo))) < bestSplit;
+      });
+      middle = uint32_t(pivot - ctx.indices);
+    }
+    else if(count <= MAX_PRIMS_IN_LEAF) // all centers are equal, no sense to split further
+    {
+      MakeLeaf(node, a_begin, count);
+      return;
+    }
+
+    const uint32_t leftId = ctx.nodesNum.fetch_add(2);
+    node.leftOffset = leftId;
+    node.primsCount = 0;
+
+    if(count > ctx.settings.parallelThreshold)
+    {
+      #pragma omp task default(none) shared(ctx) firstprivate(leftId, a_begin, middle, a_depth)
+      BuildNode(ctx, leftId, a_begin, middle, a_depth + 1);
+    }
+    else
+      BuildNode(ctx, leftId, a_begin, middle, a_depth + 1);
+
+    BuildNode(ctx, leftId + 1, middle, a_end, a_depth + 1);
+  }
+
+  BVHTree BuildBVH2(const Box3f* a_primBoxes, size_t a_primsNum, const BuildSettings& a_settings)
+  {
+    BVHTree tree;
+    if(a_primsNum == 0)
+      return tree;
+
+    const int primsNum = int(a_primsNum);
+    tree.nodes.resize(2 * a_primsNum - 1);
+    tree.primIndices.resize(a_primsNum);
+
+    BuildContext ctx;
+    ctx.primBoxes = a_primBoxes;
+    ctx.settings  = a_settings;
+    ctx.nodes     = tree.nodes.data();
+    ctx.indices   = tree.primIndices.data();
+    ctx.centers.resize(a_primsNum);
+
+    #pragma omp parallel for
+    for(int i = 0; i < primsNum; i++)
+    {
+      ctx.centers[i] = a_primBoxes[i].center();
+      ctx.indices[i] = uint32_t(i);
+    }
+
+    if(a_primsNum > a_settings.parallelThreshold)
+    {
+      #pragma omp parallel default(none) shared(ctx, primsNum)
+      {
+        #pragma omp single
+        BuildNode(ctx, 0, 0, uint32_t(primsNum), 0);
+      }
+    }
+    else
+      BuildNode(ctx, 0, 0, uint32_t(primsNum), 0);
+
+    tree.nodes.resize(ctx.nodesNum.load());
+    tree.nodes.shrink_to_fit();
+    return tree;
+  }
+
+  void RefitBVH2(BVHTree& a_tree, const Box3f* a_primBoxes)
+  {
+    // children are always allocated after their parent, so reverse order visits children first
+    for(size_t i = a_tree.nodes.size(); i > 0; i--)
+    {
+      BVHNode& node = a_tree.nodes[i - 1];
+      Box3f box;
+      if(node.primsCount > 0)
+      {
+        for(uint32_t j = 0; j < node.primsCount; j++)
+          box.include(a_primBoxes[a_tree.primIndices[node.leftOffset + j]]);
+      }
+      else
+      {
+        const BVHNode& left  = a_tree.nodes[node.leftOffset];
+        const BVHNode& right = a_tree.nodes[node.leftOffset + 1];
+        box.include(Box3f(left.boxMin,  left.boxMax));
+        box.include(Box3f(right.boxMin, right.boxMax));
+      }
+      node.boxMin = box.boxMin;
+      node.boxMax = box.boxMax;
+    }
+  }
+
+  static void SetChild4(BVH4Node& a_node, int a_slot, const Box3f& a_box, uint32_t a_child)
+  {
+    a_node.boxMinX[a_slot] = a_box.boxMin.x;
+    a_node.boxMinY[a_slot] = a_box.boxMin.y;
+    a_node.boxMinZ[a_slot] = a_box.boxMin.z;
+    a_node.boxMaxX[a_slot] = a_box.boxMax.x;
+    a_node.boxMaxY[a_slot] = a_box.boxMax.y;
+    a_node.boxMaxZ[a_slot] = a_box.boxMax.z;
+    a_node.child[a_slot]   = a_child;
+  }
+
+  static Box3f ChildBox4(const BVH4Node& a_node, int a_slot)
+  {
+    return Box3f(float3(a_node.boxMinX[a_slot], a_node.boxMinY[a_slot], a_node.boxMinZ[a_slot]),
+                 float3(a_node.boxMaxX[a_slot], a_node.boxMaxY[a_slot], a_node.boxMaxZ[a_slot]));
+  }
+
+  static BVH4Node EmptyNode4()
+  {
+    const float inf = std::numeric_limits<float>::infinity();
+    BVH4Node node;
+    for(int i = 0; i < 4; i++)
+      SetChild4(node, i, Box3f(float3(inf), float3(inf)), BVH4_EMPTY);
+    return node;
+  }
+
+  BVH4Tree CollapseBVH4(const BVHTree& a_bvh2)
+  {
+    BVH4Tree tree;
+    if(a_bvh2.nodes.empty() || a_bvh2.primIndices.size() > BVH4_MAX_PRIMS)
+      return tree;
+    tree.primIndices = a_bvh2.primIndices;
+
+    struct CollapseTask
+    {
+      uint32_t bvh2Node;
+      uint32_t bvh4Node;
+    };
+
+    std::vector<CollapseTask> stack;
+    tree.nodes.reserve(a_bvh2.nodes.size() / 2 + 1);
+    tree.nodes.push_back(EmptyNode4());
+    stack.push_back({0, 0});
+
+    while(!stack.empty())
+    {
+      const CollapseTask task = stack.back();
+      stack.pop_back();
+
+      // the root may be a leaf itself, then it becomes the only child of BVH4 root
+      //
+      const BVHNode& src = a_bvh2.nodes[task.bvh2Node];
+      uint32_t children[4];
+      int childrenNum = 0;
+      if(src.primsCount != 0)
+        children[childrenNum++] = task.bvh2Node;
+      else
+      {
+        children[childrenNum++] = src.leftOffset;
+        children[childrenNum++] = src.leftOffset + 1;
+      }
+
+      while(childrenNum < 4)
+      {
+        int   bestSlot = -1;
+        float bestArea = -1.0f;
+        for(int i = 0; i < childrenNum; i++)
+        {
+          const BVHNode& child = a_bvh2.nodes[children[i]];
+          const float    area  = Box3f(child.boxMin, child.boxMax).halfArea();
+          if(child.primsCount == 0 && area > bestArea)
+          {
+            bestArea = area;
+            bestSlot = i;
+          }
+        }
+        if(bestSlot < 0)
+          break;
+        const uint32_t expanded = children[bestSlot];
+        children[bestSlot]        = a_bvh2.nodes[expanded].leftOffset;
+        children[childrenNum++]   = a_bvh2.nodes[expanded].leftOffset + 1;
+      }
+
+      for(int i = 0; i < childrenNum; i++)
+      {
+        const BVHNode& child = a_bvh2.nodes[children[i]];
+        uint32_t childRef;
+        if(child.primsCount != 0)
+        {
+          if(child.leftOffset > BVH4_OFFSET_MASK) // would overflow to the count bits
+            return BVH4Tree();
+          childRef = PackLeaf4(child.leftOffset, child.primsCount);
+        }
+        else
+        {
+          childRef = uint32_t(tree.nodes.size());
+          tree.nodes.push_back(EmptyNode4());
+          stack.push_back({children[i], childRef});
+        }
+        SetChild4(tree.nodes[task.bvh4Node], i, Box3f(child.boxMin, child.boxMax), childRef);
+      }
+    }
+
+    tree.nodes.shrink_to_fit();
+    return tree;
+  }
+
+  void RefitBVH4(BVH4Tree& a_tree, const Box3f* a_primBoxes)
+  {
+    // as for binary tree, children are always allocated after their parent
+    for(size_t i = a_tree.nodes.size(); i > 0; i--)
+    {
+      BVH4Node& node = a_tree.nodes[i - 1];
+      for(int slot = 0; slot < 4; slot++)
+      {
+        const uint32_t child = node.child[slot];
+        if(child == BVH4_EMPTY)
+          continue;
+
+        Box3f box;
+        if(IsLeaf4(child))
+        {
+          for(uint32_t j = 0; j < LeafCount4(child); j++)
+            box.include(a_primBoxes[a_tree.primIndices[LeafFirst4(child) + j]]);
+        }
+        else
+        {
+          const BVH4Node& childNode = a_tree.nodes[child];
+          for(int k = 0; k < 4; k++)
+          {
+            if(childNode.child[k] != BVH4_EMPTY)
+              box.include(ChildBox4(childNode, k));
+          }
+        }
+        SetChild4(node, slot, box, child);
+      }
+    }
+  }
+
+  static Box3f ChildBox4Q(const BVH4QNode& a_node, int a_slot)
+  {
+    const float3 origin(a_node.origin[0], a_node.origin[1], a_node.origin[2]);
+    const float3 scale (a_node.scale[0],  a_node.scale[1],  a_node.scale[2]);
+    return Box3f(origin + float3(a_node.qMinX[a_slot], a_node.qMinY[a_slot], a_node.qMinZ[a_slot]) * scale,
+                 origin + float3(a_node.qMaxX[a_slot], a_node.qMaxY[a_slot], a_node.qMaxZ[a_slot]) * scale);
+  }
+
+  // round down for minimum and up for maximum and fix floating point errors, so that decoded box always encloses the source one
+  //
+  static void QuantizeAxis(float a_origin, float a_scale, float a_min, float a_max, uint8_t& a_qMin, uint8_t& a_qMax)
+  {
+    int qMin = std::max(0,   int(std::floor((a_min - a_origin) / a_scale)));
+    int qMax = std::min(255, int(std::ceil ((a_max - a_origin) / a_scale)));
+    while(qMin > 0   && a_origin + float(qMin) * a_scale > a_min) qMin--;
+    while(qMax < 255 && a_origin + float(qMax) * a_scale < a_max) qMax++;
+    a_qMin = uint8_t(qMin);
+    a_qMax = uint8_t(qMax);
+  }
+
+  static void QuantizeNode(BVH4QNode& a_node, const Box3f a_childBoxes[4], const uint32_t a_children[4])
+  {
+    Box3f nodeBox;
+    for(int i = 0; i < 4; i++)
+    {
+      if(a_children[i] != BVH4_EMPTY)
+        nodeBox.include(a_childBoxes[i]);
+    }
+
+    // scale is rounded up to a power of 2, so 'origin + 255*scale' can't be less than the node box maximum
+    //
+    for(int axis = 0; axis < 3; axis++)
+    {
+      const float extent = std::max(nodeBox.boxMax[axis] - nodeBox.boxMin[axis], std::numeric_limits<float>::min());
+      int exponent = 0;
+      std::frexp(extent * (1.0f + 1e-6f) / 255.0f, &exponent);
+      a_node.origin[axis] = nodeBox.boxMin[axis];
+      a_node.scale[axis]  = std::ldexp(1.0f, exponent);
+    }
+
+    for(int i = 0; i < 4; i++)
+    {
+      a_node.child[i] = a_children[i];
+      if(a_children[i] == BVH4_EMPTY)
+      {
+        a_node.qMinX[i] = a_node.qMinY[i] = a_node.qMinZ[i] = 255;
+        a_node.qMaxX[i] = a_node.qMaxY[i] = a_node.qMaxZ[i] = 0;
+        continue;
+      }
+      const Box3f& box = a_childBoxes[i];
+      QuantizeAxis(a_node.origin[0], a_node.scale[0], box.boxMin.x, box.boxMax.x, a_node.qMinX[i], a_node.qMaxX[i]);
+      QuantizeAxis(a_node.origin[1], a_node.scale[1], box.boxMin.y, box.boxMax.y, a_node.qMinY[i], a_node.qMaxY[i]);
+      QuantizeAxis(a_node.origin[2], a_node.scale[2], box.boxMin.z, box.boxMax.z, a_node.qMinZ[i], a_node.qMaxZ[i]);
+    }
+  }
+
+  BVH4QTree CompressBVH4(const BVH4Tree& a_bvh4)
+  {
+    BVH4QTree tree;
+    tree.primIndices = a_bvh4.primIndices;
+    tree.nodes.resize(a_bvh4.nodes.size());
+
+    const int nodesNum = int(a_bvh4.nodes.size());
+    #pragma omp parallel for if(nodesNum > 4096)
+    for(int i = 0; i < nodesNum; i++)
+    {
+      Box3f childBoxes[4];
+      for(int slot = 0; slot < 4; slot++)
+        childBoxes[slot] = ChildBox4(a_bvh4.nodes[i], slot);
+      QuantizeNode(tree.nodes[i], childBoxes, a_bvh4.nodes[i].child);
+    }
+    return tree;
+  }
+
+  void RefitBVH4Q(BVH4QTree& a_tree, const Box3f* a_primBoxes)
+  {
+    for(size_t i = a_tree.nodes.size(); i > 0; i--)
+    {
+      BVH4QNode& node = a_tree.nodes[i - 1];
+      Box3f childBoxes[4];
+      for(int slot = 0; slot < 4; slot++)
+      {
+        const uint32_t child = node.child[slot];
+        if(child == BVH4_EMPTY)
+          continue;
+
+        if(IsLeaf4(child))
+        {
+          for(uint32_t j = 0; j < LeafCount4(child); j++)
+            childBoxes[slot].include(a_primBoxes[a_tree.primIndices[LeafFirst4(child) + j]]);
+        }
+        else
+        {
+          const BVH4QNode& childNode = a_tree.nodes[child];
+          for(int k = 0; k < 4; k++)
+          {
+            if(childNode.child[k] != BVH4_EMPTY)
+              childBoxes[slot].include(ChildBox4Q(childNode, k));
+          }
+        }
+      }
+      const uint32_t children[4] = {node.child[0], node.child[1], node.child[2], node.child[3]};
+      QuantizeNode(node, childBoxes, children);
+    }
+  }
+}
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+#include <vector>
+#include "LiteMath.h"
+
+/**
+\brief Native CPU BVH: binned SAH builder and common BVH data structures
+*/
+namespace cbvh
+{
+  using LiteMath::float3;
+  using LiteMath::float4;
+
+  struct Box3f
+  {
+    Box3f() : boxMin(+std::numeric_limits<float>::infinity()), boxMax(-std::numeric_limits<float>::infinity()) {}
+    Box3f(float3 a_min, float3 a_max) : boxMin(a_min), boxMax(a_max) {}
+
+    void  include(float3 p)       { boxMin = LiteMath::min(boxMin, p); boxMax = LiteMath::max(boxMax, p); }
+    void  include(const Box3f& b) { boxMin = LiteMath::min(boxMin, b.boxMin); boxMax = LiteMath::max(boxMax, b.boxMax); }
+    bool  empty()    const { return boxMin.x > boxMax.x; }
+    float3 center()  const { return 0.5f*(boxMin + boxMax); }
+    float  halfArea() const
+    {
+      if(empty())
+        return 0.0f;
+      const float3 d = boxMax - boxMin;
+      return d.x*d.y + d.y*d.z + d.z*d.x;
+    }
+
+    float3 boxMin;
+    float3 boxMax;
+  };
+
+  /**
+  \brief Binary BVH node, 32 bytes. Children of interior node are stored adjacent: 'leftOffset' and 'leftOffset + 1'.
+  */
+  struct BVHNode
+  {
+    float3   boxMin;
+    uint32_t leftOffset; ///< left child for interior node, first primitive in 'BVHTree::primIndices' for leaf
+    float3   boxMax;
+    uint32_t primsCount; ///< zero for interior node
+  };
+
+  struct BuildSettings
+  {
+    uint32_t binsNum           = 16;    ///< SAH bins per axis
+    uint32_t maxPrimsInLeaf    = 4;     ///< leaf is created if split is not profitable and primitives number is not greater than this
+    float    traversalCost     = 1.0f;  ///< relative to primitive intersection cost
+    uint32_t parallelThreshold = 4096;  ///< subtrees with more primitives are built in separate tasks
+  };
+
+  static constexpr uint32_t MAX_PRIMS_IN_LEAF = 15; ///< hard limit, leaf primitives count must fit 4 bits
+  static constexpr uint32_t MAX_TREE_DEPTH    = 64; ///< hard limit, root has depth 0; traversal stacks are sized for it
+
+  struct BVHTree
+  {
+    std::vector<BVHNode>  nodes;       ///< nodes[0] is the root
+    std::vector<uint32_t> primIndices; ///< primitive indices referenced by leaves
+  };
+
+  /**
+  \brief Build binary BVH with binned SAH. Subtrees that could exceed MAX_TREE_DEPTH are split at object median instead.
+  \param a_primBoxes - bounding boxes of primitives
+  \param a_primsNum  - number of primitives
+  */
+  BVHTree BuildBVH2(const Box3f* a_primBoxes, size_t a_primsNum, const BuildSettings& a_settings = BuildSettings());
+
+  /**
+  \brief Recompute node bounds for updated primitive boxes without changing the tree topology
+  */
+  void RefitBVH2(BVHTree& a_tree, const Box3f* a_primBoxes);
+
+  /**
+  \brief 4-wide BVH node; child bounds are stored in SoA form to test all 4 children at once with SSE.
+  Unused child slots have 'child[i] == BVH4_EMPTY' and bounds (+inf, +inf); traversal must skip them by 'child', not by bounds.
+  */
+  struct alignas(16) BVH4Node
+  {
+    float    boxMinX[4];
+    float    boxMinY[4];
+    float    boxMinZ[4];
+    float    boxMaxX[4];
+    float    boxMaxY[4];
+    float    boxMaxZ[4];
+    uint32_t child[4];   ///< interior node index or packed leaf, see PackLeaf4
+  };
+
+  static constexpr uint32_t BVH4_EMPTY      = 0xFFFFFFFF;
+  static constexpr uint32_t BVH4_LEAF_BIT   = 0x80000000;
+  static constexpr uint32_t BVH4_COUNT_SHIFT = 27;
+  static constexpr uint32_t BVH4_OFFSET_MASK = (1u << BVH4_COUNT_SHIFT) - 1u; ///< so, up to 2^27 primitives per tree
+  static constexpr size_t   BVH4_MAX_PRIMS   = size_t(BVH4_OFFSET_MASK) + 1u;
+
+  static inline uint32_t PackLeaf4(uint32_t a_first, uint32_t a_count) { return BVH4_LEAF_BIT | (a_count << BVH4_COUNT_SHIFT) | a_first; }
+  static inline bool     IsLeaf4(uint32_t a_child)     { return (a_child & BVH4_LEAF_BIT) != 0; }
+  static inline uint32_t LeafFirst4(uint32_t a_child)  { return a_child & BVH4_OFFSET_MASK; }
+  static inline uint32_t LeafCount4(uint32_t a_child)  { return (a_child & ~BVH4_LEAF_BIT) >> BVH4_COUNT_SHIFT; }
+
+  struct BVH4Tree
+  {
+    std::vector<BVH4Node> nodes;       ///< nodes[0] is the root, it is always an interior node
+    std::vector<uint32_t> primIndices; ///< the same as in the source binary tree
+  };
+
+  /**
+  \brief Collapse binary BVH to 4-wide one by pulling up grandchildren with the largest surface area. Leaves are not changed.
+  Leaf offsets of trees with more than BVH4_MAX_PRIMS primitives can't be packed, for them empty tree is returned and the binary one should be used.
+  */
+  BVH4Tree CollapseBVH4(const BVHTree& a_bvh2);
+
+  /**
+  \brief Recompute child bounds of 4-wide BVH for updated primitive boxes without changing the tree topology
+  */
+  void RefitBVH4(BVH4Tree& a_tree, const Box3f* a_primBoxes);
+
+  /**
+  \brief Quantized 4-wide BVH node, 64 bytes. Child bounds are stored with 8 bits per axis relative to the node box:
+  boxMin = origin + qMin*scale, boxMax = origin + qMax*scale. Quantized boxes are always conservative.
+  */
+  struct alignas(64) BVH4QNode
+  {
+    float    origin[3];
+    float    scale[3];
+    uint8_t  qMinX[4];
+    uint8_t  qMinY[4];
+    uint8_t  qMinZ[4];
+    uint8_t  qMaxX[4];
+    uint8_t  qMaxY[4];
+    uint8_t  qMaxZ[4];
+    uint32_t child[4];   ///< the same as BVH4Node::child
+  };
+
+  struct BVH4QTree
+  {
+    std::vector<BVH4QNode> nodes;       ///< nodes[0] is the root, it is always an interior node
+    std::vector<uint32_t>  primIndices; ///< the same as in the source binary tree
+  };
+
+  /**
+  \brief Quantize child bounds of 4-wide BVH. Topology and child references are not changed.
+  */
+  BVH4QTree CompressBVH4(const BVH4Tree& a_bvh4);
+
+  /**
+  \brief Recompute and quantize child bounds of compressed 4-wide BVH for updated primitive boxes
+  */
+  void RefitBVH4Q(BVH4QTree& a_tree, const Box3f* a_primBoxes);
+
+  static inline Box3f TriangleBox(const float4& a, const float4& b, const float4& c)
+  {
+    Box3f box;
+    box.include(LiteMath::to_float3(a));
+    box.include(LiteMath::to_float3(b));
+    box.include(LiteMath::to_float3(c));
+    return box;
+  }
+
+  static inline Box3f TransformBox(const LiteMath::float4x4& a_matrix, const Box3f& a_box)
+  {
+    Box3f res;
+    if(a_box.empty()) // infinite corners would give NaN with zero matrix entries
+      return res;
+    for(int i = 0; i < 8; i++)
+    {
+      const float3 corner((i & 1) ? a_box.boxMax.x : a_box.boxMin.x,
+                          (i & 2) ? a_box.boxMax.y : a_box.boxMin.y,
+                          (i & 4) ? a_box.boxMax.z : a_box.boxMin.z);
+      res.include(a_matrix * corner);
+    }
+    return res;
+  }
+}
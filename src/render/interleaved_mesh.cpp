@@ -0,0 +1,107 @@
+#include "interleaved_mesh.h"
+
+#include <cstring>
+
+// inverse of DecodeNormal from resources/shaders/unpack_attributes.h
+static float EncodeNormal(const float* a_normal)
+{
+  const int32_t  x    = int32_t(a_normal[0] * 32767.0f);
+  const int32_t  y    = int32_t(a_normal[1] * 32767.0f);
+  const uint32_t sign = (a_normal[2] < 0.0f) ? 1u : 0u;
+
+  const uint32_t packed = (uint32_t(x) & 0x0000FFFEu) | sign | ((uint32_t(y) & 0x0000FFFFu) << 16);
+  float res;
+  memcpy(&res, &packed, sizeof(float));
+  return res;
+}
+
+InterleavedMesh8F::InterleavedMesh8F()
+{
+  m_inputBinding.binding   = 0;
+  m_inputBinding.stride    = uint32_t(SingleVertexSize());
+  m_inputBinding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+  m_inputAttributes[0].binding  = 0;
+  m_inputAttributes[0].location = 0;
+  m_inputAttributes[0].format   = VK_FORMAT_R32G32B32A32_SFLOAT; // position and packed normal
+  m_inputAttributes[0].offset   = 0;
+
+  m_inputAttributes[1].binding  = 0;
+  m_inputAttributes[1].location = 1;
+  m_inputAttributes[1].format   = VK_FORMAT_R32G32B32A32_SFLOAT; // texture coordinates and packed tangent
+  m_inputAttributes[1].offset   = 4 * sizeof(float);
+}
+
+VkPipelineVertexInputStateCreateInfo InterleavedMesh8F::VertexInputLayout()
+{
+  VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
+  vertexInputInfo.sType                           = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+  vertexInputInfo.vertexBindingDescriptionCount   = 1;
+  vertexInputInfo.pVertexBindingDescriptions      = &m_inputBinding;
+  vertexInputInfo.vertexAttributeDescriptionCount = 2;
+  vertexInputInfo.pVertexAttributeDescriptions    = m_inputAttributes;
+  return vertexInputInfo;
+}
+
+void InterleavedMesh8F::Reserve(size_t a_totalVertNum, size_t a_totalIndNum)
+{
+  m_vertices.reserve(a_totalVertNum * FLOATS_PER_VERTEX);
+  m_indices.reserve(a_totalIndNum);
+}
+
+void InterleavedMesh8F::Resize(size_t a_totalVertNum, size_t a_totalIndNum)
+{
+  m_vertices.resize(a_totalVertNum * FLOATS_PER_VERTEX);
+  m_indices.resize(a_totalIndNum);
+}
+
+void InterleavedMesh8F::WriteVertices(float* a_out, size_t a_vertNum, const float* a_pos4f, const float* a_norm4f, const float* a_tang4f, const float* a_texCoord2f)
+{
+  const float zero[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+
+  float* out = a_out;
+  for(size_t i = 0; i < a_vertNum; i++, out += FLOATS_PER_VERTEX)
+  {
+    out[0] = a_pos4f[i * 4 + 0];
+    out[1] = a_pos4f[i * 4 + 1];
+    out[2] = a_pos4f[i * 4 + 2];
+    out[3] = EncodeNormal(a_norm4f + i * 4);
+    out[4] = a_texCoord2f[i * 2 + 0];
+    out[5] = a_texCoord2f[i * 2 + 1];
+    out[6] = EncodeNormal(a_tang4f != nullptr ? a_tang4f + i * 4 : zero);
+    out[7] = 0.0f;
+  }
+}
+
+void InterleavedMesh8F::Append(const cmesh::SimpleMesh& a_meshData)
+{
+  const size_t vertNum = a_meshData.VerticesNum();
+  const size_t first   = m_vertices.size();
+  m_vertices.resize(first + vertNum * FLOATS_PER_VERTEX);
+  WriteVertices(m_vertices.data() + first, vertNum, a_meshData.vPos4f.data(), a_meshData.vNorm4f.data(),
+                a_meshData.vTang4f.size() >= vertNum * 4 ? a_meshData.vTang4f.data() : nullptr, a_meshData.vTexCoord2f.data());
+  m_indices.insert(m_indices.end(), a_meshData.indices.begin(), a_meshData.indices.end());
+}
+
+void InterleavedMesh8F::Append(const vsgf::MeshView& a_meshData)
+{
+  const size_t firstVertex = m_vertices.size() / FLOATS_PER_VERTEX;
+  const size_t firstIndex  = m_indices.size();
+  Resize(firstVertex + a_meshData.vertNum, firstIndex + a_meshData.indNum);
+  Write(a_meshData, firstVertex, firstIndex);
+}
+
+void InterleavedMesh8F::Write(const vsgf::MeshView& a_meshData, size_t a_firstVertex, size_t a_firstIndex)
+{
+  WriteVertices(m_vertices.data() + a_firstVertex * FLOATS_PER_VERTEX, a_meshData.vertNum,
+                a_meshData.pos4f, a_meshData.norm4f, a_meshData.tang4f, a_meshData.texCoord2f);
+  memcpy(m_indices.data() + a_firstIndex, a_meshData.indices, a_meshData.indNum * sizeof(uint32_t));
+}
+
+void InterleavedMesh8F::Write(const cmesh::SimpleMesh& a_meshData, size_t a_firstVertex, size_t a_firstIndex)
+{
+  const size_t vertNum = a_meshData.VerticesNum();
+  WriteVertices(m_vertices.data() + a_firstVertex * FLOATS_PER_VERTEX, vertNum, a_meshData.vPos4f.data(), a_meshData.vNorm4f.data(),
+                a_meshData.vTang4f.size() >= vertNum * 4 ? a_meshData.vTang4f.data() : nullptr, a_meshData.vTexCoord2f.data());
+  memcpy(m_indices.data() + a_firstIndex, a_meshData.indices.data(), a_meshData.IndicesNum() * sizeof(uint32_t));
+}
@@ -0,0 +1,60 @@
+#ifndef CHIMERA_INTERLEAVED_MESH_H
+#define CHIMERA_INTERLEAVED_MESH_H
+
+#include <vector>
+
+#include <geom/vk_mesh.h>
+#include "../loader_utils/vsgf_loader.h"
+
+/**
+\brief The same vertex layout as Mesh8F (8 floats per vertex: position and packed normal, texture coordinates and packed tangent),
+but meshes can also be appended straight from mapped VSGF file, without intermediate cmesh::SimpleMesh.
+*/
+struct InterleavedMesh8F : IMeshData
+{
+  InterleavedMesh8F();
+
+  float*    VertexData() override { return m_vertices.data(); }
+  uint32_t* IndexData()  override { return m_indices.data(); }
+
+  size_t VertexDataSize() override { return m_vertices.size() * sizeof(float); }
+  size_t IndexDataSize()  override { return m_indices.size() * sizeof(uint32_t); }
+
+  size_t SingleVertexSize() override { return FLOATS_PER_VERTEX * sizeof(float); }
+  size_t SingleIndexSize()  override { return sizeof(uint32_t); }
+
+  void Append(const cmesh::SimpleMesh& a_meshData) override;
+  void Append(const vsgf::MeshView& a_meshData);
+
+  /**
+  \brief Reserve memory for all meshes of the scene, so that appending does not reallocate and data pointers stay valid
+  */
+  void Reserve(size_t a_totalVertNum, size_t a_totalIndNum);
+
+  /**
+  \brief Allocate all vertices and indices at once to fill them later with Write(); can be used instead of Append() when sizes of meshes are known in advance
+  */
+  void Resize(size_t a_totalVertNum, size_t a_totalIndNum);
+
+  /**
+  \brief Convert mesh to vertices [a_firstVertex, a_firstVertex + vertNum) and indices [a_firstIndex, a_firstIndex + indNum) allocated with Resize().
+  Different meshes can be written from different threads concurrently.
+  */
+  void Write(const vsgf::MeshView& a_meshData, size_t a_firstVertex, size_t a_firstIndex);
+  void Write(const cmesh::SimpleMesh& a_meshData, size_t a_firstVertex, size_t a_firstIndex);
+
+  VkPipelineVertexInputStateCreateInfo VertexInputLayout() override;
+
+  static constexpr size_t FLOATS_PER_VERTEX = 8;
+
+private:
+  static void WriteVertices(float* a_out, size_t a_vertNum, const float* a_pos4f, const float* a_norm4f, const float* a_tang4f, const float* a_texCoord2f);
+
+  std::vector<float>    m_vertices;
+  std::vector<uint32_t> m_indices;
+
+  VkVertexInputBindingDescription   m_inputBinding       = {};
+  VkVertexInputAttributeDescription m_inputAttributes[2] = {};
+};
+
+#endif// CHIMERA_INTERLEAVED_MESH_H
@@ -1,5 +1,9 @@
 #include <map>
 #include <array>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
 #include "scene_mgr.h"
 #include "vk_utils.h"
 #include "vk_buffers.h"
@@ -17,6 +21,27 @@ VkTransformMatrixKHR transformMatrixFromFloat4x4(const LiteMath::float4x4 &m)
   return transformMatrix;
 }
 
+// top level is built with ALLOW_UPDATE, so moved instances are refitted in place by UpdateTLAS
+static const VkBuildAccelerationStructureFlagsKHR TLAS_BUILD_FLAGS = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR |
+                                                                     VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR;
+
+// sorts a_ids and calls a_func(firstId, idsNum) for ranges of changed ids, so per instance buffers are updated with few copies;
+// ranges closer than ID_RANGE_MAX_GAP are merged, copying some unchanged entries is cheaper than a separate transfer
+template<typename Func>
+static void forEachIdRange(std::vector<uint32_t>& a_ids, Func a_func)
+{
+  static constexpr uint32_t ID_RANGE_MAX_GAP = 64;
+  std::sort(a_ids.begin(), a_ids.end());
+  for(size_t begin = 0; begin < a_ids.size();)
+  {
+    size_t end = begin + 1;
+    while(end < a_ids.size() && a_ids[end] - a_ids[end - 1] <= ID_RANGE_MAX_GAP)
+      ++end;
+    a_func(a_ids[begin], a_ids[end - 1] - a_ids[begin] + 1);
+    begin = end;
+  }
+}
+
 VkFormat formatFromImageInfo(const ImageFileInfo &info)
 {
   VkFormat res = VK_FORMAT_R8G8B8A8_UNORM;
@@ -59,6 +84,119 @@ VkFormat formatFromImageInfo(const ImageFileInfo &info)
   return res;
 }
 
+static VkFormat formatFromCacheFormat(TEXTURE_CACHE_FORMAT a_format)
+{
+  switch(a_format)
+  {
+  case TEXTURE_CACHE_RGBA8:   return VK_FORMAT_R8G8B8A8_UNORM;
+  case TEXTURE_CACHE_RGBA16F: return VK_FORMAT_R16G16B16A16_SFLOAT;
+  case TEXTURE_CACHE_RGBA32F: return VK_FORMAT_R32G32B32A32_SFLOAT;
+  }
+  return VK_FORMAT_UNDEFINED;
+}
+
+// Records blits of the whole mip chain into a_cmdBuf which is already in recording state, so that chains of many images
+// share one submission. Level 0 is expected in VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL (as left by UpdateImage),
+// all levels end up in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL.
+static void recordMipChainCmd(VkCommandBuffer a_cmdBuf, VkImage a_image, uint32_t a_width, uint32_t a_height, uint32_t a_mipLevels,
+  VkFilter a_filter)
+{
+  VkImageMemoryBarrier barrier = {};
+  barrier.sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image                           = a_image;
+  barrier.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+  barrier.subresourceRange.baseArrayLayer = 0;
+  barrier.subresourceRange.layerCount     = 1;
+  barrier.subresourceRange.levelCount     = 1;
+
+  int32_t mipWidth  = int32_t(a_width);
+  int32_t mipHeight = int32_t(a_height);
+  for(uint32_t level = 1; level < a_mipLevels; ++level)
+  {
+    barrier.subresourceRange.baseMipLevel = level;
+    barrier.oldLayout     = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(a_cmdBuf, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    const int32_t nextWidth  = mipWidth  > 1 ? mipWidth  / 2 : 1;
+    const int32_t nextHeight = mipHeight > 1 ? mipHeight / 2 : 1;
+
+    VkImageBlit blit = {};
+    blit.srcOffsets[1]                 = {mipWidth, mipHeight, 1};
+    blit.srcSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+    blit.srcSubresource.mipLevel       = level - 1;
+    blit.srcSubresource.baseArrayLayer = 0;
+    blit.srcSubresource.layerCount     = 1;
+    blit.dstOffsets[1]                 = {nextWidth, nextHeight, 1};
+    blit.dstSubresource                = blit.srcSubresource;
+    blit.dstSubresource.mipLevel       = level;
+    vkCmdBlitImage(a_cmdBuf, a_image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, a_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, a_filter);
+
+    barrier.oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout     = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier(a_cmdBuf, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    mipWidth  = nextWidth;
+    mipHeight = nextHeight;
+  }
+
+  barrier.subresourceRange.baseMipLevel = 0;
+  barrier.subresourceRange.levelCount   = a_mipLevels;
+  barrier.oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+  barrier.newLayout     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+  barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+  vkCmdPipelineBarrier(a_cmdBuf, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+    0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+// Records copy of all mip levels of cached texture placed in a_src at a_srcOffset, the image ends up in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL.
+static void recordCopyMipsCmd(VkCommandBuffer a_cmdBuf, VkBuffer a_src, VkDeviceSize a_srcOffset, VkImage a_image, const CachedTexture& a_texture)
+{
+  VkImageMemoryBarrier barrier = {};
+  barrier.sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image                           = a_image;
+  barrier.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+  barrier.subresourceRange.baseMipLevel   = 0;
+  barrier.subresourceRange.levelCount     = a_texture.MipLevels();
+  barrier.subresourceRange.baseArrayLayer = 0;
+  barrier.subresourceRange.layerCount     = 1;
+  barrier.oldLayout     = VK_IMAGE_LAYOUT_UNDEFINED;
+  barrier.newLayout     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  barrier.srcAccessMask = 0;
+  barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  vkCmdPipelineBarrier(a_cmdBuf, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+  std::vector<VkBufferImageCopy> regions(a_texture.MipLevels());
+  for(uint32_t level = 0; level < a_texture.MipLevels(); ++level)
+  {
+    auto& region = regions[level];
+    region = {};
+    region.bufferOffset                    = a_srcOffset + a_texture.MipOffset(level);
+    region.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel       = level;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount     = 1;
+    region.imageExtent = {std::max(a_texture.Width() >> level, 1u), std::max(a_texture.Height() >> level, 1u), 1};
+  }
+  vkCmdCopyBufferToImage(a_cmdBuf, a_src, a_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, uint32_t(regions.size()), regions.data());
+
+  barrier.oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  barrier.newLayout     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+  vkCmdPipelineBarrier(a_cmdBuf, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+    0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
 SceneManager::SceneManager(VkDevice a_device, VkPhysicalDevice a_physDevice, uint32_t a_graphicsQId,
   std::shared_ptr<vk_utils::ICopyEngine> a_pCopyHelper, LoaderConfig a_config) :
                 m_device(a_device), m_physDevice(a_physDevice), m_graphicsQId(a_graphicsQId),
@@ -155,15 +293,19 @@ VkPipelineVertexInputStateCreateInfo SceneManager::GetPipelineVertexInputStateCr
   return currState;
 }
 
-uint32_t SceneManager::AddMeshFromFile(const std::string& meshPath)
+uint32_t SceneManager::AddMeshFromFile(const std::string& meshPath, pugi::xml_node meshNode)
 {
   //@TODO: other file formats
-  auto data = cmesh::LoadMeshFromVSGF(meshPath.c_str());
-
-  if(data.VerticesNum() == 0)
+  // mesh file is mapped and converted straight to interleaved vertices, without intermediate cmesh::SimpleMesh
+  vsgf::MappedMesh mesh;
+  if(!mesh.Open(meshPath, meshNode) || mesh.View().vertNum == 0)
     RUN_TIME_ERROR(("can't load mesh at " + meshPath).c_str());
 
-  return AddMeshFromData(data);
+  const auto& view = mesh.View();
+  m_pMeshData->Append(view);
+  m_matIDs.insert(m_matIDs.end(), view.matIndices, view.matIndices + view.indNum / 3);
+
+  return AddMeshInfo(view.vertNum, view.indNum);
 }
 
 uint32_t SceneManager::AddMeshFromData(cmesh::SimpleMesh &meshData)
@@ -176,9 +318,14 @@ uint32_t SceneManager::AddMeshFromData(cmesh::SimpleMesh &meshData)
   m_matIDs.resize(m_matIDs.size() + meshData.matIndices.size());
   std::copy(meshData.matIndices.begin(), meshData.matIndices.end(), m_matIDs.begin() + old_size);
 
+  return AddMeshInfo(meshData.VerticesNum(), meshData.IndicesNum());
+}
+
+uint32_t SceneManager::AddMeshInfo(uint32_t vertNum, uint32_t indNum)
+{
   MeshInfo info;
-  info.m_vertNum = meshData.VerticesNum();
-  info.m_indNum  = meshData.IndicesNum();
+  info.m_vertNum = vertNum;
+  info.m_indNum  = indNum;
 
   info.m_vertexOffset = m_totalVertices;
   info.m_indexOffset  = m_totalIndices;
@@ -186,8 +333,8 @@ uint32_t SceneManager::AddMeshFromData(cmesh::SimpleMesh &meshData)
   info.m_vertexBufOffset = info.m_vertexOffset * m_pMeshData->SingleVertexSize();
   info.m_indexBufOffset  = info.m_indexOffset  * m_pMeshData->SingleIndexSize();
 
-  m_totalVertices += meshData.VerticesNum();
-  m_totalIndices  += meshData.IndicesNum();
+  m_totalVertices += vertNum;
+  m_totalIndices  += indNum;
 
   m_meshInfos.push_back(info);
 
@@ -212,6 +359,50 @@ uint32_t SceneManager::InstanceMesh(const uint32_t meshId, const LiteMath::float
   return info.inst_id;
 }
 
+void SceneManager::UpdateInstanceMatrices(const uint32_t* instIds, const LiteMath::float4x4* matrices, size_t count)
+{
+  for(size_t i = 0; i < count; ++i)
+  {
+    assert(instIds[i] < m_instanceMatrices.size());
+    m_instanceMatrices[instIds[i]] = matrices[i];
+  }
+
+  UploadInstanceMatrices(instIds, count);
+}
+
+void SceneManager::UploadInstanceMatrices(const uint32_t* instIds, size_t count)
+{
+  if(count == 0 || m_instMatricesBuf == VK_NULL_HANDLE)
+    return;
+
+  m_changedInstances.assign(instIds, instIds + count);
+  forEachIdRange(m_changedInstances, [this](uint32_t first, uint32_t num) {
+    m_pCopyHelper->UpdateBuffer(m_instMatricesBuf, first * sizeof(m_instanceMatrices[0]), m_instanceMatrices.data() + first, num * sizeof(m_instanceMatrices[0]));
+  });
+}
+
+const std::vector<uint32_t>& SceneManager::UpdateAnimation(uint32_t animId, float a_time)
+{
+  m_movedInstances.clear();
+  if(animId >= m_gltfAnimations.size())
+    return m_movedInstances;
+
+  m_gltfAnimations[animId].Apply(a_time, m_gltfTransforms);
+  m_gltfTransforms.Update();
+
+  for(const auto& inst : m_animatedInstances[animId])
+  {
+    if(!m_gltfTransforms.moved[inst.second])
+      continue;
+    m_instanceMatrices[inst.first] = m_gltfTransforms.world[inst.second];
+    m_movedInstances.push_back(inst.first);
+  }
+
+  UploadInstanceMatrices(m_movedInstances.data(), m_movedInstances.size());
+
+  return m_movedInstances;
+}
+
 void SceneManager::MarkInstance(const uint32_t instId)
 {
   assert(instId < m_instanceInfos.size());
@@ -265,8 +456,21 @@ void SceneManager::InitGeoBuffersGPU(uint32_t a_meshNum, uint32_t a_totalVertNum
 
 void SceneManager::LoadOneMeshOnGPU(uint32_t meshIdx)
 {
-  VkDeviceSize vertexBufSize = m_meshInfos[meshIdx].m_vertNum * m_pMeshData->SingleVertexSize();
-  VkDeviceSize indexBufSize  = m_meshInfos[meshIdx].m_indNum  * m_pMeshData->SingleIndexSize();
+  LoadMeshesOnGPU(meshIdx, 1);
+}
+
+void SceneManager::LoadMeshesOnGPU(uint32_t firstMesh, uint32_t meshNum)
+{
+  VkDeviceSize vertNum = 0;
+  VkDeviceSize indNum  = 0;
+  for(uint32_t i = firstMesh; i < firstMesh + meshNum; ++i)
+  {
+    vertNum += m_meshInfos[i].m_vertNum;
+    indNum  += m_meshInfos[i].m_indNum;
+  }
+
+  VkDeviceSize vertexBufSize = vertNum * m_pMeshData->SingleVertexSize();
+  VkDeviceSize indexBufSize  = indNum  * m_pMeshData->SingleIndexSize();
 
   auto vertSrc = m_pMeshData->VertexData() + m_loadedVertices * (m_pMeshData->SingleVertexSize() / sizeof(float));
   auto indSrc  = m_pMeshData->IndexData() + m_loadedIndices;
@@ -274,19 +478,10 @@ void SceneManager::LoadOneMeshOnGPU(uint32_t meshIdx)
   m_pCopyHelper->UpdateBuffer(m_geoVertBuf, m_loadedVertices * m_pMeshData->SingleVertexSize(), vertSrc, vertexBufSize);
   m_pCopyHelper->UpdateBuffer(m_geoIdxBuf, m_loadedIndices * m_pMeshData->SingleIndexSize(), indSrc, indexBufSize);
   m_pCopyHelper->UpdateBuffer(m_matIdsBuf,  loadedPrims * sizeof(uint32_t),
-    m_matIDs.data() + loadedPrims, (m_meshInfos[meshIdx].m_indNum / 3) * sizeof(m_matIDs[0]));
+    m_matIDs.data() + loadedPrims, (indNum / 3) * sizeof(m_matIDs[0]));
 
-//  if(meshIdx == 8)
-//  {
-//    std::ofstream file("tmp.txt");
-//    for(size_t i = 0; i < m_meshInfos[meshIdx].m_indNum / 3; ++i)
-//    {
-//      file << m_matIDs[loadedPrims + i] << "\n";
-//    }
-//    file.close();
-//  }
-  m_loadedVertices += m_meshInfos[meshIdx].m_vertNum ;
-  m_loadedIndices  += m_meshInfos[meshIdx].m_indNum;
+  m_loadedVertices += vertNum;
+  m_loadedIndices  += indNum;
 }
 
 void SceneManager::LoadCommonGeoDataOnGPU()
@@ -333,12 +528,21 @@ vk_utils::VulkanImageMem SceneManager::LoadSpecialTexture()
     ss << "Special texture is missing at: " << missingTextureImgPath << " !";
     vk_utils::logWarning(ss.str());
   }
+  return CreateTexture(texInfo, !m_config.texture_cache_dir.empty());
+}
+
+vk_utils::VulkanImageMem SceneManager::CreateTexture(const ImageFileInfo &texInfo, bool a_cacheFormat) const
+{
   auto textureUsage      = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
   VkFormat textureFormat = formatFromImageInfo(texInfo);
-  auto mips              = vk_utils::calcMipLevelsCount(texInfo.width, texInfo.height);
+  uint32_t mips          = uint32_t(vk_utils::calcMipLevelsCount(texInfo.width, texInfo.height));
+  if(a_cacheFormat) // cached textures always have 4 channels and the whole mip chain
+  {
+    textureFormat = formatFromCacheFormat(textureCacheFormat(texInfo));
+    mips          = textureCacheMipLevels(uint32_t(texInfo.width), uint32_t(texInfo.height));
+  }
 
   return vk_utils::createImg(m_device, texInfo.width, texInfo.height, textureFormat, textureUsage, VK_IMAGE_ASPECT_COLOR_BIT, mips);
-
 }
 
 void SceneManager::LoadMaterialDataOnGPU()
@@ -360,11 +564,7 @@ void SceneManager::LoadMaterialDataOnGPU()
       auto texInfo = m_textureInfos[idx];
       if(texInfo.is_ok)
       {
-        auto textureUsage      = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
-        VkFormat textureFormat = formatFromImageInfo(texInfo);
-        auto mips              = vk_utils::calcMipLevelsCount(texInfo.width, texInfo.height);
-        m_textures.push_back(vk_utils::createImg(m_device, texInfo.width, texInfo.height, textureFormat, textureUsage,
-          VK_IMAGE_ASPECT_COLOR_BIT, mips));
+        m_textures.push_back(CreateTexture(texInfo, !m_config.texture_cache_dir.empty()));
         m_texturesById.insert({idx, m_textures.back()});
       }
     }
@@ -385,32 +585,213 @@ void SceneManager::LoadMaterialDataOnGPU()
     m_samplers.reserve(m_textures.size());
     m_textureViews.reserve(m_textureInfos.size());
 
-    for(size_t idx = 0; idx < m_textureInfos.size(); ++idx)
+    // Textures are decoded in parallel and uploaded by one thread in order as soon as the next one is ready, the uploading thread
+    // decodes textures itself while waiting. Decoding runs at most maxDecodedAhead textures ahead of the upload, so only a few
+    // decoded images are kept in memory. With texture cache "decoding" is mapping of cache file (made first if it is absent),
+    // all mip levels of cached textures are copied through own staging buffer instead of being generated on GPU.
+    // If a texture can't be cached, it is decoded as without cache and its image is recreated in the format of the file.
+    // Mip chain generation and copies from the staging buffer are recorded to one command buffer which is submitted
+    // at the end or when the staging buffer is full.
+    //
+    const size_t texNum          = m_textureInfos.size();
+    const size_t maxDecodedAhead = 2 * std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    const bool   useCache        = !m_config.texture_cache_dir.empty();
+
+    struct DecodedTexture
     {
+      std::vector<unsigned char> ldr;
+      std::vector<float>         hdr;
+      CachedTexture              cached;
+    };
+    std::vector<DecodedTexture> decoded(texNum);
+    std::unique_ptr<std::atomic<bool>[]> texReady(new std::atomic<bool>[texNum]);
+    for(size_t idx = 0; idx < texNum; ++idx)
+      texReady[idx] = false;
+
+    enum DECODE_RESULT { DECODE_DONE, DECODE_WAIT, DECODE_ALL_TAKEN };
+    std::atomic<size_t> nextToDecode(0);
+    std::atomic<size_t> uploaded(0);
+    auto decodeNextTexture = [&]() {
+      size_t idx = nextToDecode.load();
+      do
+      {
+        if(idx >= texNum)
+          return DECODE_ALL_TAKEN;
+        if(idx >= uploaded.load() + maxDecodedAhead)
+          return DECODE_WAIT;
+      } while(!nextToDecode.compare_exchange_weak(idx, idx + 1));
+
       if(m_texturesById.count(idx))
       {
-        auto texInfo = m_textureInfos[idx];
-        auto tex = m_texturesById.at(idx);
-        auto tmp = loadImageLDR(texInfo);// @TODO: load hdr textures too
-        int bpp = texInfo.bytesPerChannel * texInfo.channels;
-        if(texInfo.channels == 3)
-          bpp = texInfo.bytesPerChannel * (texInfo.channels + 1);
-        m_pCopyHelper->UpdateImage(tex.image, tmp.data(), texInfo.width, texInfo.height, bpp, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
-
-        if(tex.mipLvls > 1)
+        const auto& texInfo = m_textureInfos[idx];
+        const bool  cached  = useCache && loadCachedTexture(m_config.texture_cache_dir, texInfo, decoded[idx].cached);
+        if(!cached && texInfo.bytesPerChannel == 4)
+          decoded[idx].hdr = loadImageHDR(texInfo);
+        else if(!cached)
+          decoded[idx].ldr = loadImageLDR(texInfo);
+      }
+      texReady[idx] = true;
+      return DECODE_DONE;
+    };
+
+    const VkDeviceSize TEXTURE_STAGING_SIZE = 64 * 1024 * 1024;
+    VkBuffer        stagingBuf   = VK_NULL_HANDLE;
+    VkDeviceMemory  stagingMem   = VK_NULL_HANDLE;
+    uint8_t*        stagingData  = nullptr;
+    VkDeviceSize    stagingSize  = 0;
+    VkDeviceSize    stagingUsed  = 0;
+    VkCommandBuffer batchCmdBuf  = VK_NULL_HANDLE;
+
+    auto batchCmd = [&]() {
+      if(batchCmdBuf == VK_NULL_HANDLE)
+      {
+        batchCmdBuf = vk_utils::createCommandBuffer(m_device, m_pool);
+        VkCommandBufferBeginInfo beginInfo = {};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        VK_CHECK_RESULT(vkBeginCommandBuffer(batchCmdBuf, &beginInfo));
+      }
+      return batchCmdBuf;
+    };
+
+    auto submitBatch = [&]() {
+      if(batchCmdBuf == VK_NULL_HANDLE)
+        return;
+      VK_CHECK_RESULT(vkEndCommandBuffer(batchCmdBuf));
+
+      VkSubmitInfo submitInfo = {};
+      submitInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+      submitInfo.commandBufferCount = 1;
+      submitInfo.pCommandBuffers    = &batchCmdBuf;
+      VK_CHECK_RESULT(vkQueueSubmit(m_graphicsQ, 1, &submitInfo, VK_NULL_HANDLE));
+      VK_CHECK_RESULT(vkQueueWaitIdle(m_graphicsQ));
+      vkFreeCommandBuffers(m_device, m_pool, 1, &batchCmdBuf);
+      batchCmdBuf = VK_NULL_HANDLE;
+      stagingUsed = 0;
+    };
+
+    auto destroyStaging = [&]() {
+      if(stagingBuf == VK_NULL_HANDLE)
+        return;
+      vkUnmapMemory(m_device, stagingMem);
+      vkDestroyBuffer(m_device, stagingBuf, nullptr);
+      vkFreeMemory(m_device, stagingMem, nullptr);
+      stagingBuf = VK_NULL_HANDLE;
+      stagingMem = VK_NULL_HANDLE;
+    };
+
+    // returns offset of a_data copy in staging buffer, previous copies are submitted first if it does not fit
+    auto stageData = [&](const uint8_t* a_data, VkDeviceSize a_size) {
+      if(stagingUsed + a_size > stagingSize)
+      {
+        submitBatch();
+        if(a_size > stagingSize)
         {
-          auto cmdBuf = vk_utils::createCommandBuffer(m_device, m_pool);
-          vk_utils::generateMipChainCmd(cmdBuf, tex.image, texInfo.width, texInfo.height, tex.mipLvls);
-          vk_utils::executeCommandBufferNow(cmdBuf, m_graphicsQ, m_device);
+          destroyStaging();
+          stagingSize = std::max(a_size, TEXTURE_STAGING_SIZE);
+
+          VkMemoryRequirements memReq;
+          stagingBuf = vk_utils::createBuffer(m_device, stagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, &memReq);
+
+          VkMemoryAllocateInfo allocateInfo = {};
+          allocateInfo.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+          allocateInfo.allocationSize  = memReq.size;
+          allocateInfo.memoryTypeIndex = vk_utils::findMemoryType(memReq.memoryTypeBits,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_physDevice);
+          VK_CHECK_RESULT(vkAllocateMemory(m_device, &allocateInfo, nullptr, &stagingMem));
+          VK_CHECK_RESULT(vkBindBufferMemory(m_device, stagingBuf, stagingMem, 0));
+
+          void* mapped = nullptr;
+          VK_CHECK_RESULT(vkMapMemory(m_device, stagingMem, 0, stagingSize, 0, &mapped));
+          stagingData = reinterpret_cast<uint8_t*>(mapped);
         }
-        m_textureViews.push_back(tex.view);
       }
-      else
+
+      const VkDeviceSize offset = stagingUsed;
+      memcpy(stagingData + offset, a_data, size_t(a_size));
+      stagingUsed += (a_size + 63) / 64 * 64; // keeps offsets of cached mip levels aligned
+      return offset;
+    };
+
+    #pragma omp parallel
+    {
+      #pragma omp single nowait
       {
-        m_textureViews.push_back(m_textures.back().view);
+        for(size_t idx = 0; idx < texNum; ++idx)
+        {
+          while(!texReady[idx])
+          {
+            if(decodeNextTexture() != DECODE_DONE)
+              std::this_thread::yield();
+          }
+
+          bool loaded = false;
+          if(m_texturesById.count(idx))
+          {
+            const auto& texInfo = m_textureInfos[idx];
+            auto& tex           = m_texturesById.at(idx);
+            auto& texData       = decoded[idx];
+
+            int bpp = texInfo.bytesPerChannel * texInfo.channels;
+            if(texInfo.channels == 3)
+              bpp = texInfo.bytesPerChannel * (texInfo.channels + 1);
+            const size_t bytes  = size_t(texInfo.width) * texInfo.height * bpp;
+            const void*  pixels = texData.ldr.size() >= bytes ? (const void*)texData.ldr.data() :
+                                  texData.hdr.size() * sizeof(float) >= bytes ? (const void*)texData.hdr.data() : nullptr;
+
+            if(texData.cached.IsOpen() && texData.cached.Width() == uint32_t(texInfo.width) && texData.cached.Height() == uint32_t(texInfo.height))
+            {
+              const VkDeviceSize offset = stageData(texData.cached.Data(), texData.cached.DataSize());
+              recordCopyMipsCmd(batchCmd(), stagingBuf, offset, tex.image, texData.cached);
+              loaded = true;
+            }
+            else if(pixels != nullptr)
+            {
+              if(useCache) // image was made in cache format with the whole mip chain, its memory stays in the common allocation unused
+              {
+                std::stringstream ss;
+                ss << "Texture at \"" << texInfo.path << "\" can't be cached, it is decoded directly.";
+                vk_utils::logWarning(ss.str());
+
+                vkDestroyImageView(m_device, tex.view, nullptr);
+                vkDestroyImage(m_device, tex.image, nullptr);
+                std::vector<vk_utils::VulkanImageMem> decodedImg = {CreateTexture(texInfo, false)};
+                vk_utils::allocateImgsBindCreateView(m_device, m_physDevice, decodedImg);
+                tex = decodedImg[0];
+                m_decodedTexturesMem.push_back(tex.mem);
+              }
+
+              m_pCopyHelper->UpdateImage(tex.image, pixels, texInfo.width, texInfo.height, bpp, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+              if(tex.mipLvls > 1) // linear filtering of 32 bit float formats is optional
+                recordMipChainCmd(batchCmd(), tex.image, uint32_t(texInfo.width), uint32_t(texInfo.height), tex.mipLvls,
+                  texInfo.bytesPerChannel == 4 ? VK_FILTER_NEAREST : VK_FILTER_LINEAR);
+              loaded = true;
+            }
+            else
+            {
+              std::stringstream ss;
+              ss << "Texture at \"" << texInfo.path << "\" can't be decoded.";
+              vk_utils::logWarning(ss.str());
+            }
+
+            if(loaded)
+              m_textureViews.push_back(tex.view);
+          }
+
+          if(!loaded)
+            m_textureViews.push_back(m_textures.back().view);
+          m_samplers.push_back(common_sampler);
+
+          decoded[idx] = DecodedTexture();
+          uploaded = idx + 1;
+        }
       }
-      m_samplers.push_back(common_sampler);
+
+      while(decodeNextTexture() != DECODE_ALL_TAKEN) { std::this_thread::yield(); }
     }
+
+    submitBatch();
+    destroyStaging();
   }
 }
 
@@ -499,6 +880,9 @@ void SceneManager::DestroyScene()
     vkFreeMemory(m_device, m_texturesMemAlloc, nullptr);
     m_texturesMemAlloc = VK_NULL_HANDLE;
   }
+  for(auto mem : m_decodedTexturesMem)
+    vkFreeMemory(m_device, mem, nullptr);
+  m_decodedTexturesMem.clear();
 
   {
     std::sort(m_samplers.begin(), m_samplers.end());
@@ -517,6 +901,8 @@ void SceneManager::DestroyScene()
   {
     m_pBuilderV2->Destroy();
   }
+  DestroyTLASInstances();
+  m_tlasInstances.clear();
 
   m_loadedVertices        = 0;
   m_loadedIndices         = 0;
@@ -560,8 +946,8 @@ void SceneManager::BuildTLAS()
 {
   BuildAllBLAS();
 
-  std::vector<VkAccelerationStructureInstanceKHR> geometryInstances;
-  geometryInstances.reserve(m_instanceInfos.size());
+  m_tlasInstances.clear();
+  m_tlasInstances.reserve(m_instanceInfos.size());
 
 #ifdef USE_MANY_HIT_SHADERS
   std::map<uint32_t, uint32_t> materialMap = { {0, LAMBERT_MTL}, {1, GGX_MTL}, {2, MIRROR_MTL}, {3, BLEND_MTL}, {4, MIRROR_MTL}, {5, EMISSION_MTL} };
@@ -569,6 +955,7 @@ void SceneManager::BuildTLAS()
 
   for(const auto& inst : m_instanceInfos)
   {
+    assert(inst.inst_id == m_tlasInstances.size()); // UpdateTLAS finds instances by id
     auto transform = transformMatrixFromFloat4x4(m_instanceMatrices[inst.inst_id]);
     VkAccelerationStructureInstanceKHR instance{};
     instance.transform = transform;
@@ -582,42 +969,84 @@ void SceneManager::BuildTLAS()
     instance.flags = VK_GEOMETRY_INSTANCE_TRIANGLE_FACING_CULL_DISABLE_BIT_KHR;
     instance.accelerationStructureReference = m_pBuilderV2->GetBLASDeviceAddress(inst.mesh_id);//m_blas[inst.mesh_id].deviceAddress;
 
-    geometryInstances.push_back(instance);
+    m_tlasInstances.push_back(instance);
+  }
+
+  // instance buffer is kept for updates and reused by rebuilds while instances fit in it
+  if(m_tlasInstancesBuf == VK_NULL_HANDLE || m_tlasInstances.size() > m_tlasInstancesCapacity)
+  {
+    DestroyTLASInstances();
+    m_tlasInstancesCapacity = std::max<size_t>(m_tlasInstances.size(), 1);
+
+    VkMemoryRequirements memReqs {};
+    m_tlasInstancesBuf = vk_utils::createBuffer(m_device, sizeof(VkAccelerationStructureInstanceKHR) * m_tlasInstancesCapacity,
+      VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      &memReqs);
+
+    VkMemoryAllocateFlagsInfo memoryAllocateFlagsInfo{};
+    memoryAllocateFlagsInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO;
+    memoryAllocateFlagsInfo.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT_KHR;
+
+    VkMemoryAllocateInfo allocateInfo = {};
+    allocateInfo.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocateInfo.pNext           = &memoryAllocateFlagsInfo;
+    allocateInfo.allocationSize  = memReqs.size;
+    allocateInfo.memoryTypeIndex = vk_utils::findMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_physDevice);
+    VK_CHECK_RESULT(vkAllocateMemory(m_device, &allocateInfo, nullptr, &m_tlasInstancesAlloc));
+
+    VK_CHECK_RESULT(vkBindBufferMemory(m_device, m_tlasInstancesBuf, m_tlasInstancesAlloc, 0));
+  }
+  if(!m_tlasInstances.empty())
+  {
+    m_pCopyHelper->UpdateBuffer(m_tlasInstancesBuf, 0, m_tlasInstances.data(),
+      sizeof(VkAccelerationStructureInstanceKHR) * m_tlasInstances.size());
   }
 
-  VkBuffer instancesBuffer = VK_NULL_HANDLE;
+  VkDeviceOrHostAddressConstKHR instBufferDeviceAddress{};
+  instBufferDeviceAddress.deviceAddress = vk_rt_utils::getBufferDeviceAddress(m_device, m_tlasInstancesBuf);
+  m_pBuilderV2->BuildTLAS(m_tlasInstances.size(), instBufferDeviceAddress, TLAS_BUILD_FLAGS);
+}
 
-  VkMemoryRequirements memReqs {};
-  instancesBuffer = vk_utils::createBuffer(m_device, sizeof(VkAccelerationStructureInstanceKHR) * geometryInstances.size(),
-    VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-    &memReqs);
+void SceneManager::UpdateTLAS(const uint32_t* instIds, size_t count)
+{
+  if(count == 0)
+    return;
 
-  VkMemoryAllocateFlagsInfo memoryAllocateFlagsInfo{};
-  memoryAllocateFlagsInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO;
-  memoryAllocateFlagsInfo.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT_KHR;
+  // instances were added after the last build, their BLAS may be new as well
+  if(m_tlasInstancesBuf == VK_NULL_HANDLE || m_tlasInstances.size() != m_instanceInfos.size())
+  {
+    BuildTLAS();
+    return;
+  }
 
-  VkDeviceMemory instancesAlloc;
-  VkMemoryAllocateInfo allocateInfo = {};
-  allocateInfo.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  allocateInfo.pNext           = &memoryAllocateFlagsInfo;
-  allocateInfo.allocationSize  = memReqs.size;
-  allocateInfo.memoryTypeIndex = vk_utils::findMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_physDevice);
-  VK_CHECK_RESULT(vkAllocateMemory(m_device, &allocateInfo, nullptr, &instancesAlloc));
+  for(size_t i = 0; i < count; ++i)
+  {
+    assert(instIds[i] < m_tlasInstances.size());
+    m_tlasInstances[instIds[i]].transform = transformMatrixFromFloat4x4(m_instanceMatrices[instIds[i]]);
+  }
 
-  VK_CHECK_RESULT(vkBindBufferMemory(m_device, instancesBuffer, instancesAlloc, 0));
-  m_pCopyHelper->UpdateBuffer(instancesBuffer, 0, geometryInstances.data(),
-    sizeof(VkAccelerationStructureInstanceKHR) * geometryInstances.size());
+  m_changedInstances.assign(instIds, instIds + count);
+  forEachIdRange(m_changedInstances, [this](uint32_t first, uint32_t num) {
+    m_pCopyHelper->UpdateBuffer(m_tlasInstancesBuf, first * sizeof(VkAccelerationStructureInstanceKHR), m_tlasInstances.data() + first,
+      num * sizeof(VkAccelerationStructureInstanceKHR));
+  });
 
   VkDeviceOrHostAddressConstKHR instBufferDeviceAddress{};
-  instBufferDeviceAddress.deviceAddress = vk_rt_utils::getBufferDeviceAddress(m_device, instancesBuffer);
-  m_pBuilderV2->BuildTLAS(geometryInstances.size(), instBufferDeviceAddress);
+  instBufferDeviceAddress.deviceAddress = vk_rt_utils::getBufferDeviceAddress(m_device, m_tlasInstancesBuf);
+  m_pBuilderV2->BuildTLAS(m_tlasInstances.size(), instBufferDeviceAddress, TLAS_BUILD_FLAGS, true);
+}
 
-  if (instancesAlloc != VK_NULL_HANDLE)
+void SceneManager::DestroyTLASInstances()
+{
+  if(m_tlasInstancesBuf != VK_NULL_HANDLE)
   {
-    vkFreeMemory(m_device, instancesAlloc, nullptr);
+    vkDestroyBuffer(m_device, m_tlasInstancesBuf, nullptr);
+    m_tlasInstancesBuf = VK_NULL_HANDLE;
   }
-  if (instancesBuffer != VK_NULL_HANDLE)
+  if(m_tlasInstancesAlloc != VK_NULL_HANDLE)
   {
-    vkDestroyBuffer(m_device, instancesBuffer, nullptr);
+    vkFreeMemory(m_device, m_tlasInstancesAlloc, nullptr);
+    m_tlasInstancesAlloc = VK_NULL_HANDLE;
   }
+  m_tlasInstancesCapacity = 0;
 }
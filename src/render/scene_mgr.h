@@ -11,6 +11,10 @@
 
 #include "../loader_utils/hydraxml.h"
 #include "../loader_utils/image_loader.h"
+#include "../loader_utils/scene_cache.h"
+#include "../loader_utils/texture_cache.h"
+#include "../loader_utils/gltf_utils.h"
+#include "interleaved_mesh.h"
 #include "tiny_gltf.h"
 #include "../resources/shaders/common.h"
 
@@ -55,6 +59,8 @@ struct LoaderConfig
   bool debug_output = false;
   BVH_BUILDER_TYPE builder_type = BVH_BUILDER_TYPE::RTX;
   MATERIAL_FORMAT material_format = MATERIAL_FORMAT::METALLIC_ROUGHNESS;
+  std::string scene_cache_dir = ""; // if not empty, LoadScene saves loaded scenes there in binary form and loads unchanged scenes from it
+  std::string texture_cache_dir = ""; // if not empty, textures are decoded with all mip levels there once and mapped from it on next loads
 };
 
 struct SceneManager
@@ -65,15 +71,16 @@ struct SceneManager
 
   bool LoadSceneXML(const std::string &scenePath, bool transpose = true);
   bool LoadSceneGLTF(const std::string &scenePath);
-  bool LoadScene(const std::string &scenePath); // guess scene type by extension
+  bool LoadScene(const std::string &scenePath); // guess scene type by extension, use scene cache if it is enabled
 //  void LoadSingleTriangle(); // TODO: rework
 
   bool InitEmptyScene(uint32_t maxMeshes, uint32_t maxTotalVertices, uint32_t maxTotalPrimitives, uint32_t maxPrimitivesPerMesh);
 
-  uint32_t AddMeshFromFile(const std::string& meshPath);
+  uint32_t AddMeshFromFile(const std::string& meshPath, pugi::xml_node meshNode = pugi::xml_node()); // meshNode - Hydra XML node of mesh with array offsets, optional
   uint32_t AddMeshFromData(cmesh::SimpleMesh &meshData);
 
   uint32_t InstanceMesh(uint32_t meshId, const LiteMath::float4x4 &matrix, bool markForRender = true);
+  void     UpdateInstanceMatrices(const uint32_t* instIds, const LiteMath::float4x4* matrices, size_t count); // call UpdateTLAS() after it for RTX
 
   void MarkInstance(uint32_t instId);
   void UnmarkInstance(uint32_t instId);
@@ -104,35 +111,58 @@ struct SceneManager
   InstanceInfo GetInstanceInfo(uint32_t instId) const {assert(instId < m_instanceInfos.size()); return m_instanceInfos[instId];}
   LiteMath::float4x4 GetInstanceMatrix(uint32_t instId) const {assert(instId < m_instanceMatrices.size()); return m_instanceMatrices[instId];}
 
+  uint32_t AnimationsNum() const { return uint32_t(m_gltfAnimations.size()); } // glTF animations of the loaded scene
+  float    AnimationDuration(uint32_t animId) const { assert(animId < m_gltfAnimations.size()); return m_gltfAnimations[animId].duration; }
+
+  /**
+  \brief Evaluate animation at a_time (seconds, wrapped to its duration) and update matrices of instances which it moves.
+  Only instances of animated nodes and their descendants are visited. Returns ids of instances which matrices were changed.
+  */
+  const std::vector<uint32_t>& UpdateAnimation(uint32_t animId, float a_time);
+
 //  void DestroyAS();
 
   VkAccelerationStructureKHR GetTLAS() const { return m_pBuilderV2->GetTLAS(); }
   void BuildAllBLAS();
   void BuildTLAS();
+  void UpdateTLAS(const uint32_t* instIds, size_t count); ///< refit top level in place for moved instances, BLAS are not touched
 
 private:
   const std::string missingTextureImgPath = "../resources/data/missing_texture.png";
 
   vk_utils::VulkanImageMem LoadSpecialTexture();
+  vk_utils::VulkanImageMem CreateTexture(const ImageFileInfo &texInfo, bool a_cacheFormat) const; // a_cacheFormat - 4 channels and all mips, see texture_cache.h
   void InitGeoBuffersGPU(uint32_t a_meshNum, uint32_t a_totalVertNum, uint32_t a_totalIndicesNum);
   void LoadOneMeshOnGPU(uint32_t meshIdx);
+  void LoadMeshesOnGPU(uint32_t firstMesh, uint32_t meshNum); // meshes [firstMesh, firstMesh + meshNum) with one copy per buffer
   void LoadCommonGeoDataOnGPU();
   void LoadInstanceDataOnGPU();
   void LoadMaterialDataOnGPU();
 
+  void UploadInstanceMatrices(const uint32_t* instIds, size_t count); // only changed parts of m_instMatricesBuf
+  void DestroyTLASInstances();
+
   void AddBLAS(uint32_t meshIdx);
+  uint32_t AddMeshInfo(uint32_t vertNum, uint32_t indNum);
 
-  void LoadGLTFNodesRecursive(const tinygltf::Model &a_model, const tinygltf::Node& a_node, const LiteMath::float4x4& a_parentMatrix,
-    std::unordered_map<int, uint32_t> &a_loadedMeshesToMeshId);
+  uint32_t SceneCacheFlags() const;
+  bool LoadSceneCache(const std::string &cachePath, const SceneCacheKey &key);
+  void SaveSceneCache(const std::string &cachePath, const SceneCacheKey &key) const;
 
   std::vector<MeshInfo> m_meshInfos = {};
-  std::shared_ptr<IMeshData> m_pMeshData = nullptr;
+  std::shared_ptr<InterleavedMesh8F> m_pMeshData = nullptr;
 
   std::vector<InstanceInfo> m_instanceInfos = {};
   std::vector<LiteMath::float4x4> m_instanceMatrices = {};
 
   std::vector<hydra_xml::Camera> m_sceneCameras = {};
 
+  GLTFNodeTransforms m_gltfTransforms;
+  std::vector<GLTFAnimation> m_gltfAnimations;
+  std::vector<std::vector<std::pair<uint32_t, int>>> m_animatedInstances; // instance id and node entry of instances each animation can move
+  std::vector<uint32_t> m_movedInstances;
+  std::vector<uint32_t> m_changedInstances; // sorted copy of updated ids, see UploadInstanceMatrices and UpdateTLAS
+
   uint32_t m_totalVertices = 0u;
   uint32_t m_totalIndices  = 0u;
 
@@ -145,6 +175,11 @@ private:
   VkBuffer m_instMatricesBuf    = VK_NULL_HANDLE;
   VkDeviceMemory m_instMemAlloc = VK_NULL_HANDLE;
 
+  std::vector<VkAccelerationStructureInstanceKHR> m_tlasInstances; // indexed by instance id
+  VkBuffer m_tlasInstancesBuf         = VK_NULL_HANDLE;
+  VkDeviceMemory m_tlasInstancesAlloc = VK_NULL_HANDLE;
+  size_t m_tlasInstancesCapacity      = 0;
+
   VkDeviceSize m_loadedVertices = 0;
   VkDeviceSize m_loadedIndices  = 0;
 
@@ -157,6 +192,7 @@ private:
   std::vector<vk_utils::VulkanImageMem> m_textures;
   std::unordered_map<uint32_t, vk_utils::VulkanImageMem&> m_texturesById;
   VkDeviceMemory m_texturesMemAlloc = VK_NULL_HANDLE;
+  std::vector<VkDeviceMemory> m_decodedTexturesMem; // own memory of textures which were recreated because they could not be cached
   std::vector<VkSampler> m_samplers;
   std::vector<VkImageView> m_textureViews;
 
@@ -2,6 +2,12 @@
 #include "vk_utils.h"
 #include "../loader_utils/gltf_utils.h"
 
+#include <atomic>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <thread>
+
 #define TINYGLTF_IMPLEMENTATION
 //#define TINYGLTF_NO_STB_IMAGE_WRITE
 //#define TINYGLTF_NO_STB_IMAGE
@@ -14,7 +20,7 @@
 
 bool SceneManager::InitEmptyScene(uint32_t maxMeshes, uint32_t maxTotalVertices, uint32_t maxTotalPrimitives, uint32_t maxPrimitivesPerMesh)
 {
-  m_pMeshData = std::make_shared<Mesh8F>();
+  m_pMeshData = std::make_shared<InterleavedMesh8F>();
   InitGeoBuffersGPU(maxMeshes, maxTotalVertices, maxTotalPrimitives * 3);
   if(m_config.build_acc_structs)
   {
@@ -34,18 +40,190 @@ bool SceneManager::LoadScene(const std::string &scenePath)
 
   std::string ext = scenePath.substr(scenePath.find_last_of('.'), scenePath.size());
 
-  if(ext == ".gltf")
-    return LoadSceneGLTF(scenePath);
+  m_gltfAnimations.clear(); // set by glTF loader only, scenes from cache have no animations
+  m_animatedInstances.clear();
+
+  SceneCacheKey cacheKey;
+  const bool useCache = !m_config.scene_cache_dir.empty() && SceneCacheKey::FromFile(scenePath, SceneCacheFlags(), cacheKey);
+  if(useCache && LoadSceneCache(cacheKey.CachePath(m_config.scene_cache_dir), cacheKey))
+    return true;
+
+  bool loaded = false;
+  if(ext == ".gltf" || ext == ".glb")
+    loaded = LoadSceneGLTF(scenePath);
   else if(ext == ".xml")
-    return LoadSceneXML(scenePath, false);
+    loaded = LoadSceneXML(scenePath, false);
+
+  if(loaded && useCache && m_gltfAnimations.empty()) // animations are not cached
+    SaveSceneCache(cacheKey.CachePath(m_config.scene_cache_dir), cacheKey);
+
+  return loaded;
+}
+
+uint32_t SceneManager::SceneCacheFlags() const
+{
+  return (m_config.load_geometry ? 1u : 0u) | (uint32_t(m_config.load_materials) << 1u);
+}
+
+bool SceneManager::LoadSceneCache(const std::string &cachePath, const SceneCacheKey &key)
+{
+  SceneCacheReader cache;
+  if(!cache.Open(cachePath, key))
+    return false;
+
+  size_t meshesNum = 0, instancesNum = 0, matricesNum = 0, materialsNum = 0, camerasNum = 0;
+  size_t vertFloatsNum = 0, indicesNum = 0, matIdsNum = 0;
+  const auto* meshInfos      = cache.Section<MeshInfo>(SCENE_CACHE_MESH_INFOS, meshesNum);
+  const auto* instanceMeshes = cache.Section<uint32_t>(SCENE_CACHE_INSTANCE_MESHES, instancesNum);
+  const auto* matrices       = cache.Section<LiteMath::float4x4>(SCENE_CACHE_INSTANCE_MATRICES, matricesNum);
+  const auto* materials      = cache.Section<MaterialData_pbrMR>(SCENE_CACHE_MATERIALS, materialsNum);
+  const auto* cameras        = cache.Section<hydra_xml::Camera>(SCENE_CACHE_CAMERAS, camerasNum);
+  const auto* vertices       = cache.Section<float>(SCENE_CACHE_VERTICES, vertFloatsNum);
+  const auto* indices        = cache.Section<uint32_t>(SCENE_CACHE_INDICES, indicesNum);
+  const auto* matIds         = cache.Section<uint32_t>(SCENE_CACHE_MATERIAL_IDS, matIdsNum);
+
+  const size_t totalVertices = vertFloatsNum / InterleavedMesh8F::FLOATS_PER_VERTEX;
+  size_t meshVertices = 0, meshIndices = 0;
+  for(size_t i = 0; i < meshesNum; ++i)
+  {
+    meshVertices += meshInfos[i].m_vertNum;
+    meshIndices  += meshInfos[i].m_indNum;
+  }
+  bool consistent = instancesNum == matricesNum && meshVertices == totalVertices && meshIndices == indicesNum && matIdsNum * 3 == indicesNum;
+  for(size_t i = 0; consistent && i < instancesNum; ++i)
+    consistent = instanceMeshes[i] < meshesNum;
+  if(!consistent)
+  {
+    std::stringstream ss;
+    ss << "Scene cache at \"" << cachePath << "\" is inconsistent, loading the scene itself.";
+    vk_utils::logWarning(ss.str());
+    return false;
+  }
+
+  if(m_config.debug_output)
+    std::cout << "Loading scene from cache " << cachePath << std::endl;
+
+  m_pMeshData = std::make_shared<InterleavedMesh8F>();
+
+  if(m_config.load_geometry)
+  {
+    uint32_t maxVertexCountPerMesh    = 0u;
+    uint32_t maxPrimitiveCountPerMesh = 0u;
+    for(size_t i = 0; i < meshesNum; ++i)
+    {
+      maxVertexCountPerMesh    = std::max(meshInfos[i].m_vertNum, maxVertexCountPerMesh);
+      maxPrimitiveCountPerMesh = std::max(meshInfos[i].m_indNum / 3, maxPrimitiveCountPerMesh);
+    }
+
+    InitGeoBuffersGPU(uint32_t(meshesNum), uint32_t(totalVertices), uint32_t(indicesNum));
+    if(m_config.build_acc_structs)
+    {
+      m_pBuilderV2->Init(maxVertexCountPerMesh, maxPrimitiveCountPerMesh, uint32_t(indicesNum / 3), m_pMeshData->SingleVertexSize(),
+        m_config.build_acc_structs_while_loading_scene);
+    }
+
+    // vertices are already interleaved and indices are already offset, so meshes are only copied out of the mapped file
+    m_pMeshData->Resize(totalVertices, indicesNum);
+    if(vertFloatsNum > 0)
+      memcpy(m_pMeshData->VertexData(), vertices, vertFloatsNum * sizeof(float));
+    if(indicesNum > 0)
+      memcpy(m_pMeshData->IndexData(), indices, indicesNum * sizeof(uint32_t));
+    m_matIDs.assign(matIds, matIds + matIdsNum);
+
+    for(size_t i = 0; i < meshesNum; ++i)
+    {
+      auto meshId = AddMeshInfo(meshInfos[i].m_vertNum, meshInfos[i].m_indNum);
+      LoadOneMeshOnGPU(meshId);
+      if(m_config.build_acc_structs)
+      {
+        AddBLAS(meshId);
+      }
+    }
+
+    for(size_t i = 0; i < instancesNum; ++i)
+      InstanceMesh(instanceMeshes[i], matrices[i]);
+  }
+
+  m_sceneCameras.assign(cameras, cameras + camerasNum);
+
+  if(m_config.load_materials != MATERIAL_LOAD_MODE::NONE)
+  {
+    m_materials.assign(materials, materials + materialsNum);
+  }
+
+  if(m_config.load_materials == MATERIAL_LOAD_MODE::MATERIALS_AND_TEXTURES)
+  {
+    for(const auto& tex : cache.Strings(SCENE_CACHE_TEXTURE_PATHS))
+    {
+      ImageFileInfo texInfo = getImageInfo(tex);
+      if(!texInfo.is_ok)
+      {
+        std::stringstream ss;
+        ss << "Texture at \"" << tex << "\" is absent or corrupted." ;
+        vk_utils::logWarning(ss.str());
+      }
+      m_textureInfos.push_back(texInfo);
+    }
+  }
+
+  if(m_config.load_geometry)
+  {
+    LoadCommonGeoDataOnGPU();
+  }
+
+  if(m_config.instance_matrix_as_vertex_attribute)
+  {
+    LoadInstanceDataOnGPU();
+  }
+
+  if(m_config.load_materials != MATERIAL_LOAD_MODE::NONE)
+  {
+    LoadMaterialDataOnGPU();
+  }
 
-  return false;
+  return true;
+}
+
+void SceneManager::SaveSceneCache(const std::string &cachePath, const SceneCacheKey &key) const
+{
+  std::vector<uint32_t> instanceMeshes(m_instanceInfos.size());
+  for(size_t i = 0; i < m_instanceInfos.size(); ++i)
+    instanceMeshes[i] = m_instanceInfos[i].mesh_id;
+
+  // the last texture is the special one added by LoadMaterialDataOnGPU, it is not a part of the scene
+  size_t texturesNum = m_textureInfos.size();
+  if(m_config.load_materials == MATERIAL_LOAD_MODE::MATERIALS_AND_TEXTURES && texturesNum > 0)
+    texturesNum--;
+
+  std::string texturePaths;
+  for(size_t i = 0; i < texturesNum; ++i)
+  {
+    texturePaths += m_textureInfos[i].path;
+    texturePaths.push_back('\0');
+  }
+
+  SceneCacheWriter cache;
+  cache.Add(SCENE_CACHE_MESH_INFOS,        m_meshInfos.data(),        m_meshInfos.size());
+  cache.Add(SCENE_CACHE_INSTANCE_MESHES,   instanceMeshes.data(),     instanceMeshes.size());
+  cache.Add(SCENE_CACHE_INSTANCE_MATRICES, m_instanceMatrices.data(), m_instanceMatrices.size());
+  cache.Add(SCENE_CACHE_MATERIALS,         m_materials.data(),        m_materials.size());
+  cache.Add(SCENE_CACHE_TEXTURE_PATHS,     texturePaths.data(),       texturePaths.size());
+  cache.Add(SCENE_CACHE_CAMERAS,           m_sceneCameras.data(),     m_sceneCameras.size());
+  cache.Add(SCENE_CACHE_MATERIAL_IDS,      m_matIDs.data(),           m_matIDs.size());
+  if(m_pMeshData != nullptr)
+  {
+    cache.Add(SCENE_CACHE_VERTICES, m_pMeshData->VertexData(), m_pMeshData->VertexDataSize() / sizeof(float));
+    cache.Add(SCENE_CACHE_INDICES,  m_pMeshData->IndexData(),  m_pMeshData->IndexDataSize() / sizeof(uint32_t));
+  }
+
+  if(cache.Write(cachePath, key) && m_config.debug_output)
+    std::cout << "Scene cache saved to " << cachePath << std::endl;
 }
 
 bool SceneManager::LoadSceneXML(const std::string &scenePath, bool transpose)
 {
   auto hscene_main = std::make_shared<hydra_xml::HydraScene>();
-  auto res         = hscene_main->LoadState(scenePath);
+  auto res         = hscene_main->LoadState(scenePath, true); // instances are streamed from file after meshes are loaded
 
   if(res < 0)
   {
@@ -53,7 +231,7 @@ bool SceneManager::LoadSceneXML(const std::string &scenePath, bool transpose)
     return false;
   }
 
-  m_pMeshData = std::make_shared<Mesh8F>();
+  m_pMeshData = std::make_shared<InterleavedMesh8F>();
 
   uint32_t maxVertexCountPerMesh    = 0u;
   uint32_t maxPrimitiveCountPerMesh = 0u;
@@ -62,12 +240,22 @@ bool SceneManager::LoadSceneXML(const std::string &scenePath, bool transpose)
   uint32_t totalMeshes              = 0u;
   if(m_config.load_geometry)
   {
+    // MeshFiles() and GeomNodes() iterate the same nodes of geometry library
+    std::vector<std::string>    meshLocs;
+    std::vector<pugi::xml_node> meshNodes;
+    std::vector<uint32_t>       firstVertex, firstIndex;
+    for(auto loc : hscene_main->MeshFiles())
+      meshLocs.push_back(loc);
+
     for(auto mesh_node : hscene_main->GeomNodes())
     {
       uint32_t vertNum = mesh_node.attribute(L"vertNum").as_int();
       uint32_t primNum = mesh_node.attribute(L"triNum").as_int();
       maxVertexCountPerMesh    = std::max(vertNum, maxVertexCountPerMesh);
       maxPrimitiveCountPerMesh = std::max(primNum, maxPrimitiveCountPerMesh);
+      meshNodes.push_back(mesh_node);
+      firstVertex.push_back(totalVerticesCount);
+      firstIndex.push_back(totalPrimitiveCount * 3);
       totalVerticesCount      += vertNum;
       totalPrimitiveCount     += primNum;
       totalMeshes++;
@@ -80,28 +268,119 @@ bool SceneManager::LoadSceneXML(const std::string &scenePath, bool transpose)
         m_config.build_acc_structs_while_loading_scene);
     }
 
-    for(auto loc : hscene_main->MeshFiles())
-    {
-      auto meshId = AddMeshFromFile(loc);
-
-      if(m_config.debug_output)
-        std::cout << "Loading mesh # " << meshId << std::endl;
-
-      LoadOneMeshOnGPU(meshId);
-      if(m_config.build_acc_structs)
+    // Sizes of all meshes are known, so meshes are decoded in parallel straight to their place in m_pMeshData and m_matIDs.
+    // One thread consumes them in order (GPU upload, BLAS, instances) as soon as the next one is ready and decodes meshes itself while waiting.
+    //
+    m_pMeshData->Resize(totalVerticesCount, totalPrimitiveCount * 3);
+    const size_t firstMatID = m_matIDs.size();
+    m_matIDs.resize(firstMatID + totalPrimitiveCount);
+
+    enum MESH_STATUS { MESH_PENDING = 0, MESH_READY = 1, MESH_FAILED = 2 };
+    std::unique_ptr<std::atomic<int>[]> meshStatus(new std::atomic<int>[totalMeshes]);
+    for(uint32_t i = 0; i < totalMeshes; ++i)
+      meshStatus[i] = MESH_PENDING;
+
+    // exceptions can't leave an OpenMP region, so the first one is kept and rethrown after it; the other meshes are not loaded then
+    //
+    std::exception_ptr loadError;
+    std::mutex         loadErrorMutex;
+    auto keepLoadError = [&]() {
+      std::lock_guard<std::mutex> lock(loadErrorMutex);
+      if(loadError == nullptr)
+        loadError = std::current_exception();
+    };
+
+    std::atomic<uint32_t> nextToDecode(0);
+    auto decodeNextMesh = [&]() {
+      const uint32_t i = nextToDecode++;
+      if(i >= totalMeshes)
+        return false;
+
+      bool matches = false;
+      try
       {
-        AddBLAS(meshId);
+        vsgf::MappedMesh mesh;
+        const bool opened = mesh.Open(meshLocs[i], meshNodes[i]);
+        const auto& view  = mesh.View();
+        matches = opened && view.vertNum == meshNodes[i].attribute(L"vertNum").as_uint() &&
+                            view.indNum  == meshNodes[i].attribute(L"triNum").as_uint() * 3;
+        if(matches)
+        {
+          m_pMeshData->Write(view, firstVertex[i], firstIndex[i]);
+          std::copy(view.matIndices, view.matIndices + view.indNum / 3, m_matIDs.begin() + firstMatID + firstIndex[i] / 3);
+        }
       }
+      catch(...)
+      {
+        keepLoadError();
+        matches = false;
+      }
+      meshStatus[i] = matches ? MESH_READY : MESH_FAILED;
+      return true;
+    };
 
-      auto instances = hscene_main->GetAllInstancesOfMeshLoc(loc);
-      for(size_t j = 0; j < instances.size(); ++j)
+    std::string failedMesh;
+    std::unordered_map<uint32_t, uint32_t> meshIdByGeomId; // geometry library id -> mesh id in scene manager
+    #pragma omp parallel
+    {
+      #pragma omp single nowait
       {
-        if(transpose)
-          InstanceMesh(meshId, LiteMath::transpose(instances[j]));
-        else
-          InstanceMesh(meshId, instances[j]);
+        for(uint32_t i = 0; i < totalMeshes; ++i)
+        {
+          while(meshStatus[i] == MESH_PENDING)
+          {
+            if(!decodeNextMesh())
+              std::this_thread::yield();
+          }
+
+          if(meshStatus[i] == MESH_FAILED)
+          {
+            failedMesh   = meshLocs[i];
+            nextToDecode = totalMeshes;
+            break;
+          }
+
+          try
+          {
+            auto meshId = AddMeshInfo(meshNodes[i].attribute(L"vertNum").as_uint(), meshNodes[i].attribute(L"triNum").as_uint() * 3);
+
+            if(m_config.debug_output)
+              std::cout << "Loading mesh # " << meshId << std::endl;
+
+            LoadOneMeshOnGPU(meshId);
+            if(m_config.build_acc_structs)
+            {
+              AddBLAS(meshId);
+            }
+
+            meshIdByGeomId[meshNodes[i].attribute(L"id").as_uint()] = meshId;
+          }
+          catch(...)
+          {
+            keepLoadError();
+            nextToDecode = totalMeshes;
+            break;
+          }
+        }
       }
+
+      while(decodeNextMesh()) { }
     }
+
+    if(loadError != nullptr)
+      std::rethrow_exception(loadError);
+    if(!failedMesh.empty())
+      RUN_TIME_ERROR(("can't load mesh at " + failedMesh + " or its size differs from the scene library").c_str());
+
+    hscene_main->ForEachInstance([&](const hydra_xml::Instance& inst) {
+      auto found = meshIdByGeomId.find(inst.geomId);
+      if(found == meshIdByGeomId.end())
+        return;
+      if(transpose)
+        InstanceMesh(found->second, LiteMath::transpose(inst.matrix));
+      else
+        InstanceMesh(found->second, inst.matrix);
+    });
   }
 
   for(auto cam : hscene_main->Cameras())
@@ -180,12 +459,15 @@ bool SceneManager::LoadSceneGLTF(const std::string &scenePath)
   else
     sceneFolder = "./";
 
-  bool loaded = gltfContext.LoadASCIIFromFile(&gltfModel, &error, &warning, scenePath);
+  // .bin buffers referenced by .gltf are loaded by tinygltf from sceneFolder, .glb keeps them in its binary chunk
+  const bool binary = scenePath.size() >= 4 && scenePath.compare(scenePath.size() - 4, 4, ".glb") == 0;
+  bool loaded = binary ? gltfContext.LoadBinaryFromFile(&gltfModel, &error, &warning, scenePath)
+                       : gltfContext.LoadASCIIFromFile(&gltfModel, &error, &warning, scenePath);
 
   if(!loaded)
   {
     std::stringstream ss;
-    ss << "Cannot load glTF scene from: " << scenePath;
+    ss << "Cannot load glTF scene from: " << scenePath << ": " << error;
     vk_utils::logWarning(ss.str());
 
     return false;
@@ -214,7 +496,7 @@ bool SceneManager::LoadSceneGLTF(const std::string &scenePath)
 //
 //  }
 
-  m_pMeshData = std::make_shared<Mesh8F>();
+  m_pMeshData = std::make_shared<InterleavedMesh8F>();
 
   uint32_t maxVertexCountPerMesh    = 0u;
   uint32_t maxPrimitiveCountPerMesh = 0u;
@@ -223,11 +505,38 @@ bool SceneManager::LoadSceneGLTF(const std::string &scenePath)
   uint32_t totalMeshes              = 0u;
   if(m_config.load_geometry)
   {
-    for(const auto& mesh : gltfModel.meshes)
+    // Node hierarchy is flattened first, meshes get ids in order of their first instance.
+    // Sizes of all meshes are known from accessors, so they are converted in parallel straight to their place in m_pMeshData
+    // and m_matIDs, and then uploaded at once.
+    //
+    struct GLTFMeshRegion
+    {
+      int      gltfMesh;
+      uint32_t vertNum, indNum;
+      uint32_t firstVertex, firstIndex, firstPrim;
+    };
+    const uint32_t NO_MESH = uint32_t(-1); // mesh without vertices, its instances are skipped
+
+    m_gltfTransforms.Init(gltfModel, scene);
+    const auto instances = flattenGLTFScene(gltfModel, m_gltfTransforms);
+    std::vector<GLTFMeshRegion> meshRegions;
+    std::unordered_map<int, uint32_t> meshIdByGLTFMesh;
+    for(const auto& inst : instances)
     {
-      uint32_t vertNum = 0;
+      if(meshIdByGLTFMesh.count(inst.mesh))
+        continue;
+
+      uint32_t vertNum  = 0;
       uint32_t indexNum = 0;
-      getNumVerticesAndIndicesFromGLTFMesh(gltfModel, mesh, vertNum, indexNum);
+      getNumVerticesAndIndicesFromGLTFMesh(gltfModel, gltfModel.meshes[inst.mesh], vertNum, indexNum);
+      if(vertNum == 0 || indexNum == 0)
+      {
+        meshIdByGLTFMesh[inst.mesh] = NO_MESH;
+        continue;
+      }
+
+      meshIdByGLTFMesh[inst.mesh] = totalMeshes;
+      meshRegions.push_back({inst.mesh, vertNum, indexNum, totalVerticesCount, totalPrimitiveCount * 3, totalPrimitiveCount});
       maxVertexCountPerMesh    = std::max(vertNum, maxVertexCountPerMesh);
       maxPrimitiveCountPerMesh = std::max(indexNum / 3, maxPrimitiveCountPerMesh);
       totalVerticesCount      += vertNum;
@@ -242,12 +551,70 @@ bool SceneManager::LoadSceneGLTF(const std::string &scenePath)
         m_pMeshData->SingleVertexSize(), m_config.build_acc_structs_while_loading_scene);
     }
 
-    std::unordered_map<int, uint32_t> loaded_meshes_to_meshId;
-    for(size_t i = 0; i < scene.nodes.size(); ++i)
+    m_pMeshData->Resize(totalVerticesCount, totalPrimitiveCount * 3);
+    const size_t firstMatID = m_matIDs.size();
+    m_matIDs.resize(firstMatID + totalPrimitiveCount);
+
+    std::atomic<int> failedMesh(-1);
+    #pragma omp parallel for schedule(dynamic)
+    for(int i = 0; i < int(totalMeshes); ++i)
     {
-      const tinygltf::Node node = gltfModel.nodes[scene.nodes[i]];
-      auto identity = LiteMath::float4x4();
-      LoadGLTFNodesRecursive(gltfModel, node, identity, loaded_meshes_to_meshId);
+      const auto& region = meshRegions[i];
+      auto simpleMesh    = simpleMeshFromGLTFMesh(gltfModel, gltfModel.meshes[region.gltfMesh]);
+      if(simpleMesh.VerticesNum() != region.vertNum || simpleMesh.IndicesNum() != region.indNum || region.indNum % 3 != 0)
+      {
+        failedMesh = region.gltfMesh;
+        continue;
+      }
+
+      m_pMeshData->Write(simpleMesh, region.firstVertex, region.firstIndex);
+      std::copy(simpleMesh.matIndices.begin(), simpleMesh.matIndices.end(), m_matIDs.begin() + firstMatID + region.firstPrim);
+    }
+
+    if(failedMesh >= 0)
+    {
+      std::stringstream ss;
+      ss << "Cannot convert glTF mesh # " << failedMesh.load() << " from: " << scenePath;
+      vk_utils::logWarning(ss.str());
+
+      return false;
+    }
+
+    const uint32_t firstMeshId = uint32_t(m_meshInfos.size());
+    for(const auto& region : meshRegions)
+    {
+      auto meshId = AddMeshInfo(region.vertNum, region.indNum);
+      if(m_config.debug_output)
+        std::cout << "Loading mesh # " << meshId << std::endl;
+    }
+
+    if(totalMeshes > 0)
+      LoadMeshesOnGPU(firstMeshId, totalMeshes);
+
+    if(m_config.build_acc_structs)
+    {
+      for(uint32_t i = 0; i < totalMeshes; ++i)
+        AddBLAS(firstMeshId + i);
+    }
+
+    std::vector<std::pair<uint32_t, int>> instanceEntries;
+    for(const auto& inst : instances)
+    {
+      const uint32_t meshId = meshIdByGLTFMesh[inst.mesh];
+      if(meshId != NO_MESH)
+        instanceEntries.emplace_back(InstanceMesh(firstMeshId + meshId, inst.matrix), inst.entry);
+    }
+
+    m_gltfAnimations = animationsFromGLTF(gltfModel, m_gltfTransforms);
+    m_animatedInstances.resize(m_gltfAnimations.size());
+    for(size_t i = 0; i < m_gltfAnimations.size(); ++i)
+    {
+      const auto affected = m_gltfAnimations[i].AffectedEntries(m_gltfTransforms);
+      for(const auto& inst : instanceEntries)
+      {
+        if(affected[inst.second])
+          m_animatedInstances[i].push_back(inst);
+      }
     }
   }
 
@@ -303,41 +670,3 @@ bool SceneManager::LoadSceneGLTF(const std::string &scenePath)
 
   return true;
 }
-
-void SceneManager::LoadGLTFNodesRecursive(const tinygltf::Model &a_model, const tinygltf::Node& a_node, const LiteMath::float4x4& a_parentMatrix,
-  std::unordered_map<int, uint32_t> &a_loadedMeshesToMeshId)
-{
-  auto nodeMatrix = a_parentMatrix * transformMatrixFromGLTFNode(a_node);
-
-  for (size_t i = 0; i < a_node.children.size(); i++)
-  {
-    LoadGLTFNodesRecursive(a_model, a_model.nodes[a_node.children[i]], nodeMatrix, a_loadedMeshesToMeshId);
-  }
-
-  if(a_node.mesh > -1)
-  {
-    if(!a_loadedMeshesToMeshId.count(a_node.mesh))
-    {
-      const tinygltf::Mesh mesh = a_model.meshes[a_node.mesh];
-      auto simpleMesh           = simpleMeshFromGLTFMesh(a_model, mesh);
-
-      if(simpleMesh.VerticesNum() > 0)
-      {
-        auto meshId                         = AddMeshFromData(simpleMesh);
-        a_loadedMeshesToMeshId[a_node.mesh] = meshId;
-
-        if(m_config.debug_output)
-          std::cout << "Loading mesh # " << meshId << std::endl;
-
-        LoadOneMeshOnGPU(meshId);
-
-        if(m_config.build_acc_structs)
-        {
-          AddBLAS(meshId);
-        }
-      }
-    }
-
-    InstanceMesh(a_loadedMeshesToMeshId[a_node.mesh], nodeMatrix);
-  }
-}
\ No newline at end of file
@@ -1,6 +1,9 @@
 #include "simple_render.h"
 #include "utils/glfw_window.h"
 
+#include <algorithm>
+#include <sstream>
+
 void initVulkanGLFW(std::shared_ptr<IRender> &app, GLFWwindow* window, int deviceID)
 {
   uint32_t glfwExtensionCount = 0;
@@ -23,13 +26,86 @@ void initVulkanGLFW(std::shared_ptr<IRender> &app, GLFWwindow* window, int devic
   }
 }
 
-int main()
+// "x,y,z" or "x y z"
+static LiteMath::float3 float3FromString(std::string a_str)
+{
+  std::replace(a_str.begin(), a_str.end(), ',', ' ');
+  std::stringstream inputStream(a_str);
+  LiteMath::float3 res(0, 0, 0);
+  inputStream >> res.x >> res.y >> res.z;
+  return res;
+}
+
+// usage: raytracing -headless [-scene path] [-width 1024] [-height 1024] [-frames 1] [-out frame.png]
+//                   [-cam_pos x,y,z] [-cam_lookat x,y,z] [-cam_up x,y,z] [-cam_fov deg] [-scene_camera] [-device id]
+//                   [-rt_backend Embree|BVH2Common|BVH4Common|BVH4Compressed] [-build_profile fast|balanced|high|refit] [-record_rays rays.bin]
+//                   [-scene_cache dir] [-animation id] [-animation_fps 30]
+int runHeadless(const std::unordered_map<std::string, std::string>& a_params, const std::string& a_scenePath, int a_deviceId)
+{
+  auto getParam = [&a_params](const char* a_name, const std::string& a_default) {
+    auto found = a_params.find(a_name);
+    return (found == a_params.end() || found->second.empty()) ? a_default : found->second;
+  };
+
+  const uint32_t width  = uint32_t(std::stoul(getParam("-width",  "1024")));
+  const uint32_t height = uint32_t(std::stoul(getParam("-height", "1024")));
+
+  auto app = std::make_shared<SimpleRender>(width, height);
+  app->SetSceneCacheDir(getParam("-scene_cache", ""));
+  app->InitHeadless(a_deviceId);
+  app->SetCPUBackend(getParam("-rt_backend", ""));
+  app->SetCPUBuildProfile(getParam("-build_profile", "high"));
+  app->SetRayRecordPath(getParam("-record_rays", ""));
+  app->SetAnimation(std::stoi(getParam("-animation", "-1")));
+  app->LoadScene(a_scenePath.c_str());
+
+  Camera cam;
+  cam.pos    = float3FromString(getParam("-cam_pos",    "0,0,5"));
+  cam.lookAt = float3FromString(getParam("-cam_lookat", "0,0,0"));
+  cam.up     = float3FromString(getParam("-cam_up",     "0,1,0"));
+  cam.fov    = std::stof(getParam("-cam_fov", "45"));
+  app->UpdateCamera(&cam, 1);
+
+  SimpleRender::OfflineSettings settings;
+  settings.framesNum      = uint32_t(std::stoul(getParam("-frames", "1")));
+  settings.outPath        = getParam("-out", "frame.png");
+  settings.useSceneCamera = a_params.count("-scene_camera") != 0;
+  settings.animationFps   = std::stof(getParam("-animation_fps", "30"));
+  app->RenderOffline(settings);
+
+  return 0;
+}
+
+int main(int argc, char** argv)
 {
   constexpr int WIDTH = 1024;
   constexpr int HEIGHT = 1024;
   constexpr int VULKAN_DEVICE_ID = 0;
 
-  std::shared_ptr<IRender> app = std::make_shared<SimpleRender>(WIDTH, HEIGHT);
+  auto params = readCommandLineParams(argc, (const char**)argv);
+  std::string scenePath = "../resources/scenes/buggy/Buggy.gltf";
+//  scenePath = "../resources/scenes/043_cornell_normals/statex_00001.xml";
+  if(params.count("-scene") && !params["-scene"].empty())
+    scenePath = params["-scene"];
+
+  const int deviceId = params.count("-device") ? std::stoi(params["-device"]) : VULKAN_DEVICE_ID;
+
+  if(params.count("-headless"))
+    return runHeadless(params, scenePath, deviceId);
+
+  auto simpleRender = std::make_shared<SimpleRender>(WIDTH, HEIGHT);
+  if(params.count("-rt_backend"))
+    simpleRender->SetCPUBackend(params["-rt_backend"]);
+  if(params.count("-build_profile"))
+    simpleRender->SetCPUBuildProfile(params["-build_profile"]);
+  if(params.count("-record_rays"))
+    simpleRender->SetRayRecordPath(params["-record_rays"]);
+  if(params.count("-scene_cache"))
+    simpleRender->SetSceneCacheDir(params["-scene_cache"]);
+  if(params.count("-animation") && !params["-animation"].empty())
+    simpleRender->SetAnimation(std::stoi(params["-animation"]));
+
+  std::shared_ptr<IRender> app = simpleRender;
 
   if(app == nullptr)
   {
@@ -39,10 +115,9 @@ int main()
 
   auto* window = initWindow(WIDTH, HEIGHT);
 
-  initVulkanGLFW(app, window, VULKAN_DEVICE_ID);
+  initVulkanGLFW(app, window, deviceId);
 
-//  app->LoadScene("../resources/scenes/043_cornell_normals/statex_00001.xml");
-  app->LoadScene("../resources/scenes/buggy/Buggy.gltf");
+  app->LoadScene(scenePath.c_str());
 
   bool showGUI = true;
   mainLoop(app, window, showGUI);
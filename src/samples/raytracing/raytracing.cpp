@@ -1,6 +1,10 @@
 #include "raytracing.h"
 #include "float.h"
 
+#ifndef KERNEL_SLICER
+#include <vector>
+#endif
+
 LiteMath::float3 EyeRayDir(float x, float y, float w, float h, LiteMath::float4x4 a_mViewProjInv)
 {
   LiteMath::float4 pos = LiteMath::make_float4( 2.0f * (x + 0.5f) / w - 1.0f,
@@ -41,4 +45,52 @@ void RayTracer::kernel_RayTrace(uint32_t tidX, uint32_t tidY, const LiteMath::fl
   CRT_Hit hit = m_pAccelStruct->RayQuery_NearestHit(rayPos, rayDir);
 
   out_color[tidY * m_width + tidX] = m_palette[hit.instId % palette_size];
-}
\ No newline at end of file
+}
+
+#ifndef KERNEL_SLICER
+void RayTracer::CastRaysBatch(uint32_t a_startX, uint32_t a_startY, uint32_t a_sizeX, uint32_t a_sizeY, uint32_t* out_color)
+{
+  const size_t raysNum = size_t(a_sizeX) * size_t(a_sizeY);
+
+  // SoA layout: orgX, orgY, orgZ, tNear, dirX, dirY, dirZ, tFar
+  //
+  std::vector<float>   rays(raysNum * 8);
+  std::vector<CRT_Hit> hits(raysNum);
+
+  CRT_RaysSoA batch;
+  batch.orgX  = rays.data() + 0 * raysNum;
+  batch.orgY  = rays.data() + 1 * raysNum;
+  batch.orgZ  = rays.data() + 2 * raysNum;
+  batch.tNear = rays.data() + 3 * raysNum;
+  batch.dirX  = rays.data() + 4 * raysNum;
+  batch.dirY  = rays.data() + 5 * raysNum;
+  batch.dirZ  = rays.data() + 6 * raysNum;
+  batch.tFar  = rays.data() + 7 * raysNum;
+  batch.count = raysNum;
+
+  for(uint32_t y = 0; y < a_sizeY; ++y)
+  {
+    for(uint32_t x = 0; x < a_sizeX; ++x)
+    {
+      LiteMath::float4 rayPosAndNear, rayDirAndFar;
+      kernel_InitEyeRay(a_startX + x, a_startY + y, &rayPosAndNear, &rayDirAndFar);
+
+      const size_t rayId = size_t(y) * a_sizeX + x;
+      rays[0 * raysNum + rayId] = rayPosAndNear.x;
+      rays[1 * raysNum + rayId] = rayPosAndNear.y;
+      rays[2 * raysNum + rayId] = rayPosAndNear.z;
+      rays[3 * raysNum + rayId] = rayPosAndNear.w;
+      rays[4 * raysNum + rayId] = rayDirAndFar.x;
+      rays[5 * raysNum + rayId] = rayDirAndFar.y;
+      rays[6 * raysNum + rayId] = rayDirAndFar.z;
+      rays[7 * raysNum + rayId] = rayDirAndFar.w;
+    }
+  }
+
+  m_pAccelStruct->RayQuery_NearestHitBatch(batch, hits.data());
+
+  for(uint32_t y = 0; y < a_sizeY; ++y)
+    for(uint32_t x = 0; x < a_sizeX; ++x)
+      out_color[(a_startY + y) * m_width + a_startX + x] = m_palette[hits[size_t(y) * a_sizeX + x].instId % palette_size];
+}
+#endif
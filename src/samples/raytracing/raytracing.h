@@ -19,6 +19,11 @@ public:
   void kernel_InitEyeRay(uint32_t tidX, uint32_t tidY, LiteMath::float4* rayPosAndNear, LiteMath::float4* rayDirAndFar);
   void kernel_RayTrace(uint32_t tidX, uint32_t tidY, const LiteMath::float4* rayPosAndNear, const LiteMath::float4* rayDirAndFar, uint32_t* out_color);
 
+#ifndef KERNEL_SLICER
+  // CPU only: trace a rectangular block of pixels with a single batched ray query
+  void CastRaysBatch(uint32_t a_startX, uint32_t a_startY, uint32_t a_sizeX, uint32_t a_sizeY, uint32_t* out_color);
+#endif
+
 protected:
   uint32_t m_width;
   uint32_t m_height;
@@ -18,7 +18,7 @@ SimpleRender::SimpleRender(uint32_t a_width, uint32_t a_height) : m_width(a_widt
 
 void SimpleRender::SetupDeviceFeatures()
 {
-  if(ENABLE_HARDWARE_RT)
+  if(UseHardwareRT())
   {
     // m_enabledDeviceFeatures.fillModeNonSolid = VK_TRUE;
     m_enabledRayQueryFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_QUERY_FEATURES_KHR;
@@ -42,9 +42,10 @@ void SimpleRender::SetupDeviceFeatures()
 
 void SimpleRender::SetupDeviceExtensions()
 {
-  m_deviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+  if(!m_headless)
+    m_deviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
   
-  if(ENABLE_HARDWARE_RT)
+  if(UseHardwareRT())
   {
     m_deviceExtensions.push_back(VK_KHR_ACCELERATION_STRUCTURE_EXTENSION_NAME);
     m_deviceExtensions.push_back(VK_KHR_RAY_QUERY_EXTENSION_NAME);
@@ -90,7 +91,8 @@ void SimpleRender::InitVulkan(const char** a_instanceExtensions, uint32_t a_inst
   CreateDevice(a_deviceId);
   volkLoadDevice(m_device);
 
-  GetRTFeatures();
+  if(UseHardwareRT())
+    GetRTFeatures();
 
   m_commandPool = vk_utils::createCommandPool(m_device, m_queueFamilyIDXs.graphics,
                                               VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
@@ -113,7 +115,8 @@ void SimpleRender::InitVulkan(const char** a_instanceExtensions, uint32_t a_inst
   LoaderConfig conf = {};
   conf.load_geometry = true;
   conf.load_materials = MATERIAL_LOAD_MODE::NONE;
-  if(ENABLE_HARDWARE_RT)
+  conf.scene_cache_dir = m_sceneCacheDir;
+  if(UseHardwareRT())
   {
     conf.build_acc_structs = true;
     conf.build_acc_structs_while_loading_scene = true;
@@ -363,7 +366,8 @@ void SimpleRender::CleanupPipelineAndSwapchain()
     m_screenRenderPass = VK_NULL_HANDLE;
   }
 
-  m_swapchain.Cleanup();
+  if(m_surface != VK_NULL_HANDLE)
+    m_swapchain.Cleanup();
 }
 
 void SimpleRender::RecreateSwapChain()
@@ -403,6 +407,7 @@ void SimpleRender::RecreateSwapChain()
   m_raytracedImageData.resize(m_width * m_height);
   m_pRayTracerCPU = nullptr;
   m_pRayTracerGPU = nullptr;
+  m_pTileScheduler = nullptr;
   SetupRTImage();
   SetupQuadRenderer();
   SetupQuadDescriptors();
@@ -467,7 +472,15 @@ void SimpleRender::UpdateView()
 void SimpleRender::LoadScene(const char* path)
 {
   m_pScnMgr->LoadScene(path);
-  if(ENABLE_HARDWARE_RT)
+  if(m_headless)
+  {
+    // no presentation resources, only CPU ray tracing
+    SetupRTScene();
+    UpdateView();
+    return;
+  }
+
+  if(UseHardwareRT())
   {
     m_pScnMgr->BuildAllBLAS();
     m_pScnMgr->BuildTLAS();
@@ -520,7 +533,7 @@ void SimpleRender::DrawFrameSimple()
   }
   else if(m_currentRenderMode == RenderMode::RAYTRACING)
   {
-    if (ENABLE_HARDWARE_RT)
+    if (UseHardwareRT())
       RayTraceGPU();
     else
       RayTraceCPU();
@@ -562,6 +575,7 @@ void SimpleRender::DrawFrameSimple()
 void SimpleRender::DrawFrame(float a_time, DrawMode a_mode)
 {
   UpdateUniformBuffer(a_time);
+  UpdateAnimation(a_time);
 
   switch (a_mode)
   {
@@ -580,7 +594,8 @@ void SimpleRender::DrawFrame(float a_time, DrawMode a_mode)
 void SimpleRender::Cleanup()
 {
   m_pGUIRender = nullptr;
-  ImGui::DestroyContext();
+  if(ImGui::GetCurrentContext() != nullptr)
+    ImGui::DestroyContext();
   CleanupPipelineAndSwapchain();
   if(m_surface != VK_NULL_HANDLE)
   {
@@ -651,6 +666,7 @@ void SimpleRender::Cleanup()
 
   m_pRayTracerCPU = nullptr;
   m_pRayTracerGPU = nullptr;
+  m_pTileScheduler = nullptr;
 
   m_pBindings = nullptr;
   m_pScnMgr   = nullptr;
@@ -693,6 +709,19 @@ void SimpleRender::SetupGUIElements()
     ImGui::SliderFloat3("Light source position", m_uniforms.lightPos.M, -10.f, 10.f);
 
     ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+    if(m_pTileScheduler && m_currentRenderMode == RenderMode::RAYTRACING)
+    {
+      ImGui::Text("CPU ray tracing %.3f ms, %u threads, %u tiles stolen", m_pTileScheduler->FrameTimeMs(),
+        m_pTileScheduler->ThreadsNum(), m_pTileScheduler->StealsNum());
+      ImGui::Text("Slowest %ux%u tile %.3f ms", m_pTileScheduler->TileSize(), m_pTileScheduler->TileSize(), m_pTileScheduler->MaxTileTimeMs());
+      ImGui::Text("CPU acceleration structure %.2f MB", double(m_cpuRTMemory.totalBytes) / (1024.0 * 1024.0));
+    }
+    if(m_animationId >= 0)
+    {
+      ImGui::Text("Animation: %u instances moved, %.3f ms (evaluation %.3f ms, instances %.3f ms, TLAS %.3f ms)", m_animationStats.movedInstances,
+        m_animationStats.evaluateMs + m_animationStats.instancesMs + m_animationStats.tlasMs, m_animationStats.evaluateMs,
+        m_animationStats.instancesMs, m_animationStats.tlasMs);
+    }
 
     ImGui::NewLine();
 
@@ -735,7 +764,7 @@ void SimpleRender::DrawFrameWithGUI()
   }
   else if(m_currentRenderMode == RenderMode::RAYTRACING)
   {
-    if (ENABLE_HARDWARE_RT)
+    if (UseHardwareRT())
       RayTraceGPU();
     else
       RayTraceCPU();
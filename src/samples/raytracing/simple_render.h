@@ -18,6 +18,7 @@
 #include <render/CrossRT.h>
 #include "raytracing.h"
 #include "raytracing_generated.h"
+#include "../../utils/tile_scheduler.h"
 
 enum class RenderMode
 {
@@ -59,6 +60,28 @@ public:
   void LoadScene(const char *path) override;
   void DrawFrame(float a_time, DrawMode a_mode) override;
 
+  // *** offline rendering without window and swapchain
+  struct OfflineSettings
+  {
+    uint32_t    framesNum      = 1;
+    bool        useSceneCamera = false; ///< take camera #0 from the scene instead of the current one
+    std::string outPath        = "frame.png";
+    float       animationFps   = 30.0f; ///< animation time step between frames, see SetAnimation
+  };
+
+  void InitHeadless(uint32_t a_deviceId);
+  void RenderOffline(const OfflineSettings& a_settings);
+  // ***
+
+  void SetCPUBackend(const std::string& a_name) { m_cpuBackendName = a_name; } ///< see CreateSceneRT, must be called before LoadScene
+  void SetCPUBuildProfile(const std::string& a_name);                           ///< "fast", "balanced", "high" or "refit", must be called before LoadScene
+  void SetRayRecordPath(const std::string& a_path) { m_rayRecordPath = a_path; } ///< record rays of CPU ray tracing to file, see RayRecorderRT; must be called before LoadScene
+  void SetSceneCacheDir(const std::string& a_dir) { m_sceneCacheDir = a_dir; }   ///< see LoaderConfig::scene_cache_dir, must be called before InitVulkan/InitHeadless
+  void SetAnimation(int a_animId) { m_animationId = a_animId; m_animationTime = -1.0f; } ///< play glTF animation of the scene, -1 disables animation
+
+  /// headless mode traces rays on CPU only, so ray tracing extensions and acceleration structures are not requested for it
+  bool UseHardwareRT() const { return ENABLE_HARDWARE_RT && !m_headless; }
+
   //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
   // debugging utils
@@ -148,11 +171,40 @@ protected:
   vk_utils::VulkanImageMem m_rtImage;
   VkSampler                m_rtImageSampler = VK_NULL_HANDLE;
 
+  std::shared_ptr<IMeshData>    m_pAccelStructGeom = nullptr; ///< keeps geometry referenced by m_pAccelStruct alive
   std::shared_ptr<ISceneObject> m_pAccelStruct = nullptr;
+  std::string                   m_cpuBackendName;
+  std::string                   m_cpuBuildProfileName = "high";
+  CRT_BuildProfile              m_cpuBuildProfile     = CRT_BuildProfile::HIGH;
+  std::string                   m_rayRecordPath;
+  std::string                   m_sceneCacheDir;
+  CRT_MemoryStats               m_cpuRTMemory;
+  std::vector<uint32_t>         m_rtInstanceIds; ///< instance id in m_pAccelStruct of each scene instance
+  std::vector<uint32_t>           m_movedRTInstances; ///< UpdateInstances arguments, kept to avoid allocations every frame
+  std::vector<LiteMath::float4x4> m_movedRTMatrices;
+
+  struct AnimationStats
+  {
+    uint32_t movedInstances = 0;
+    float    evaluateMs     = 0.0f; ///< sampling of animation and update of instance matrices in scene manager
+    float    instancesMs    = 0.0f; ///< passing moved instances to CPU acceleration structure
+    float    tlasMs         = 0.0f; ///< top level update, as reported by GetBuildStats() on CPU or measured for RTX; set when the frame is traced
+  };
+  int            m_animationId   = -1;
+  float          m_animationTime = -1.0f; ///< time of the last evaluated frame, animation is not evaluated again until time advances
+  AnimationStats m_animationStats;
+  std::vector<uint32_t> m_pendingInstancesCPU; ///< scene instances moved since the last update of each backend, only the rendered one is updated
+  std::vector<uint32_t> m_pendingInstancesGPU;
+  void UpdateAnimation(float a_time);
+  void UpdateRTInstancesCPU();
+  void UpdateRTInstancesGPU();
   std::unique_ptr<RayTracer> m_pRayTracerCPU;
   std::unique_ptr<RayTracer_GPU> m_pRayTracerGPU;
+  std::unique_ptr<TileScheduler> m_pTileScheduler;
+  static constexpr uint32_t CPU_RT_TILE_SIZE = 16;
   void RayTraceCPU();
   void RayTraceGPU();
+  void TraceFrameCPU();
 
   VkBuffer m_genColorBuffer = VK_NULL_HANDLE;
   VkDeviceMemory m_colorMem = VK_NULL_HANDLE;
@@ -176,6 +228,7 @@ protected:
   uint32_t m_height = 1024u;
   uint32_t m_framesInFlight  = 2u;
   bool m_vsync = false;
+  bool m_headless = false;
 
   VkPhysicalDeviceFeatures m_enabledDeviceFeatures = {};
   std::vector<const char*> m_deviceExtensions      = {};
@@ -0,0 +1,80 @@
+#include "simple_render.h"
+#include "stb_image_write.h"
+
+#include <chrono>
+
+void SimpleRender::InitHeadless(uint32_t a_deviceId)
+{
+  m_headless = true;
+  InitVulkan(nullptr, 0, a_deviceId);
+}
+
+static std::string FramePath(const std::string& a_path, uint32_t a_frameId, uint32_t a_framesNum)
+{
+  if(a_framesNum <= 1)
+    return a_path;
+
+  char suffix[16];
+  snprintf(suffix, sizeof(suffix), "_%04u", a_frameId);
+
+  const auto dot = a_path.find_last_of('.');
+  if(dot == std::string::npos)
+    return a_path + suffix;
+  return a_path.substr(0, dot) + suffix + a_path.substr(dot);
+}
+
+void SimpleRender::RenderOffline(const OfflineSettings& a_settings)
+{
+  if(a_settings.useSceneCamera)
+  {
+    auto loadedCam = m_pScnMgr->GetCamera(0);
+    m_cam.fov    = loadedCam.fov;
+    m_cam.pos    = float3(loadedCam.pos);
+    m_cam.up     = float3(loadedCam.up);
+    m_cam.lookAt = float3(loadedCam.lookAt);
+    m_cam.tdist  = loadedCam.farPlane;
+    UpdateView();
+  }
+
+  // ray traced image has the first row at the bottom
+  stbi_flip_vertically_on_write(1);
+
+  if(m_animationId >= 0 && uint32_t(m_animationId) >= m_pScnMgr->AnimationsNum())
+    std::cout << "[SimpleRender::RenderOffline]: scene has no animation # " << m_animationId << ", " << m_pScnMgr->AnimationsNum() << " available" << std::endl;
+
+  double totalMs = 0.0, totalAnimMs = 0.0;
+  for(uint32_t frame = 0; frame < a_settings.framesNum; ++frame)
+  {
+    UpdateAnimation(float(frame) / a_settings.animationFps);
+    UpdateRTInstancesCPU();
+    const double animMs = m_animationStats.evaluateMs + m_animationStats.instancesMs + m_animationStats.tlasMs;
+    totalAnimMs += animMs;
+    if(m_animationStats.movedInstances > 0)
+    {
+      std::cout << "frame " << frame << " animation: " << m_animationStats.movedInstances << " instances, " << animMs << " ms (evaluation "
+                << m_animationStats.evaluateMs << " ms, instances " << m_animationStats.instancesMs << " ms, TLAS " << m_animationStats.tlasMs << " ms)" << std::endl;
+    }
+
+    const auto start = std::chrono::high_resolution_clock::now();
+    TraceFrameCPU();
+    const auto end   = std::chrono::high_resolution_clock::now();
+
+    const double frameMs = std::chrono::duration<double, std::milli>(end - start).count();
+    totalMs += frameMs;
+
+    const std::string path = FramePath(a_settings.outPath, frame, a_settings.framesNum);
+    if(!stbi_write_png(path.c_str(), int(m_width), int(m_height), 4, m_raytracedImageData.data(), int(m_width * sizeof(uint32_t))))
+      std::cout << "[SimpleRender::RenderOffline]: can't write image to " << path << std::endl;
+
+    std::cout << "frame " << frame << ": " << frameMs << " ms, slowest tile " << m_pTileScheduler->MaxTileTimeMs() << " ms -> " << path << std::endl;
+  }
+
+  if(a_settings.framesNum > 0)
+  {
+    const double avgMs = totalMs / double(a_settings.framesNum);
+    std::cout << "backend: " << (m_cpuBackendName.empty() ? "default" : m_cpuBackendName) << ", ";
+    std::cout << "average: " << avgMs << " ms/frame, " << double(m_width) * double(m_height) / (avgMs * 1000.0) << " Mrays/s" << std::endl;
+    if(m_animationId >= 0)
+      std::cout << "average animation update: " << totalAnimMs / double(a_settings.framesNum) << " ms/frame" << std::endl;
+  }
+}
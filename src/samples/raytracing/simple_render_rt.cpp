@@ -1,7 +1,11 @@
 #include <render/VulkanRTX.h>
+#include <render/RayRecorderRT.h>
 #include "simple_render.h"
 #include "raytracing_generated.h"
 
+#include <algorithm>
+#include <chrono>
+
 // ***************************************************************************************************************************
 // setup full screen quad to display ray traced image
 void SimpleRender::SetupQuadRenderer()
@@ -40,45 +44,165 @@ void SimpleRender::SetupRTImage()
 }
 // ***************************************************************************************************************************
 
+void SimpleRender::SetCPUBuildProfile(const std::string& a_name)
+{
+  if(a_name == "fast")
+    m_cpuBuildProfile = CRT_BuildProfile::FAST;
+  else if(a_name == "balanced")
+    m_cpuBuildProfile = CRT_BuildProfile::BALANCED;
+  else if(a_name == "high")
+    m_cpuBuildProfile = CRT_BuildProfile::HIGH;
+  else if(a_name == "refit")
+    m_cpuBuildProfile = CRT_BuildProfile::REFIT;
+  else
+  {
+    std::cout << "SimpleRender::SetCPUBuildProfile: unknown profile '" << a_name << "', 'high' is used" << std::endl;
+    m_cpuBuildProfileName = "high";
+    m_cpuBuildProfile     = CRT_BuildProfile::HIGH;
+    return;
+  }
+  m_cpuBuildProfileName = a_name;
+}
+
 // convert geometry data and pass it to acceleration structure builder
 void SimpleRender::SetupRTScene()
 {
-  m_pAccelStruct = std::shared_ptr<ISceneObject>(CreateSceneRT(""));
+  m_pAccelStruct = std::shared_ptr<ISceneObject>(CreateSceneRT(m_cpuBackendName.c_str()));
+  if(!m_rayRecordPath.empty())
+    m_pAccelStruct = std::make_shared<RayRecorderRT>(m_pAccelStruct, m_rayRecordPath);
+  m_pAccelStruct->SetBuildProfile(m_cpuBuildProfile);
   m_pAccelStruct->ClearGeom();
 
   auto meshesData = m_pScnMgr->GetMeshData();
+  m_pAccelStructGeom = meshesData;
   std::unordered_map<uint32_t, uint32_t> meshMap;
+  size_t sceneGeomBytes = 0;
   for(size_t i = 0; i < m_pScnMgr->MeshesNum(); ++i)
   {
     const auto& info = m_pScnMgr->GetMeshInfo(i);
-    auto vertices = reinterpret_cast<float*>((char*)meshesData->VertexData() + info.m_vertexOffset * meshesData->SingleVertexSize());
-    auto indices = meshesData->IndexData() + info.m_indexOffset;
+    sceneGeomBytes += info.m_vertNum * meshesData->SingleVertexSize() + info.m_indNum * meshesData->SingleIndexSize();
 
-    auto stride = meshesData->SingleVertexSize() / sizeof(float);
-    std::vector<float4> m_vPos4f(info.m_vertNum);
-    std::vector<uint32_t> m_indicesReordered(info.m_indNum);
-    for(size_t v = 0; v < info.m_vertNum; ++v)
-    {
-      m_vPos4f[v] = float4(vertices[v * stride + 0], vertices[v * stride + 1], vertices[v * stride + 2], 1.0f);
-    }
-    memcpy(m_indicesReordered.data(), indices, info.m_indNum * sizeof(m_indicesReordered[0]));
+    // positions are the first 3 floats of each interleaved vertex; backend may use mesh data in place
+    const size_t vertOffset = info.m_vertexOffset * meshesData->SingleVertexSize();
+    auto indices = meshesData->IndexData() + info.m_indexOffset;
 
-    auto geomId = m_pAccelStruct->AddGeom_Triangles4f(m_vPos4f.data(), m_vPos4f.size(), m_indicesReordered.data(), m_indicesReordered.size());
+    auto geomId = m_pAccelStruct->AddGeom_Triangles3fStrided(meshesData->VertexData(), vertOffset, meshesData->SingleVertexSize(), info.m_vertNum,
+                                                             indices, info.m_indNum);
     meshMap[i] = geomId;
   }
 
   m_pAccelStruct->ClearScene();
+  m_rtInstanceIds.assign(m_pScnMgr->InstancesNum(), uint32_t(-1));
   for(size_t i = 0; i < m_pScnMgr->InstancesNum(); ++i)
   {
     const auto& info = m_pScnMgr->GetInstanceInfo(i);
     if(meshMap.count(info.mesh_id))
-      m_pAccelStruct->AddInstance(meshMap[info.mesh_id], m_pScnMgr->GetInstanceMatrix(info.inst_id));
+      m_rtInstanceIds[info.inst_id] = m_pAccelStruct->AddInstance(meshMap[info.mesh_id], m_pScnMgr->GetInstanceMatrix(info.inst_id));
   }
   m_pAccelStruct->CommitScene();
+  m_pendingInstancesCPU.clear();
+
+  const auto buildStats = m_pAccelStruct->GetBuildStats();
+  std::cout << "CPU RT (" << (m_cpuBackendName.empty() ? "default" : m_cpuBackendName) << ") build, '" << m_cpuBuildProfileName << "' profile: " << buildStats.blasNum << " BLAS in "
+            << buildStats.blasBuildMs << " ms, TLAS in " << buildStats.tlasBuildMs << " ms" << std::endl;
+
+  m_cpuRTMemory = m_pAccelStruct->GetMemoryStats();
+  const double MB = 1024.0 * 1024.0;
+  std::cout << "CPU RT (" << (m_cpuBackendName.empty() ? "default" : m_cpuBackendName) << ") memory: " << double(m_cpuRTMemory.totalBytes) / MB << " MB";
+  if(m_cpuRTMemory.nodesBytes != 0)
+    std::cout << " (nodes " << double(m_cpuRTMemory.nodesBytes) / MB << " MB, primitives " << double(m_cpuRTMemory.primitivesBytes) / MB << " MB)";
+  std::cout << ", scene geometry: " << double(sceneGeomBytes) / MB << " MB" << std::endl;
+}
+
+// moved instances are accumulated for each backend; duplicates are removed once the list outgrows the scene
+static void addPendingInstances(std::vector<uint32_t>& a_pending, const std::vector<uint32_t>& a_moved, size_t a_instancesNum)
+{
+  a_pending.insert(a_pending.end(), a_moved.begin(), a_moved.end());
+  if(a_pending.size() > a_instancesNum)
+  {
+    std::sort(a_pending.begin(), a_pending.end());
+    a_pending.erase(std::unique(a_pending.begin(), a_pending.end()), a_pending.end());
+  }
+}
+
+// evaluate animation of the scene if its time has advanced; acceleration structures are updated later by the backend which renders the frame
+void SimpleRender::UpdateAnimation(float a_time)
+{
+  m_animationStats.movedInstances = 0;
+  m_animationStats.evaluateMs     = 0.0f;
+  if(m_animationId < 0 || uint32_t(m_animationId) >= m_pScnMgr->AnimationsNum() || a_time == m_animationTime)
+    return;
+  m_animationTime = a_time;
+
+  const auto start = std::chrono::high_resolution_clock::now();
+  const auto& moved = m_pScnMgr->UpdateAnimation(uint32_t(m_animationId), a_time);
+  if(m_pAccelStruct != nullptr)
+    addPendingInstances(m_pendingInstancesCPU, moved, m_pScnMgr->InstancesNum());
+  if(UseHardwareRT())
+    addPendingInstances(m_pendingInstancesGPU, moved, m_pScnMgr->InstancesNum());
+  const auto evaluated = std::chrono::high_resolution_clock::now();
+
+  m_animationStats.movedInstances = uint32_t(moved.size());
+  m_animationStats.evaluateMs     = std::chrono::duration<float, std::milli>(evaluated - start).count();
+}
+
+// pass instances moved since the last CPU frame to CPU acceleration structure with a single top level update
+void SimpleRender::UpdateRTInstancesCPU()
+{
+  m_animationStats.instancesMs = 0.0f;
+  m_animationStats.tlasMs      = 0.0f;
+  if(m_pAccelStruct == nullptr || m_pendingInstancesCPU.empty())
+    return;
+
+  const auto start = std::chrono::high_resolution_clock::now();
+  std::sort(m_pendingInstancesCPU.begin(), m_pendingInstancesCPU.end());
+  m_pendingInstancesCPU.erase(std::unique(m_pendingInstancesCPU.begin(), m_pendingInstancesCPU.end()), m_pendingInstancesCPU.end());
+
+  m_movedRTInstances.clear();
+  m_movedRTMatrices.clear();
+  for(uint32_t instId : m_pendingInstancesCPU)
+  {
+    if(m_rtInstanceIds[instId] == uint32_t(-1))
+      continue;
+    m_movedRTInstances.push_back(m_rtInstanceIds[instId]);
+    m_movedRTMatrices.push_back(m_pScnMgr->GetInstanceMatrix(instId));
+  }
+  m_pendingInstancesCPU.clear();
+  m_pAccelStruct->UpdateInstances(m_movedRTInstances.data(), m_movedRTMatrices.data(), m_movedRTInstances.size());
+  const auto updated = std::chrono::high_resolution_clock::now();
+
+  const float updateMs         = std::chrono::duration<float, std::milli>(updated - start).count();
+  m_animationStats.tlasMs      = m_pAccelStruct->GetBuildStats().tlasBuildMs;
+  m_animationStats.instancesMs = std::max(updateMs - m_animationStats.tlasMs, 0.0f);
+}
+
+// refit RTX top level in place for instances moved since the last GPU frame, only their entries of the instance buffer are copied
+void SimpleRender::UpdateRTInstancesGPU()
+{
+  m_animationStats.instancesMs = 0.0f;
+  m_animationStats.tlasMs      = 0.0f;
+  if(!m_pRayTracerGPU || m_pendingInstancesGPU.empty())
+    return;
+
+  const auto start = std::chrono::high_resolution_clock::now();
+  m_pScnMgr->UpdateTLAS(m_pendingInstancesGPU.data(), m_pendingInstancesGPU.size());
+  m_pendingInstancesGPU.clear();
+  const auto updated = std::chrono::high_resolution_clock::now();
+
+  m_animationStats.tlasMs = std::chrono::duration<float, std::milli>(updated - start).count();
 }
 
 // perform ray tracing on the CPU and upload resulting image on the GPU
 void SimpleRender::RayTraceCPU()
+{
+  UpdateRTInstancesCPU();
+  TraceFrameCPU();
+
+  m_pCopyHelper->UpdateImage(m_rtImage.image, m_raytracedImageData.data(), m_width, m_height, 4, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+}
+
+// perform ray tracing on the CPU into m_raytracedImageData
+void SimpleRender::TraceFrameCPU()
 {
   if(!m_pRayTracerCPU)
   {
@@ -86,18 +210,17 @@ void SimpleRender::RayTraceCPU()
     m_pRayTracerCPU->SetScene(m_pAccelStruct);
   }
 
-  m_pRayTracerCPU->UpdateView(m_cam.pos, m_inverseProjViewMatrix);
-
-  #pragma omp parallel for default(none)
-  for (int j = 0; j < m_height; ++j)
+  if(!m_pTileScheduler)
   {
-    for (int i = 0; i < m_width; ++i)
-    {
-      m_pRayTracerCPU->CastSingleRay(i, j, m_raytracedImageData.data());
-    }
+    m_pTileScheduler = std::make_unique<TileScheduler>(m_width, m_height, CPU_RT_TILE_SIZE);
   }
 
-  m_pCopyHelper->UpdateImage(m_rtImage.image, m_raytracedImageData.data(), m_width, m_height, 4, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+  m_pRayTracerCPU->UpdateView(m_cam.pos, m_inverseProjViewMatrix);
+
+  // one batched ray query per tile; tiles are balanced between threads by work stealing
+  m_pTileScheduler->Run([this](const RenderTile& tile) {
+    m_pRayTracerCPU->CastRaysBatch(tile.x, tile.y, tile.width, tile.height, m_raytracedImageData.data());
+  });
 }
 
 void SimpleRender::RayTraceGPU()
@@ -115,12 +238,14 @@ void SimpleRender::RayTraceGPU()
 
     auto tmp = std::make_shared<VulkanRTX>(m_pScnMgr);
     tmp->CommitScene();
+    m_pendingInstancesGPU.clear(); // top level is built with current matrices
 
     m_pRayTracerGPU->SetScene(tmp);
     m_pRayTracerGPU->SetVulkanInOutFor_CastSingleRay(m_genColorBuffer, 0);
     m_pRayTracerGPU->UpdateAll(m_pCopyHelper);
   }
 
+  UpdateRTInstancesGPU();
   m_pRayTracerGPU->UpdateView(m_cam.pos, m_inverseProjViewMatrix);
   m_pRayTracerGPU->UpdatePlainMembers(m_pCopyHelper);
   
@@ -0,0 +1,349 @@
+#include "rt_bench.h"
+#include "render/RayRecorderRT.h"
+#include "utils/command_line.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+static constexpr size_t RAYS_PER_BATCH = 4096;
+
+struct RaySetResult
+{
+  std::string name;
+  size_t      raysNum = 0;
+  size_t      hitsNum = 0;
+  double      bestMs  = 0.0;
+  double      avgMs   = 0.0;
+};
+
+// "a,b,c"
+static std::vector<std::string> splitList(const std::string& a_str)
+{
+  std::vector<std::string> res;
+  std::stringstream inputStream(a_str);
+  std::string item;
+  while(std::getline(inputStream, item, ','))
+    if(!item.empty())
+      res.push_back(item);
+  return res;
+}
+
+static bool profileFromString(const std::string& a_name, CRT_BuildProfile& a_profile)
+{
+  if(a_name == "fast")          a_profile = CRT_BuildProfile::FAST;
+  else if(a_name == "balanced") a_profile = CRT_BuildProfile::BALANCED;
+  else if(a_name == "high")     a_profile = CRT_BuildProfile::HIGH;
+  else if(a_name == "refit")    a_profile = CRT_BuildProfile::REFIT;
+  else
+    return false;
+  return true;
+}
+
+static CRT_RaysSoA sliceRays(const CRT_RaysSoA& a_rays, size_t a_first, size_t a_count)
+{
+  CRT_RaysSoA res = a_rays;
+  res.orgX  += a_first; res.orgY += a_first; res.orgZ += a_first; res.tNear += a_first;
+  res.dirX  += a_first; res.dirY += a_first; res.dirZ += a_first; res.tFar  += a_first;
+  res.count  = a_count;
+  return res;
+}
+
+static void traceNearest(ISceneObject* a_pRT, const CRT_RaysSoA& a_rays, CRT_Hit* out_hits)
+{
+  const int64_t batchesNum = int64_t((a_rays.count + RAYS_PER_BATCH - 1) / RAYS_PER_BATCH);
+  #pragma omp parallel for schedule(dynamic)
+  for(int64_t batch = 0; batch < batchesNum; batch++)
+  {
+    const size_t first = size_t(batch)*RAYS_PER_BATCH;
+    const size_t count = std::min(RAYS_PER_BATCH, a_rays.count - first);
+    a_pRT->RayQuery_NearestHitBatch(sliceRays(a_rays, first, count), out_hits + first);
+  }
+}
+
+static void traceAny(ISceneObject* a_pRT, const CRT_RaysSoA& a_rays, bool* out_hits)
+{
+  const int64_t batchesNum = int64_t((a_rays.count + RAYS_PER_BATCH - 1) / RAYS_PER_BATCH);
+  #pragma omp parallel for schedule(dynamic)
+  for(int64_t batch = 0; batch < batchesNum; batch++)
+  {
+    const size_t first = size_t(batch)*RAYS_PER_BATCH;
+    const size_t count = std::min(RAYS_PER_BATCH, a_rays.count - first);
+    a_pRT->RayQuery_AnyHitBatch(sliceRays(a_rays, first, count), out_hits + first);
+  }
+}
+
+// one untimed warm-up pass, then a_iters timed passes; ray set may consist of several parts, e.g. chunks of ray log
+static RaySetResult benchRaySet(ISceneObject* a_pRT, const std::string& a_name, const std::vector<CRT_RaysSoA>& a_parts, bool a_anyHit, uint32_t a_iters)
+{
+  RaySetResult res;
+  res.name    = a_name;
+  res.bestMs  = 1e30;
+
+  size_t maxPartSize = 0;
+  for(const auto& part : a_parts)
+  {
+    res.raysNum += part.count;
+    maxPartSize  = std::max(maxPartSize, part.count);
+  }
+
+  std::vector<CRT_Hit>    hits(a_anyHit ? 0 : maxPartSize);
+  std::unique_ptr<bool[]> anyHits(new bool[a_anyHit ? maxPartSize : 0]);
+
+  for(uint32_t iter = 0; iter <= a_iters; iter++)
+  {
+    const auto start = std::chrono::high_resolution_clock::now();
+    size_t hitsNum = 0;
+    for(const auto& part : a_parts)
+    {
+      if(a_anyHit)
+      {
+        traceAny(a_pRT, part, anyHits.get());
+        for(size_t i = 0; i < part.count; i++)
+          hitsNum += anyHits[i] ? 1 : 0;
+      }
+      else
+      {
+        traceNearest(a_pRT, part, hits.data());
+        for(size_t i = 0; i < part.count; i++)
+          hitsNum += (hits[i].primId != uint32_t(-1)) ? 1 : 0;
+      }
+    }
+    const auto end = std::chrono::high_resolution_clock::now();
+
+    if(iter == 0)
+    {
+      res.hitsNum = hitsNum;
+      continue;
+    }
+
+    const double ms = std::chrono::duration<double, std::milli>(end - start).count();
+    res.bestMs  = std::min(res.bestMs, ms);
+    res.avgMs  += ms / double(a_iters);
+  }
+
+  return res;
+}
+
+// all instances are moved with one UpdateInstances call per iteration and put back in place at the end; returns the best time
+// a_instIds are ids of a_scene.instances in a_pRT, as returned by UploadBenchScene
+static double benchInstanceUpdate(ISceneObject* a_pRT, const BenchScene& a_scene, const std::vector<uint32_t>& a_instIds, uint32_t a_iters)
+{
+  const LiteMath::float3 offset = LiteMath::float3(0.01f * LiteMath::length(a_scene.boxMax - a_scene.boxMin), 0.0f, 0.0f);
+
+  const std::vector<uint32_t>&    ids = a_instIds;
+  std::vector<LiteMath::float4x4> original(ids.size()), moved(ids.size());
+  for(size_t i = 0; i < ids.size(); i++)
+  {
+    original[i] = a_scene.instances[i].matrix;
+    moved[i]    = LiteMath::translate4x4(offset) * original[i];
+  }
+
+  double bestMs = 1e30;
+  for(uint32_t iter = 0; iter < a_iters; iter++)
+  {
+    const auto start = std::chrono::high_resolution_clock::now();
+    a_pRT->UpdateInstances(ids.data(), (iter % 2 == 0) ? moved.data() : original.data(), ids.size());
+    const auto end   = std::chrono::high_resolution_clock::now();
+    bestMs = std::min(bestMs, std::chrono::duration<double, std::milli>(end - start).count());
+  }
+
+  a_pRT->UpdateInstances(ids.data(), original.data(), ids.size());
+  return bestMs;
+}
+
+// quoted JSON string; scene file names and backend names may contain quotes, backslashes or control characters
+static std::string jsonString(const std::string& a_str)
+{
+  std::string res = "\"";
+  for(const char c : a_str)
+  {
+    switch(c)
+    {
+    case '"':  res += "\\\""; break;
+    case '\\': res += "\\\\"; break;
+    case '\n': res += "\\n";  break;
+    case '\r': res += "\\r";  break;
+    case '\t': res += "\\t";  break;
+    default:
+      if(static_cast<unsigned char>(c) < 0x20)
+      {
+        char code[8];
+        snprintf(code, sizeof(code), "\\u%04x", unsigned(c));
+        res += code;
+      }
+      else
+        res += c;
+      break;
+    }
+  }
+  res += '"';
+  return res;
+}
+
+// JSON has no inf and nan, e.g. throughput of ray set that took zero time
+static std::string jsonNumber(double a_value)
+{
+  if(!std::isfinite(a_value))
+    return "null";
+  std::stringstream res;
+  res << a_value;
+  return res.str();
+}
+
+static std::string sceneName(const std::string& a_path)
+{
+  const auto slash = a_path.find_last_of("/\\");
+  return (slash == std::string::npos) ? a_path : a_path.substr(slash + 1);
+}
+
+// usage: rt_bench [-scenes path1,path2] [-backends BVH2Common,BVH4Common,BVH4Compressed,Embree] [-profiles fast,balanced,high,refit]
+//                 [-width 1024] [-height 1024] [-random_rays 1048576] [-iters 5] [-out rt_bench.json] [-replay rays.bin]
+// ray log recorded with "raytracing -record_rays rays.bin" is replayed for every scene, so use it with the scene it was recorded for
+int main(int argc, const char** argv)
+{
+  auto params   = readCommandLineParams(argc, argv);
+  auto getParam = [&params](const char* a_name, const std::string& a_default) {
+    auto found = params.find(a_name);
+    return (found == params.end() || found->second.empty()) ? a_default : found->second;
+  };
+
+#ifdef USE_EMBREE
+  const std::string defaultBackends = "BVH2Common,BVH4Common,BVH4Compressed,Embree";
+#else
+  const std::string defaultBackends = "BVH2Common,BVH4Common,BVH4Compressed";
+#endif
+
+  const auto     scenes     = splitList(getParam("-scenes", "../resources/scenes/043_cornell_normals/statex_00001.xml,../resources/scenes/buggy/Buggy.gltf"));
+  const auto     backends   = splitList(getParam("-backends", defaultBackends));
+  const auto     profiles   = splitList(getParam("-profiles", "high"));
+  const uint32_t width      = uint32_t(std::stoul(getParam("-width",  "1024")));
+  const uint32_t height     = uint32_t(std::stoul(getParam("-height", "1024")));
+  const size_t   randomNum  = size_t(std::stoull(getParam("-random_rays", "1048576")));
+  const uint32_t iters      = std::max(1u, uint32_t(std::stoul(getParam("-iters", "5"))));
+  const std::string outPath = getParam("-out", "rt_bench.json");
+
+  RayLogReader rayLog;
+  std::vector<CRT_RaysSoA> replayNearest, replayAny;
+  if(params.count("-replay") && rayLog.Open(params["-replay"]))
+  {
+    for(const auto& chunk : rayLog.Chunks())
+      (chunk.type == CRT_RAY_QUERY_ANY ? replayAny : replayNearest).push_back(chunk.rays);
+    std::cout << "rt_bench: replay " << rayLog.RaysNum(CRT_RAY_QUERY_NEAREST) << " nearest hit and " << rayLog.RaysNum(CRT_RAY_QUERY_ANY) << " any hit rays" << std::endl;
+  }
+
+#ifdef _OPENMP
+  const int threadsNum = omp_get_max_threads();
+#else
+  const int threadsNum = 1;
+#endif
+
+  std::stringstream json;
+  json << "{\n";
+  json << "  \"threads\": " << threadsNum << ",\n";
+  json << "  \"width\": " << width << ", \"height\": " << height << ", \"iters\": " << iters << ",\n";
+  json << "  \"results\": [";
+
+  bool firstResult = true;
+  for(const auto& scenePath : scenes)
+  {
+    BenchScene scene;
+    if(!LoadBenchScene(scenePath, scene))
+    {
+      std::cout << "rt_bench: can't load scene " << scenePath << ", skipped" << std::endl;
+      continue;
+    }
+
+    // shadow rays start at primary hit points, so find them once with the reference backend
+    //
+    const BenchRays primaryRays = MakePrimaryRays(scene, width, height);
+    const BenchRays randomRays  = MakeRandomRays(scene, randomNum, 0x12345u);
+    BenchRays shadowRays;
+    {
+      std::unique_ptr<ISceneObject> pRef(CreateSceneRT("BVH2Common"));
+      UploadBenchScene(scene, pRef.get());
+      std::vector<CRT_Hit> primaryHits(primaryRays.count);
+      traceNearest(pRef.get(), primaryRays.Rays(), primaryHits.data());
+      shadowRays = MakeShadowRays(scene, primaryRays, primaryHits);
+    }
+
+    std::cout << "rt_bench: " << sceneName(scenePath) << ", " << scene.TrianglesNum() << " triangles in " << scene.instances.size() << " instances" << std::endl;
+
+    for(const auto& backend : backends)
+    {
+      for(const auto& profileName : profiles)
+      {
+        CRT_BuildProfile profile;
+        if(!profileFromString(profileName, profile))
+        {
+          std::cout << "rt_bench: unknown build profile '" << profileName << "', skipped" << std::endl;
+          continue;
+        }
+
+        std::unique_ptr<ISceneObject> pRT(CreateSceneRT(backend.c_str()));
+        pRT->SetBuildProfile(profile);
+
+        const auto buildStart = std::chrono::high_resolution_clock::now();
+        const std::vector<uint32_t> instIds = UploadBenchScene(scene, pRT.get());
+        const auto buildEnd   = std::chrono::high_resolution_clock::now();
+
+        const double          buildMs    = std::chrono::duration<double, std::milli>(buildEnd - buildStart).count();
+        const CRT_BuildStats  buildStats = pRT->GetBuildStats();
+        const CRT_MemoryStats memStats   = pRT->GetMemoryStats();
+
+        std::vector<RaySetResult> results;
+        results.push_back(benchRaySet(pRT.get(), "primary", {primaryRays.Rays()}, false, iters));
+        results.push_back(benchRaySet(pRT.get(), "shadow",  {shadowRays.Rays()},   true,  iters));
+        results.push_back(benchRaySet(pRT.get(), "random",  {randomRays.Rays()},   false, iters));
+        if(!replayNearest.empty())
+          results.push_back(benchRaySet(pRT.get(), "replay_nearest", replayNearest, false, iters));
+        if(!replayAny.empty())
+          results.push_back(benchRaySet(pRT.get(), "replay_any", replayAny, true, iters));
+
+        const double updateMs = benchInstanceUpdate(pRT.get(), scene, instIds, iters);
+
+        std::cout << "  " << backend << "/" << profileName << ": build " << buildMs << " ms, " << double(memStats.totalBytes)/(1024.0*1024.0) << " MB";
+        for(const auto& res : results)
+          std::cout << ", " << res.name << " " << double(res.raysNum)/(res.bestMs*1000.0) << " Mrays/s";
+        std::cout << ", update of all instances " << updateMs << " ms" << std::endl;
+
+        json << (firstResult ? "\n" : ",\n");
+        json << "    {\n";
+        json << "      \"scene\": " << jsonString(sceneName(scenePath)) << ", \"triangles\": " << scene.TrianglesNum() << ", \"instances\": " << scene.instances.size() << ",\n";
+        json << "      \"backend\": " << jsonString(backend) << ", \"profile\": " << jsonString(profileName) << ",\n";
+        json << "      \"build_ms\": " << jsonNumber(buildMs) << ", \"blas_build_ms\": " << jsonNumber(buildStats.blasBuildMs)
+             << ", \"tlas_build_ms\": " << jsonNumber(buildStats.tlasBuildMs) << ", \"instance_update_ms\": " << jsonNumber(updateMs) << ",\n";
+        json << "      \"memory_bytes\": " << memStats.totalBytes << ", \"nodes_bytes\": " << memStats.nodesBytes << ", \"primitives_bytes\": " << memStats.primitivesBytes << ",\n";
+        json << "      \"rays\": {";
+        for(size_t i = 0; i < results.size(); i++)
+        {
+          const auto& res = results[i];
+          json << (i == 0 ? "\n" : ",\n");
+          json << "        " << jsonString(res.name) << ": { \"count\": " << res.raysNum << ", \"hits\": " << res.hitsNum
+               << ", \"best_ms\": " << jsonNumber(res.bestMs) << ", \"avg_ms\": " << jsonNumber(res.avgMs)
+               << ", \"mrays_per_sec\": " << jsonNumber(double(res.raysNum)/(res.bestMs*1000.0)) << " }";
+        }
+        json << "\n      }\n";
+        json << "    }";
+        firstResult = false;
+      }
+    }
+  }
+
+  json << "\n  ]\n}\n";
+
+  std::ofstream fout(outPath);
+  fout << json.str();
+  std::cout << "rt_bench: results are saved to " << outPath << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,272 @@
+#include "rt_bench.h"
+#include "loader_utils/hydraxml.h"
+#include "loader_utils/gltf_utils.h"
+
+#include <cfloat>
+#include <iostream>
+#include <random>
+
+#define TINYGLTF_IMPLEMENTATION
+#define TINYGLTF_NO_EXTERNAL_IMAGE
+#define TINYGLTF_NOEXCEPTION
+#define TINYGLTF_USE_CPP14
+#include "tiny_gltf.h"
+
+using LiteMath::float3;
+using LiteMath::float4;
+using LiteMath::float4x4;
+
+size_t BenchScene::TrianglesNum() const
+{
+  size_t res = 0;
+  for(const auto& inst : instances)
+    res += meshes[inst.meshId].IndicesNum() / 3;
+  return res;
+}
+
+static void UpdateBounds(BenchScene& a_scene)
+{
+  a_scene.boxMin = float3(+FLT_MAX, +FLT_MAX, +FLT_MAX);
+  a_scene.boxMax = float3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+  for(const auto& inst : a_scene.instances)
+  {
+    const auto& mesh = a_scene.meshes[inst.meshId];
+    for(size_t i = 0; i < mesh.VerticesNum(); i++)
+    {
+      const float3 pos = inst.matrix * float3(mesh.vPos4f[i*4 + 0], mesh.vPos4f[i*4 + 1], mesh.vPos4f[i*4 + 2]);
+      a_scene.boxMin   = LiteMath::min(a_scene.boxMin, pos);
+      a_scene.boxMax   = LiteMath::max(a_scene.boxMax, pos);
+    }
+  }
+}
+
+static bool LoadBenchSceneXML(const std::string& a_path, BenchScene& a_scene)
+{
+  hydra_xml::HydraScene hscene;
+  if(hscene.LoadState(a_path) < 0)
+    return false;
+
+  for(auto loc : hscene.MeshFiles())
+  {
+    auto mesh = cmesh::LoadMeshFromVSGF(loc.c_str());
+    if(mesh.VerticesNum() == 0)
+    {
+      std::cout << "LoadBenchScene: can't load mesh from " << loc << std::endl;
+      continue;
+    }
+
+    const uint32_t meshId = uint32_t(a_scene.meshes.size());
+    a_scene.meshes.push_back(std::move(mesh));
+    for(const auto& matrix : hscene.GetAllInstancesOfMeshLoc(loc))
+      a_scene.instances.push_back({meshId, matrix});
+  }
+
+  for(auto cam : hscene.Cameras())
+  {
+    a_scene.hasCamera = true;
+    a_scene.camPos    = float3(cam.pos);
+    a_scene.camLookAt = float3(cam.lookAt);
+    a_scene.camUp     = float3(cam.up);
+    a_scene.camFov    = cam.fov;
+    break;
+  }
+
+  return true;
+}
+
+static bool LoadBenchSceneGLTF(const std::string& a_path, BenchScene& a_scene)
+{
+  tinygltf::Model    gltfModel;
+  tinygltf::TinyGLTF gltfContext;
+  std::string error, warning;
+
+  const bool binary = a_path.size() >= 4 && a_path.compare(a_path.size() - 4, 4, ".glb") == 0;
+  const bool loaded = binary ? gltfContext.LoadBinaryFromFile(&gltfModel, &error, &warning, a_path)
+                             : gltfContext.LoadASCIIFromFile(&gltfModel, &error, &warning, a_path);
+  if(!loaded)
+  {
+    std::cout << "LoadBenchScene: can't load glTF scene from " << a_path << ": " << error << std::endl;
+    return false;
+  }
+
+  GLTFNodeTransforms transforms;
+  transforms.Init(gltfModel, gltfModel.scenes[gltfModel.defaultScene > 0 ? gltfModel.defaultScene : 0]);
+
+  std::unordered_map<int, uint32_t> loadedMeshes;
+  for(const auto& inst : flattenGLTFScene(gltfModel, transforms))
+  {
+    auto found = loadedMeshes.find(inst.mesh);
+    if(found == loadedMeshes.end())
+    {
+      auto mesh = simpleMeshFromGLTFMesh(gltfModel, gltfModel.meshes[inst.mesh]);
+      if(mesh.VerticesNum() == 0)
+        continue;
+      found = loadedMeshes.emplace(inst.mesh, uint32_t(a_scene.meshes.size())).first;
+      a_scene.meshes.push_back(std::move(mesh));
+    }
+
+    a_scene.instances.push_back({found->second, inst.matrix});
+  }
+
+  return true;
+}
+
+bool LoadBenchScene(const std::string& a_path, BenchScene& a_scene)
+{
+  a_scene = BenchScene();
+
+  const auto dot = a_path.find_last_of('.');
+  const std::string ext = (dot == std::string::npos) ? "" : a_path.substr(dot);
+
+  bool loaded = false;
+  if(ext == ".xml")
+    loaded = LoadBenchSceneXML(a_path, a_scene);
+  else if(ext == ".gltf" || ext == ".glb")
+    loaded = LoadBenchSceneGLTF(a_path, a_scene);
+  else
+    std::cout << "LoadBenchScene: unsupported scene format '" << ext << "'" << std::endl;
+
+  if(!loaded || a_scene.instances.empty())
+    return false;
+
+  UpdateBounds(a_scene);
+  return true;
+}
+
+std::vector<uint32_t> UploadBenchScene(const BenchScene& a_scene, ISceneObject* a_pRT)
+{
+  a_pRT->ClearGeom();
+  std::vector<uint32_t> geomIds;
+  geomIds.reserve(a_scene.meshes.size());
+  for(const auto& mesh : a_scene.meshes)
+  {
+    geomIds.push_back(a_pRT->AddGeom_Triangles4f(reinterpret_cast<const float4*>(mesh.vPos4f.data()), mesh.VerticesNum(),
+                                                 mesh.indices.data(), mesh.IndicesNum()));
+  }
+
+  a_pRT->ClearScene();
+  std::vector<uint32_t> instIds;
+  instIds.reserve(a_scene.instances.size());
+  for(const auto& inst : a_scene.instances)
+    instIds.push_back(a_pRT->AddInstance(geomIds[inst.meshId], inst.matrix));
+  a_pRT->CommitScene();
+  return instIds;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void BenchRays::Set(size_t a_rayId, const float4& a_posAndNear, const float4& a_dirAndFar)
+{
+  data[0*count + a_rayId] = a_posAndNear.x;
+  data[1*count + a_rayId] = a_posAndNear.y;
+  data[2*count + a_rayId] = a_posAndNear.z;
+  data[3*count + a_rayId] = a_posAndNear.w;
+  data[4*count + a_rayId] = a_dirAndFar.x;
+  data[5*count + a_rayId] = a_dirAndFar.y;
+  data[6*count + a_rayId] = a_dirAndFar.z;
+  data[7*count + a_rayId] = a_dirAndFar.w;
+}
+
+CRT_RaysSoA BenchRays::Rays() const
+{
+  CRT_RaysSoA rays;
+  rays.orgX  = data.data() + 0*count;
+  rays.orgY  = data.data() + 1*count;
+  rays.orgZ  = data.data() + 2*count;
+  rays.tNear = data.data() + 3*count;
+  rays.dirX  = data.data() + 4*count;
+  rays.dirY  = data.data() + 5*count;
+  rays.dirZ  = data.data() + 6*count;
+  rays.tFar  = data.data() + 7*count;
+  rays.count = count;
+  return rays;
+}
+
+BenchRays MakePrimaryRays(const BenchScene& a_scene, uint32_t a_width, uint32_t a_height)
+{
+  float3 camPos    = a_scene.camPos;
+  float3 camLookAt = a_scene.camLookAt;
+  float3 camUp     = a_scene.camUp;
+  float  camFov    = a_scene.camFov;
+  if(!a_scene.hasCamera)
+  {
+    const float3 center = 0.5f*(a_scene.boxMin + a_scene.boxMax);
+    const float  radius = 0.5f*LiteMath::length(a_scene.boxMax - a_scene.boxMin);
+    camFov    = 45.0f;
+    camLookAt = center;
+    camPos    = center + float3(0.0f, 0.0f, radius / std::tan(0.5f*camFov*LiteMath::DEG_TO_RAD));
+    camUp     = float3(0.0f, 1.0f, 0.0f);
+  }
+
+  const float  tanHalfFov = std::tan(0.5f*camFov*LiteMath::DEG_TO_RAD);
+  const float  aspect     = float(a_width) / float(a_height);
+  const float3 forward    = LiteMath::normalize(camLookAt - camPos);
+  const float3 right      = LiteMath::normalize(LiteMath::cross(forward, camUp));
+  const float3 up         = LiteMath::cross(right, forward);
+
+  BenchRays rays;
+  rays.Resize(size_t(a_width)*size_t(a_height));
+  for(uint32_t y = 0; y < a_height; y++)
+  {
+    for(uint32_t x = 0; x < a_width; x++)
+    {
+      const float  px  = (2.0f*(float(x) + 0.5f)/float(a_width) - 1.0f)*tanHalfFov*aspect;
+      const float  py  = (2.0f*(float(y) + 0.5f)/float(a_height) - 1.0f)*tanHalfFov;
+      const float3 dir = LiteMath::normalize(forward + px*right + py*up);
+      rays.Set(size_t(y)*a_width + x, to_float4(camPos, 0.0f), to_float4(dir, FLT_MAX));
+    }
+  }
+  return rays;
+}
+
+BenchRays MakeShadowRays(const BenchScene& a_scene, const BenchRays& a_primary, const std::vector<CRT_Hit>& a_primaryHits)
+{
+  const float3 size     = a_scene.boxMax - a_scene.boxMin;
+  const float3 lightPos = 0.5f*(a_scene.boxMin + a_scene.boxMax) + float3(0.1f*size.x, 0.35f*size.y, 0.1f*size.z);
+  const float  offset   = 1e-4f*LiteMath::length(size);
+
+  size_t hitsNum = 0;
+  for(size_t i = 0; i < a_primary.count; i++)
+    if(a_primaryHits[i].primId != uint32_t(-1))
+      hitsNum++;
+
+  const CRT_RaysSoA primary = a_primary.Rays();
+
+  BenchRays rays;
+  rays.Resize(hitsNum);
+  size_t rayId = 0;
+  for(size_t i = 0; i < a_primary.count; i++)
+  {
+    const CRT_Hit& hit = a_primaryHits[i];
+    if(hit.primId == uint32_t(-1))
+      continue;
+
+    const float3 primaryDir = float3(primary.dirX[i], primary.dirY[i], primary.dirZ[i]);
+    const float3 hitPos     = float3(primary.orgX[i], primary.orgY[i], primary.orgZ[i]) + hit.t*primaryDir - offset*primaryDir;
+    const float3 toLight    = lightPos - hitPos;
+    const float  dist       = LiteMath::length(toLight);
+    rays.Set(rayId++, to_float4(hitPos, 0.0f), to_float4(toLight/dist, dist));
+  }
+  return rays;
+}
+
+BenchRays MakeRandomRays(const BenchScene& a_scene, size_t a_count, uint32_t a_seed)
+{
+  std::mt19937 gen(a_seed);
+  std::uniform_real_distribution<float> rnd(0.0f, 1.0f);
+
+  BenchRays rays;
+  rays.Resize(a_count);
+  for(size_t i = 0; i < a_count; i++)
+  {
+    const float3 t   = float3(rnd(gen), rnd(gen), rnd(gen));
+    const float3 pos = a_scene.boxMin + t*(a_scene.boxMax - a_scene.boxMin);
+
+    const float  z   = 1.0f - 2.0f*rnd(gen);
+    const float  r   = std::sqrt(std::max(0.0f, 1.0f - z*z));
+    const float  phi = 2.0f*LiteMath::M_PI*rnd(gen);
+    rays.Set(i, to_float4(pos, 0.0f), float4(r*std::cos(phi), r*std::sin(phi), z, FLT_MAX));
+  }
+  return rays;
+}
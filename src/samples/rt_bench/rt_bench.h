@@ -0,0 +1,76 @@
+#ifndef VK_GRAPHICS_RT_RT_BENCH_H
+#define VK_GRAPHICS_RT_RT_BENCH_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "LiteMath.h"
+#include "render/CrossRT.h"
+#include "geom/cmesh.h"
+
+/**
+\brief Scene geometry loaded on CPU only, without Vulkan resources
+*/
+struct BenchScene
+{
+  struct Instance
+  {
+    uint32_t           meshId;
+    LiteMath::float4x4 matrix;
+  };
+
+  std::vector<cmesh::SimpleMesh> meshes;
+  std::vector<Instance>          instances;
+
+  LiteMath::float3 boxMin;
+  LiteMath::float3 boxMax;        ///< world space bounds of all instances
+
+  bool             hasCamera = false;
+  LiteMath::float3 camPos;
+  LiteMath::float3 camLookAt;
+  LiteMath::float3 camUp;
+  float            camFov    = 45.0f;
+
+  size_t TrianglesNum() const; ///< instanced triangles
+};
+
+/**
+\brief Load Hydra XML (*.xml) or glTF (*.gltf) scene with the same loaders SceneManager uses
+*/
+bool LoadBenchScene(const std::string& a_path, BenchScene& a_scene);
+
+/**
+\brief Add all meshes and instances of the scene to a_pRT and commit it; returns ids a_pRT gave to a_scene.instances
+*/
+std::vector<uint32_t> UploadBenchScene(const BenchScene& a_scene, ISceneObject* a_pRT);
+
+/**
+\brief Rays in SoA layout which can be passed to batched ray queries
+*/
+struct BenchRays
+{
+  std::vector<float> data; ///< orgX, orgY, orgZ, tNear, dirX, dirY, dirZ, tFar; each array has 'count' elements
+  size_t             count = 0;
+
+  void        Resize(size_t a_count) { count = a_count; data.resize(a_count*8); }
+  void        Set(size_t a_rayId, const LiteMath::float4& a_posAndNear, const LiteMath::float4& a_dirAndFar);
+  CRT_RaysSoA Rays() const;
+};
+
+/**
+\brief Eye rays of pinhole camera for every pixel of a_width x a_height frame, one ray per pixel center.
+Scene camera is used if there is one, otherwise camera looks at the scene bounds from the front.
+*/
+BenchRays MakePrimaryRays(const BenchScene& a_scene, uint32_t a_width, uint32_t a_height);
+
+/**
+\brief Occlusion rays from primary hit points to a point light above the scene; misses of a_primary are skipped
+*/
+BenchRays MakeShadowRays(const BenchScene& a_scene, const BenchRays& a_primary, const std::vector<CRT_Hit>& a_primaryHits);
+
+/**
+\brief Incoherent rays with origins uniformly distributed inside scene bounds and uniformly distributed directions
+*/
+BenchRays MakeRandomRays(const BenchScene& a_scene, size_t a_count, uint32_t a_seed);
+
+#endif// VK_GRAPHICS_RT_RT_BENCH_H
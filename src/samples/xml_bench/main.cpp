@@ -0,0 +1,158 @@
+#include "loader_utils/hydraxml.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+
+// usage: xml_bench [-instances 200000] [-iters 5] [-scene path/to/statex.xml]
+// measures parsing of Hydra XML instance matrices with hydra_xml::float4x4FromString against
+// std::wstringstream parsing it has replaced, on generated instances and optionally on a real scene
+
+// the previous implementation of hydra_xml::float4x4FromString, kept as the reference
+static LiteMath::float4x4 float4x4FromStream(const wchar_t* a_str)
+{
+  std::wstringstream inputStream(a_str);
+  float data[16];
+  for(int i = 0; i < 16; i++)
+    inputStream >> data[i];
+
+  LiteMath::float4x4 result;
+  result.set_row(0, LiteMath::float4(data[0], data[1], data[2], data[3]));
+  result.set_row(1, LiteMath::float4(data[4], data[5], data[6], data[7]));
+  result.set_row(2, LiteMath::float4(data[8], data[9], data[10], data[11]));
+  result.set_row(3, LiteMath::float4(data[12], data[13], data[14], data[15]));
+  return result;
+}
+
+// "-key value" pairs; a key which is not followed by a value is stored with an empty string
+static std::unordered_map<std::string, std::string> readParams(int argc, const char** argv)
+{
+  std::unordered_map<std::string, std::string> res;
+  for(int i = 1; i < argc; ++i)
+  {
+    std::string key(argv[i]);
+    if(key.empty() || key[0] != '-')
+      continue;
+    if(i + 1 < argc && argv[i + 1][0] != '-')
+      res[key] = argv[++i];
+    else
+      res[key] = "";
+  }
+  return res;
+}
+
+// scene node with a_num instances of random matrices written the same way as Hydra does ("%g" with up to 9 digits)
+static void generateInstances(pugi::xml_node a_scene, uint32_t a_num)
+{
+  std::mt19937 gen(12345);
+  std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+  std::uniform_real_distribution<float> pos(-1000.0f, 1000.0f);
+
+  wchar_t buf[512];
+  for(uint32_t i = 0; i < a_num; ++i)
+  {
+    const float a = angle(gen), s = std::sin(a), c = std::cos(a);
+    const float m[16] = {c, 0, s, pos(gen), 0, 1, 0, pos(gen), -s, 0, c, pos(gen), 0, 0, 0, 1};
+    int len = 0;
+    for(int j = 0; j < 16; ++j)
+      len += swprintf(buf + len, sizeof(buf) / sizeof(buf[0]) - len, j == 0 ? L"%.9g" : L" %.9g", m[j]);
+
+    auto inst = a_scene.append_child(L"instance");
+    inst.append_attribute(L"id")      = i;
+    inst.append_attribute(L"mesh_id") = i % 16;
+    inst.append_attribute(L"matrix")  = buf;
+  }
+}
+
+template<typename ParseFunc>
+static double benchParse(pugi::xml_node a_scene, uint32_t a_iters, ParseFunc a_parse, float& a_checksum)
+{
+  double best = 1e30;
+  for(uint32_t iter = 0; iter < a_iters; ++iter)
+  {
+    float sum = 0.0f;
+    auto before = std::chrono::high_resolution_clock::now();
+    for(auto inst = a_scene.child(L"instance"); inst != nullptr; inst = inst.next_sibling(L"instance"))
+    {
+      LiteMath::float4x4 m = a_parse(inst.attribute(L"matrix").as_string());
+      sum += m(0, 3) + m(1, 1);
+    }
+    auto after = std::chrono::high_resolution_clock::now();
+    best       = std::min(best, std::chrono::duration<double, std::milli>(after - before).count());
+    a_checksum = sum;
+  }
+  return best;
+}
+
+static void compare(const char* a_name, pugi::xml_node a_scene, uint32_t a_instNum, uint32_t a_iters)
+{
+  float sumStream = 0.0f, sumFast = 0.0f;
+  const double msStream = benchParse(a_scene, a_iters, float4x4FromStream, sumStream);
+  const double msFast   = benchParse(a_scene, a_iters, [](const wchar_t* a_str) { return hydra_xml::float4x4FromString(a_str); }, sumFast);
+
+  float maxDiff = 0.0f;
+  for(auto inst = a_scene.child(L"instance"); inst != nullptr; inst = inst.next_sibling(L"instance"))
+  {
+    auto a = float4x4FromStream(inst.attribute(L"matrix").as_string());
+    auto b = hydra_xml::float4x4FromString(inst.attribute(L"matrix").as_string());
+    for(int i = 0; i < 4; ++i)
+      for(int j = 0; j < 4; ++j)
+        maxDiff = std::max(maxDiff, std::abs(a(i, j) - b(i, j)));
+  }
+
+  std::cout << a_name << ": " << a_instNum << " instances" << std::endl;
+  std::cout << "  wstringstream:       " << msStream << " ms, " << a_instNum / (msStream * 1e-3) * 1e-6 << " M instances/s" << std::endl;
+  std::cout << "  float4x4FromString:  " << msFast   << " ms, " << a_instNum / (msFast   * 1e-3) * 1e-6 << " M instances/s" << std::endl;
+  std::cout << "  speedup: " << msStream / msFast << ", max difference: " << maxDiff << ", checksums: " << sumStream << " " << sumFast << std::endl;
+}
+
+int main(int argc, const char** argv)
+{
+  auto params = readParams(argc, argv);
+  auto getParam = [&params](const char* a_name, const std::string& a_default) {
+    auto found = params.find(a_name);
+    return (found == params.end() || found->second.empty()) ? a_default : found->second;
+  };
+
+  const uint32_t instNum = uint32_t(std::stoul(getParam("-instances", "200000")));
+  const uint32_t iters   = uint32_t(std::stoul(getParam("-iters", "5")));
+
+  pugi::xml_document doc;
+  auto scene = doc.append_child(L"scene");
+  generateInstances(scene, instNum);
+  compare("generated", scene, instNum, iters);
+
+  const std::string scenePath = getParam("-scene", "");
+  if(!scenePath.empty())
+  {
+    pugi::xml_document sceneDoc;
+    if(!sceneDoc.load_file(scenePath.c_str()))
+    {
+      std::cout << "xml_bench: can't load " << scenePath << std::endl;
+      return 1;
+    }
+    auto sceneNode = sceneDoc.child(L"scenes").child(L"scene");
+    uint32_t sceneInstNum = 0;
+    for(auto inst = sceneNode.child(L"instance"); inst != nullptr; inst = inst.next_sibling(L"instance"))
+      sceneInstNum++;
+    compare(scenePath.c_str(), sceneNode, sceneInstNum, iters);
+
+    double best = 1e30;
+    for(uint32_t iter = 0; iter < iters; ++iter)
+    {
+      hydra_xml::HydraScene hscene;
+      auto before = std::chrono::high_resolution_clock::now();
+      hscene.LoadState(scenePath);
+      auto after = std::chrono::high_resolution_clock::now();
+      best = std::min(best, std::chrono::duration<double, std::milli>(after - before).count());
+    }
+    std::cout << "  HydraScene::LoadState: " << best << " ms" << std::endl;
+  }
+
+  return 0;
+}
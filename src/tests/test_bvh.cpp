@@ -0,0 +1,351 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <random>
+#include <limits>
+#include <algorithm>
+
+#include "CrossRT.h"
+#include "cbvh.h"
+
+using LiteMath::float3;
+using LiteMath::float4;
+using LiteMath::float4x4;
+
+// native BVH backends are checked against brute force intersection of all triangles of all instances, see RefAllHits
+//
+struct TestMesh
+{
+  std::vector<float4>   vertices;
+  std::vector<uint32_t> indices;
+};
+
+struct TestInstance
+{
+  uint32_t meshId;
+  float4x4 matrix;
+};
+
+struct TestScene
+{
+  std::vector<TestMesh>     meshes;
+  std::vector<TestInstance> instances;
+};
+
+static TestMesh RandomTriangles(std::mt19937& a_gen, uint32_t a_trisNum, float a_size)
+{
+  std::uniform_real_distribution<float> pos(-1.0f, 1.0f);
+  std::uniform_real_distribution<float> offset(-a_size, a_size);
+  TestMesh mesh;
+  for(uint32_t i = 0; i < a_trisNum; i++)
+  {
+    const float3 center(pos(a_gen), pos(a_gen), pos(a_gen));
+    for(int k = 0; k < 3; k++)
+    {
+      mesh.vertices.push_back(float4(center.x + offset(a_gen), center.y + offset(a_gen), center.z + offset(a_gen), 1.0f));
+      mesh.indices.push_back(i*3 + k);
+    }
+  }
+  return mesh;
+}
+
+// with 8 SAH bins triangles spaced by factor of 8 are peeled one per level, so without depth limit the tree is very deep
+//
+static TestMesh ExponentialTriangles(uint32_t a_trisNum)
+{
+  TestMesh mesh;
+  float x = 1e-37f;
+  for(uint32_t i = 0; i < a_trisNum; i++, x *= 8.0f)
+  {
+    mesh.vertices.push_back(float4(x, -1.0f, -1.0f, 1.0f));
+    mesh.vertices.push_back(float4(x,  1.0f, -1.0f, 1.0f));
+    mesh.vertices.push_back(float4(x,  0.0f,  1.0f, 1.0f));
+    for(int k = 0; k < 3; k++)
+      mesh.indices.push_back(i*3 + k);
+  }
+  return mesh;
+}
+
+static uint32_t TreeDepth(const cbvh::BVHTree& a_tree, uint32_t a_nodeId)
+{
+  const cbvh::BVHNode& node = a_tree.nodes[a_nodeId];
+  if(node.primsCount != 0)
+    return 0;
+  return 1 + std::max(TreeDepth(a_tree, node.leftOffset), TreeDepth(a_tree, node.leftOffset + 1));
+}
+
+// traversal stacks are sized for MAX_TREE_DEPTH, so the builder must never exceed it
+//
+static int CheckDepthLimit(const TestMesh& a_mesh)
+{
+  std::vector<cbvh::Box3f> boxes;
+  for(size_t i = 0; i < a_mesh.indices.size(); i += 3)
+    boxes.push_back(cbvh::TriangleBox(a_mesh.vertices[a_mesh.indices[i+0]], a_mesh.vertices[a_mesh.indices[i+1]], a_mesh.vertices[a_mesh.indices[i+2]]));
+
+  cbvh::BuildSettings settings;
+  settings.binsNum        = 8;
+  settings.maxPrimsInLeaf = 1;
+  const uint32_t depth = TreeDepth(cbvh::BuildBVH2(boxes.data(), boxes.size(), settings), 0);
+  if(depth > cbvh::MAX_TREE_DEPTH)
+  {
+    std::cout << "test_bvh: tree depth " << depth << " exceeds " << cbvh::MAX_TREE_DEPTH << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+// 4-wide leaves pack the offset of the first primitive in 27 bits; larger offsets must not be collapsed into the count bits.
+// Only leaf offsets are packed, so the tree over two leaves with the offset at the limit checks it without 2^27 primitives
+//
+static int CheckLeafOffsetLimit()
+{
+  int errors = 0;
+  for(uint32_t lastOffset : {cbvh::BVH4_OFFSET_MASK, cbvh::BVH4_OFFSET_MASK + 1})
+  {
+    cbvh::BVHTree bvh2;
+    bvh2.nodes.resize(3);
+    bvh2.nodes[0] = {float3(0.0f), 1, float3(2.0f), 0};
+    bvh2.nodes[1] = {float3(0.0f), 0, float3(1.0f), 1};
+    bvh2.nodes[2] = {float3(1.0f), lastOffset, float3(2.0f), 1};
+    bvh2.primIndices = {0, 1};
+
+    const cbvh::BVH4Tree bvh4   = cbvh::CollapseBVH4(bvh2);
+    const bool           packed = lastOffset <= cbvh::BVH4_OFFSET_MASK;
+    bool ok = bvh4.nodes.empty() != packed;
+    if(ok && packed)
+    {
+      const uint32_t leaf = bvh4.nodes[0].child[1];
+      ok = cbvh::IsLeaf4(leaf) && cbvh::LeafFirst4(leaf) == lastOffset && cbvh::LeafCount4(leaf) == 1;
+    }
+    if(!ok)
+    {
+      std::cout << "test_bvh: leaf offset " << lastOffset << (packed ? " is not packed to 4-wide tree" : " is packed to 4-wide tree") << std::endl;
+      errors++;
+    }
+  }
+  return errors;
+}
+
+// the reference shares no code with the intersection of backends: triangles are transformed to world space and intersected with
+// their planes in double precision, then the hit point is tested against the edges with barycentric coordinates. Float code may
+// report hits close to an edge or to the ends of the ray interval either way, so such hits are only "possible"
+//
+struct RefVec
+{
+  double x, y, z;
+};
+
+static RefVec operator+(RefVec a, RefVec b)  { return {a.x + b.x, a.y + b.y, a.z + b.z}; }
+static RefVec operator-(RefVec a, RefVec b)  { return {a.x - b.x, a.y - b.y, a.z - b.z}; }
+static RefVec operator*(RefVec a, double b)  { return {a.x * b, a.y * b, a.z * b}; }
+static double Dot(RefVec a, RefVec b)        { return a.x * b.x + a.y * b.y + a.z * b.z; }
+static RefVec Cross(RefVec a, RefVec b)      { return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x}; }
+
+static RefVec ToWorld(const float4x4& a_matrix, float4 a_vertex)
+{
+  double res[3];
+  for(int i = 0; i < 3; i++)
+  {
+    const float4 row = a_matrix.get_row(i);
+    res[i] = double(row.x) * a_vertex.x + double(row.y) * a_vertex.y + double(row.z) * a_vertex.z + double(row.w);
+  }
+  return {res[0], res[1], res[2]};
+}
+
+static constexpr double REF_EDGE_EPS = 1e-4; ///< of barycentric coordinates
+static double RefTolerance(double a_t) { return 1e-4 * std::max(1.0, std::abs(a_t)); }
+
+struct RefHits
+{
+  double              tSure = std::numeric_limits<double>::infinity(); ///< the nearest hit which must be found
+  std::vector<double> tPossible;                                        ///< all hits which may be found, including the sure ones
+};
+
+static RefHits RefAllHits(const TestScene& a_scene, float4 a_posAndNear, float4 a_dirAndFar)
+{
+  const RefVec org = {a_posAndNear.x, a_posAndNear.y, a_posAndNear.z};
+  const RefVec dir = {a_dirAndFar.x, a_dirAndFar.y, a_dirAndFar.z};
+  RefHits hits;
+  for(const auto& inst : a_scene.instances)
+  {
+    const TestMesh& mesh = a_scene.meshes[inst.meshId];
+    for(size_t i = 0; i < mesh.indices.size(); i += 3)
+    {
+      const RefVec v0 = ToWorld(inst.matrix, mesh.vertices[mesh.indices[i+0]]);
+      const RefVec v1 = ToWorld(inst.matrix, mesh.vertices[mesh.indices[i+1]]);
+      const RefVec v2 = ToWorld(inst.matrix, mesh.vertices[mesh.indices[i+2]]);
+      const RefVec n  = Cross(v1 - v0, v2 - v0);
+      const double nn = Dot(n, n);
+      const double nd = Dot(n, dir);
+      if(nn == 0.0 || std::abs(nd) < 1e-9 * std::sqrt(nn * Dot(dir, dir))) // degenerate triangle or ray in its plane
+        continue;
+
+      const double t  = Dot(n, v0 - org) / nd;
+      const RefVec p  = org + dir * t;
+      const double b0 = Dot(Cross(v1 - p, v2 - p), n) / nn;
+      const double b1 = Dot(Cross(v2 - p, v0 - p), n) / nn;
+      const double b2 = 1.0 - b0 - b1;
+      const double edgeDist = std::min(b0, std::min(b1, b2));
+      const double tEps     = RefTolerance(t);
+
+      if(edgeDist > -REF_EDGE_EPS && t > a_posAndNear.w - tEps && t < a_dirAndFar.w + tEps)
+        hits.tPossible.push_back(t);
+      if(edgeDist > REF_EDGE_EPS && t > a_posAndNear.w + tEps && t < a_dirAndFar.w - tEps)
+        hits.tSure = std::min(hits.tSure, t);
+    }
+  }
+  return hits;
+}
+
+// nearest hit must be one of possible hits and must not be farther than the nearest sure one
+//
+static bool RefAcceptsHit(const RefHits& a_hits, bool a_isHit, float a_t)
+{
+  if(!a_isHit)
+    return a_hits.tSure == std::numeric_limits<double>::infinity();
+  if(a_t > a_hits.tSure + RefTolerance(a_hits.tSure))
+    return false;
+  for(double t : a_hits.tPossible)
+  {
+    if(std::abs(t - a_t) <= RefTolerance(t))
+      return true;
+  }
+  return false;
+}
+
+static std::vector<std::pair<float4, float4>> TestRays(std::mt19937& a_gen, uint32_t a_raysNum)
+{
+  const float inf = std::numeric_limits<float>::infinity();
+  std::uniform_real_distribution<float> pos(-3.0f, 3.0f);
+  std::normal_distribution<float>       dir(0.0f, 1.0f);
+
+  std::vector<std::pair<float4, float4>> rays;
+  for(uint32_t i = 0; i < a_raysNum; i++)
+  {
+    const float3 d = LiteMath::normalize(float3(dir(a_gen), dir(a_gen), dir(a_gen)));
+    rays.push_back({float4(pos(a_gen), pos(a_gen), pos(a_gen), 0.0f), float4(d.x, d.y, d.z, (i % 2 == 0) ? inf : 4.0f)});
+  }
+
+  // axis aligned rays have zero direction components, which are handled specially by box tests
+  //
+  const float3 axes[6] = {float3(1,0,0), float3(0,1,0), float3(0,0,1), float3(-1,0,0), float3(0,-1,0), float3(0,0,-1)};
+  for(uint32_t i = 0; i < a_raysNum / 4; i++)
+  {
+    const float3 d = axes[i % 6];
+    rays.push_back({float4(pos(a_gen), pos(a_gen), pos(a_gen), 0.0f), float4(d.x, d.y, d.z, inf)});
+  }
+  return rays;
+}
+
+// if 'a_updated' is not null, geometry of 'a_scene' is replaced with its meshes of the same topology (so trees are refitted) before ray queries
+//
+static int CheckScene(const char* a_impl, CRT_BuildProfile a_profile, const char* a_sceneName, const TestScene& a_scene,
+                      const std::vector<std::pair<float4, float4>>& a_rays, const TestScene* a_updated = nullptr)
+{
+  ISceneObject* pScene = CreateSceneRT(a_impl);
+  pScene->SetBuildProfile(a_profile);
+  pScene->ClearGeom();
+  std::vector<uint32_t> geomIds;
+  for(const auto& mesh : a_scene.meshes)
+    geomIds.push_back(pScene->AddGeom_Triangles4f(mesh.vertices.data(), mesh.vertices.size(), mesh.indices.data(), mesh.indices.size()));
+  pScene->ClearScene();
+  for(const auto& inst : a_scene.instances)
+    pScene->AddInstance(geomIds[inst.meshId], inst.matrix);
+  pScene->CommitScene();
+
+  if(a_updated != nullptr)
+  {
+    for(size_t i = 0; i < a_updated->meshes.size(); i++)
+    {
+      const TestMesh& mesh = a_updated->meshes[i];
+      pScene->UpdateGeom_Triangles4f(geomIds[i], mesh.vertices.data(), mesh.vertices.size(), mesh.indices.data(), mesh.indices.size());
+    }
+    pScene->CommitScene();
+  }
+  const TestScene& reference = (a_updated != nullptr) ? *a_updated : a_scene;
+
+  int errors = 0;
+  for(const auto& ray : a_rays)
+  {
+    const RefHits ref    = RefAllHits(reference, ray.first, ray.second);
+    const CRT_Hit hit    = pScene->RayQuery_NearestHit(ray.first, ray.second);
+    const bool    anyHit = pScene->RayQuery_AnyHit(ray.first, ray.second);
+    const bool    isHit  = hit.primId != uint32_t(-1);
+    const bool    anyOk  = anyHit ? !ref.tPossible.empty() : ref.tSure == std::numeric_limits<double>::infinity();
+
+    if(!RefAcceptsHit(ref, isHit, hit.t) || !anyOk)
+    {
+      if(errors < 5)
+        std::cout << "test_bvh: " << a_impl << ", " << a_sceneName << ": ray (" << ray.first.x << ", " << ray.first.y << ", " << ray.first.z << ") -> ("
+                  << ray.second.x << ", " << ray.second.y << ", " << ray.second.z << "), nearest sure t = " << ref.tSure << " of "
+                  << ref.tPossible.size() << " possible hits, got t = " << (isHit ? hit.t : -1.0f) << ", any hit = " << anyHit << std::endl;
+      errors++;
+    }
+  }
+
+  DeleteSceneRT(pScene);
+  if(errors != 0)
+    std::cout << "test_bvh: " << a_impl << ", " << a_sceneName << ": " << errors << " of " << a_rays.size() << " rays mismatch" << std::endl;
+  return errors;
+}
+
+int main(int argc, const char** argv)
+{
+  std::mt19937 gen(12345);
+
+  TestScene soup;
+  soup.meshes.push_back(RandomTriangles(gen, 2000, 0.1f));
+  soup.meshes.push_back(RandomTriangles(gen, 50, 0.5f));
+  soup.instances.push_back({0, float4x4()});
+  soup.instances.push_back({0, LiteMath::translate4x4(float3(1.5f, 0.0f, 0.0f)) * LiteMath::rotate4x4Y(0.7f)});
+  soup.instances.push_back({1, LiteMath::translate4x4(float3(0.0f, -1.0f, 0.5f)) * LiteMath::scale4x4(float3(0.5f, 2.0f, 1.0f))});
+
+  // BVH4 nodes of small trees have empty slots with (+inf, +inf) bounds, rays along +x, +y and +z with infinite 'tFar' pass the slab test for them
+  //
+  TestScene sparse;
+  sparse.meshes.push_back(RandomTriangles(gen, 3, 0.5f));
+  sparse.instances.push_back({0, float4x4()});
+  sparse.instances.push_back({0, LiteMath::translate4x4(float3(0.0f, 0.0f, 2.0f))});
+
+  // moved triangles keep their indices, so refit must enlarge boxes of all levels
+  //
+  TestScene moved = soup;
+  for(auto& v : moved.meshes[0].vertices)
+    v = float4(v.x + 0.3f*std::sin(5.0f*v.y), v.y, v.z + 0.3f*std::cos(5.0f*v.x), 1.0f);
+
+  // mesh without triangles has empty (infinite) bounds, which must not get into the top level
+  //
+  TestScene withEmpty = soup;
+  withEmpty.meshes.push_back(TestMesh());
+  withEmpty.meshes.back().vertices = {float4(0.0f, 0.0f, 0.0f, 1.0f)};
+  withEmpty.meshes.back().indices.reserve(3); // not null pointer to zero indices
+  withEmpty.instances.push_back({2, LiteMath::translate4x4(float3(0.5f, 0.5f, 0.5f))});
+  withEmpty.instances.push_back({1, LiteMath::translate4x4(float3(-1.0f, 1.0f, 0.0f))});
+
+  TestScene deep;
+  deep.meshes.push_back(ExponentialTriangles(80));
+  deep.instances.push_back({0, float4x4()});
+
+  const auto rays = TestRays(gen, 2000);
+
+  int errors = CheckDepthLimit(deep.meshes[0]);
+  errors += CheckLeafOffsetLimit();
+  if(!cbvh::TransformBox(LiteMath::translate4x4(float3(1.0f, 2.0f, 3.0f)), cbvh::Box3f()).empty())
+  {
+    std::cout << "test_bvh: transformed empty box is not empty" << std::endl;
+    errors++;
+  }
+  for(const char* impl : {"BVH2Common", "BVH4Common", "BVH4Compressed"})
+  {
+    errors += CheckScene(impl, CRT_BuildProfile::HIGH, "triangle soup", soup, rays);
+    errors += CheckScene(impl, CRT_BuildProfile::HIGH, "sparse nodes",  sparse, rays);
+    errors += CheckScene(impl, CRT_BuildProfile::FAST, "deep tree",     deep, rays);
+    errors += CheckScene(impl, CRT_BuildProfile::REFIT, "refitted soup", soup, rays, &moved);
+    errors += CheckScene(impl, CRT_BuildProfile::REFIT, "refitted empty mesh", withEmpty, rays, &withEmpty);
+  }
+
+  if(errors != 0)
+    return 1;
+  std::cout << "test_bvh: OK" << std::endl;
+  return 0;
+}
@@ -0,0 +1,157 @@
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <random>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <cwchar>
+
+#include "loader_utils/hydraxml.h"
+
+// hydra_xml::parseFloat must give the same bits and stop at the same character as strtof/wcstof (in "C" locale) for decimal numbers
+//
+static bool SameFloat(float a, float b)
+{
+  if(std::isnan(a) || std::isnan(b))
+    return std::isnan(a) && std::isnan(b) && std::signbit(a) == std::signbit(b);
+  return memcmp(&a, &b, sizeof(float)) == 0;
+}
+
+static int CheckToken(const std::string& a_token)
+{
+  char* refEnd = nullptr;
+  const float ref = strtof(a_token.c_str(), &refEnd);
+  const bool  refParsed = refEnd != a_token.c_str();
+
+  float val = 0.0f;
+  const char* end = hydra_xml::parseFloat(a_token.c_str(), val);
+
+  const std::wstring wtoken(a_token.begin(), a_token.end());
+  float wval = 0.0f;
+  const wchar_t* wend = hydra_xml::parseFloat(wtoken.c_str(), wval);
+
+  bool ok = (end != nullptr) == refParsed && (wend != nullptr) == refParsed;
+  if(ok && refParsed)
+    ok = end == refEnd && wend - wtoken.c_str() == refEnd - a_token.c_str() && SameFloat(val, ref) && SameFloat(wval, ref);
+
+  if(!ok)
+  {
+    std::cout << "test_hydraxml: \"" << a_token << "\": strtof gives " << ref << " (" << (refEnd - a_token.c_str()) << " chars), parseFloat gives "
+              << (end != nullptr ? val : 0.0f) << " (" << (end != nullptr ? int(end - a_token.c_str()) : -1) << " chars)" << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+static int CheckReadFloats()
+{
+  int errors = 0;
+  float data[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+  if(hydra_xml::readFloats(L" 1 -2.5\t3e2\n", data, 4) != 3 || data[0] != 1.0f || data[1] != -2.5f || data[2] != 300.0f || data[3] != 0.0f)
+  {
+    std::cout << "test_hydraxml: readFloats of 3 values" << std::endl;
+    errors++;
+  }
+  if(hydra_xml::readFloats("0.5 x 7", data, 3) != 1 || data[0] != 0.5f || data[1] != 0.0f || data[2] != 0.0f)
+  {
+    std::cout << "test_hydraxml: readFloats stops at invalid value" << std::endl;
+    errors++;
+  }
+  if(hydra_xml::readFloats("", data, 2) != 0 || data[0] != 0.0f || data[1] != 0.0f)
+  {
+    std::cout << "test_hydraxml: readFloats of empty string" << std::endl;
+    errors++;
+  }
+
+  float matrix[16];
+  hydra_xml::readFloats("1 0 0 4  0 1 0 5  0 0 1 6  0 0 0 1", matrix, 16);
+  const LiteMath::float4x4 m = hydra_xml::float4x4FromFloats(matrix);
+  if(m.get_col(3).x != 4.0f || m.get_col(3).y != 5.0f || m.get_col(3).z != 6.0f || m.get_col(3).w != 1.0f)
+  {
+    std::cout << "test_hydraxml: matrix translation" << std::endl;
+    errors++;
+  }
+  return errors;
+}
+
+// instances are streamed from "<scenes" tag found by text search; when the tag is in a comment, the whole file must be loaded instead
+//
+static int CheckStreamedState()
+{
+  const std::string path = (std::filesystem::temp_directory_path() / "vk_graphics_rt_test_hydraxml.xml").string();
+  {
+    std::ofstream file(path);
+    file << "<?xml version=\"1.0\"?>\n<!-- <scenes> go last -->\n<textures_lib/>\n<materials_lib/>\n<geometry_lib/>\n<lights_lib/>\n"
+            "<cam_lib/>\n<render_lib/>\n<scenes>\n  <scene id=\"0\">\n"
+            "    <instance id=\"0\" mesh_id=\"0\" rmap_id=\"-1\" matrix=\"1 0 0 1 0 1 0 2 0 0 1 3 0 0 0 1 \"/>\n"
+            "    <instance id=\"1\" mesh_id=\"1\" rmap_id=\"-1\" matrix=\"1 0 0 4 0 1 0 5 0 0 1 6 0 0 0 1 \"/>\n"
+            "  </scene>\n</scenes>\n";
+  }
+
+  int errors = 0;
+  for(bool streamInstances : {false, true})
+  {
+    hydra_xml::HydraScene scene;
+    std::vector<uint32_t> meshIds;
+    if(scene.LoadState(path, streamInstances) != 0 || scene.ForEachInstance([&](const hydra_xml::Instance& a_inst) { meshIds.push_back(a_inst.geomId); }) != 2 ||
+       meshIds != std::vector<uint32_t>{0, 1})
+    {
+      std::cout << "test_hydraxml: LoadState with \"<scenes\" in comment, streamInstances = " << streamInstances << std::endl;
+      errors++;
+    }
+  }
+  std::filesystem::remove(path);
+  return errors;
+}
+
+int main(int argc, const char** argv)
+{
+  const char* tokens[] = {
+    "0", "-0", "+0", "1", "-1", "+1", "0.5", "-0.5", ".5", "-.5", "+.5", "5.", "-5.", "007", "0.000",
+    "1e3", "1E3", "1e+3", "1e-3", "-1.5e-3", ".5e2", "5.e-1", "1e0", "1e-0", "1e", "1e+", "1e-", "1ex", "1.5e", "2E-",
+    "  3.25", "\t\n-7", "1.0 2.0", "1,5", "12abc",
+    "3.40282347e38", "3.40282357e38", "1e39", "-1e39", "1e400", "1e100000", "1.17549435e-38", "1.4e-45", "7e-46", "1e-50", "1e-100000",
+    "0.1", "0.2", "0.3", "3.14159265358979323846", "123456789012345678901234567890", "0.000000000000000000000000000012345",
+    "16777217", "16777219", "9007199254740993", "2.7182818284590452353602874713527e10",
+    "inf", "-inf", "+inf", "INF", "Infinity", "-infinity", "infin", "nan", "-nan", "NaN", "NAN",
+    "", " ", "-", "+", ".", "-.", "+-1", "--1", "e5", "-e5", ".e1", "abc", "i", "in", "na", "x1"
+  };
+
+  int errors = 0;
+  for(const char* token : tokens)
+    errors += CheckToken(token);
+
+  // random floats as exporters print them: shortest round trip and fixed point
+  //
+  std::mt19937 gen(12345);
+  std::uniform_int_distribution<uint32_t> bits;
+  std::uniform_real_distribution<float>   coord(-1000.0f, 1000.0f);
+  char buffer[64];
+  for(int i = 0; i < 200000; i++)
+  {
+    float value;
+    const uint32_t b = bits(gen);
+    memcpy(&value, &b, sizeof(float));
+    if(std::isfinite(value))
+    {
+      snprintf(buffer, sizeof(buffer), "%.9g", value);
+      errors += CheckToken(buffer);
+    }
+    snprintf(buffer, sizeof(buffer), "%.6f", coord(gen));
+    errors += CheckToken(buffer);
+    if(errors > 10)
+      break;
+  }
+
+  errors += CheckReadFloats();
+  errors += CheckStreamedState();
+
+  if(errors != 0)
+    return 1;
+  std::cout << "test_hydraxml: OK" << std::endl;
+  return 0;
+}
@@ -0,0 +1,97 @@
+#include <iostream>
+#include <filesystem>
+#include <vector>
+#include <cstring>
+
+#include "loader_utils/scene_cache.h"
+#include "test_utils.h"
+
+using namespace test_utils;
+
+// the cache is written and read back, then corrupted copies of it must be rejected by SceneCacheReader::Open
+//
+static const size_t HEADER_SECTIONS_OFFSET = 32; // magic[8], version, loadFlags, sourceTime, sourceSize
+static const size_t HEADER_SECTION_SIZE    = 24; // offset, count, elemSize
+
+int main(int argc, const char** argv)
+{
+  const auto dir = std::filesystem::temp_directory_path() / "vk_graphics_rt_test_scene_cache";
+  std::filesystem::remove_all(dir);
+  std::filesystem::create_directories(dir);
+
+  const std::string sourcePath = (dir / "scene.xml").string();
+  WriteBytes(sourcePath, {'<', 's', 'c', 'e', 'n', 'e', '/', '>'});
+
+  SceneCacheKey key;
+  if(!SceneCacheKey::FromFile(sourcePath, 7, key))
+  {
+    std::cout << "test_scene_cache: can't make key for " << sourcePath << std::endl;
+    return 1;
+  }
+
+  std::vector<float>    vertices(1000);
+  std::vector<uint32_t> indices(300);
+  for(size_t i = 0; i < vertices.size(); i++)
+    vertices[i] = float(i) * 0.5f;
+  for(size_t i = 0; i < indices.size(); i++)
+    indices[i] = uint32_t(i * 3 + 1);
+  const char texturePaths[] = "a.png\0textures/b.hdr";
+
+  SceneCacheWriter writer;
+  writer.Add(SCENE_CACHE_VERTICES,      vertices.data(), vertices.size());
+  writer.Add(SCENE_CACHE_INDICES,       indices.data(),  indices.size());
+  writer.Add(SCENE_CACHE_TEXTURE_PATHS, texturePaths,    sizeof(texturePaths));
+
+  const std::string cachePath = key.CachePath(dir.string());
+  int errors = Check(writer.Write(cachePath, key), "can't write cache");
+
+  {
+    SceneCacheReader reader;
+    errors += Check(reader.Open(cachePath, key), "can't open written cache");
+
+    size_t count = 0;
+    const float* cachedVertices = reader.Section<float>(SCENE_CACHE_VERTICES, count);
+    errors += Check(cachedVertices != nullptr && count == vertices.size() && memcmp(cachedVertices, vertices.data(), count*sizeof(float)) == 0,
+                    "vertices differ");
+    const uint32_t* cachedIndices = reader.Section<uint32_t>(SCENE_CACHE_INDICES, count);
+    errors += Check(cachedIndices != nullptr && count == indices.size() && memcmp(cachedIndices, indices.data(), count*sizeof(uint32_t)) == 0,
+                    "indices differ");
+    errors += Check(reader.Section<double>(SCENE_CACHE_VERTICES, count) == nullptr && count == 0, "section of other element size is returned");
+    errors += Check(reader.Section<uint32_t>(SCENE_CACHE_MATERIAL_IDS, count) == nullptr && count == 0, "empty section is returned");
+
+    const auto paths = reader.Strings(SCENE_CACHE_TEXTURE_PATHS);
+    errors += Check(paths.size() == 2 && paths[0] == "a.png" && paths[1] == "textures/b.hdr", "texture paths differ");
+  }
+
+  {
+    SceneCacheKey otherKey = key;
+    otherKey.loadFlags = 8;
+    SceneCacheReader reader;
+    errors += Check(!reader.Open(cachePath, otherKey), "cache for other load flags is accepted");
+  }
+
+  auto rejects = RejectsCorrupted(ReadBytes(cachePath), (dir / "corrupted.scache").string(), [&](const std::string& a_path) {
+    SceneCacheReader reader;
+    return reader.Open(a_path, key);
+  });
+
+  auto sectionField = [](std::vector<char>& a_data, SCENE_CACHE_SECTION a_section, size_t a_field) {
+    return FieldAt<uint64_t>(a_data, HEADER_SECTIONS_OFFSET + a_section*HEADER_SECTION_SIZE + a_field*sizeof(uint64_t));
+  };
+
+  errors += rejects("truncated file is accepted",  [](std::vector<char>& a_data) { a_data.resize(a_data.size() - 100); });
+  errors += rejects("truncated header is accepted", [](std::vector<char>& a_data) { a_data.resize(40); });
+  errors += rejects("bad magic is accepted",        [](std::vector<char>& a_data) { a_data[0] = 'X'; });
+  errors += rejects("other version is accepted",    [](std::vector<char>& a_data) { a_data[8]++; });
+  errors += rejects("misaligned section is accepted", [&](std::vector<char>& a_data) { *sectionField(a_data, SCENE_CACHE_INDICES, 0) += 4; });
+  errors += rejects("section out of file is accepted", [&](std::vector<char>& a_data) { *sectionField(a_data, SCENE_CACHE_INDICES, 1) += 1000000; });
+  errors += rejects("wrapped around section size is accepted", [&](std::vector<char>& a_data) {
+    *sectionField(a_data, SCENE_CACHE_VERTICES, 1) = (uint64_t(1) << 62) + 1; // count*sizeof(float) wraps around to 4
+  });
+
+  std::filesystem::remove_all(dir);
+  if(errors != 0)
+    return 1;
+  std::cout << "test_scene_cache: OK" << std::endl;
+  return 0;
+}
@@ -0,0 +1,157 @@
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <vector>
+#include <cstring>
+
+#include "loader_utils/texture_cache.h"
+#include "test_utils.h"
+#include "stb_image_write.h"
+
+using namespace test_utils;
+
+// .image4f texture is cached with its mip chain and read back, then corrupted copies of the cache must be rejected by CachedTexture::Open;
+// LDR and HDR images with other number of channels must be expanded to RGBA the same way as uncached textures are sampled
+//
+static const size_t HEADER_WIDTH_OFFSET       = 32; // magic[8], version, format, sourceTime, sourceSize
+static const size_t HEADER_DATA_SIZE_OFFSET   = 56; // width, height, mipLevels, pathLength, dataOffset
+static const size_t HEADER_MIP_OFFSETS_OFFSET = 64;
+
+static void WriteImage4f(const std::string& a_path, int32_t a_width, int32_t a_height, const std::vector<float>& a_pixels)
+{
+  std::ofstream file(a_path, std::ios::binary | std::ios::trunc);
+  file.write(reinterpret_cast<const char*>(&a_width),  sizeof(a_width));
+  file.write(reinterpret_cast<const char*>(&a_height), sizeof(a_height));
+  file.write(reinterpret_cast<const char*>(a_pixels.data()), a_pixels.size() * sizeof(float));
+}
+
+static int CheckCachedLevel0(const std::string& a_cacheDir, const std::string& a_path, TEXTURE_CACHE_FORMAT a_format, const void* a_expected,
+                             const char* a_what)
+{
+  const ImageFileInfo info = getImageInfo(a_path);
+  CachedTexture texture;
+  if(!loadCachedTexture(a_cacheDir, info, texture))
+    return Check(false, a_what);
+  const size_t bytes = size_t(info.width) * info.height * textureCacheBytesPerPixel(a_format);
+  return Check(texture.Format() == a_format && texture.MipSize(0) == bytes && memcmp(texture.Data() + texture.MipOffset(0), a_expected, bytes) == 0,
+               a_what);
+}
+
+static int CheckChannels(const std::string& a_dir)
+{
+  const int w = 3, h = 2;
+  std::vector<uint8_t> gray(w * h), rgb(w * h * 3);
+  std::vector<uint8_t> grayExpected, rgbExpected;
+  for(int i = 0; i < w * h; i++)
+  {
+    gray[i] = uint8_t(i * 40 + 10);
+    for(int c = 0; c < 3; c++)
+      rgb[i * 3 + c] = uint8_t(i * 30 + c * 7);
+    grayExpected.insert(grayExpected.end(), {gray[i], 0, 0, 255}); // as R8_UNORM image is sampled
+    rgbExpected.insert(rgbExpected.end(), {rgb[i * 3 + 0], rgb[i * 3 + 1], rgb[i * 3 + 2], 255});
+  }
+
+  const std::string grayPath = a_dir + "/gray.png", rgbPath = a_dir + "/rgb.png", hdrPath = a_dir + "/rgb.hdr";
+  stbi_write_png(grayPath.c_str(), w, h, 1, gray.data(), w);
+  stbi_write_png(rgbPath.c_str(),  w, h, 3, rgb.data(),  w * 3);
+
+  // .hdr stores shared exponent, so powers of two are exact; halves of 0.5, 0.25, 2.0 and 1.0 (alpha)
+  std::vector<float>    hdr;
+  std::vector<uint16_t> hdrExpected;
+  for(int i = 0; i < w * h; i++)
+  {
+    hdr.insert(hdr.end(), {0.5f, 0.25f, 2.0f});
+    hdrExpected.insert(hdrExpected.end(), {0x3800, 0x3400, 0x4000, 0x3C00});
+  }
+  stbi_write_hdr(hdrPath.c_str(), w, h, 3, hdr.data());
+
+  int errors = CheckCachedLevel0(a_dir, grayPath, TEXTURE_CACHE_RGBA8, grayExpected.data(), "1 channel LDR image is not cached as (r, 0, 0, 1)");
+  errors += CheckCachedLevel0(a_dir, rgbPath, TEXTURE_CACHE_RGBA8, rgbExpected.data(), "3 channel LDR image is not cached as (r, g, b, 1)");
+  errors += CheckCachedLevel0(a_dir, hdrPath, TEXTURE_CACHE_RGBA16F, hdrExpected.data(), "3 channel HDR image is not cached as half floats");
+  return errors;
+}
+
+int main(int argc, const char** argv)
+{
+  const auto dir = std::filesystem::temp_directory_path() / "vk_graphics_rt_test_texture_cache";
+  std::filesystem::remove_all(dir);
+  std::filesystem::create_directories(dir);
+
+  // 5x3 image has levels 5x3, 2x1 and 1x1
+  const uint32_t width = 5, height = 3;
+  std::vector<float> pixels(width * height * 4);
+  for(size_t i = 0; i < pixels.size(); i++)
+    pixels[i] = float(i % 17) * 0.25f;
+  const std::string imagePath = (dir / "image.image4f").string();
+  WriteImage4f(imagePath, int32_t(width), int32_t(height), pixels);
+
+  int errors = Check(loadImageHDR(getImageInfo(imagePath)) == pixels, "loadImageHDR differs from written pixels");
+
+  const ImageFileInfo info = getImageInfo(imagePath);
+  CachedTexture texture;
+  errors += Check(loadCachedTexture(dir.string(), info, texture), "can't cache texture");
+  if(texture.IsOpen())
+  {
+    errors += Check(texture.Format() == TEXTURE_CACHE_RGBA32F && texture.Width() == width && texture.Height() == height && texture.MipLevels() == 3,
+                    "wrong texture header");
+    errors += Check(texture.MipSize(0) == pixels.size() * sizeof(float) && memcmp(texture.Data() + texture.MipOffset(0), pixels.data(), texture.MipSize(0)) == 0,
+                    "level 0 differs from image");
+
+    // 2x1 level is 2x2 box filter, the last row is averaged with itself
+    const float* level1 = reinterpret_cast<const float*>(texture.Data() + texture.MipOffset(1));
+    auto pixel = [&](uint32_t x, uint32_t y, uint32_t c) { return pixels[(y * width + x) * 4 + c]; };
+    errors += Check(texture.MipSize(1) == 2 * 4 * sizeof(float) && level1[4] == (pixel(2, 0, 0) + pixel(3, 0, 0) + pixel(2, 1, 0) + pixel(3, 1, 0)) * 0.25f,
+                    "level 1 is not box filtered");
+    errors += Check(texture.MipOffset(2) % 64 == 0 && texture.MipOffset(2) + texture.MipSize(2) <= texture.DataSize(), "level 2 is out of data");
+  }
+  texture.Close();
+
+  // the cache file is opened again with the key of the image
+  std::string cachePath;
+  for(const auto& entry : std::filesystem::directory_iterator(dir))
+  {
+    if(entry.path().extension() == ".image4mip")
+      cachePath = entry.path().string();
+  }
+  SceneCacheKey key;
+  errors += Check(!cachePath.empty() && SceneCacheKey::FromFile(imagePath, TEXTURE_CACHE_RGBA32F, key) && texture.Open(cachePath, key),
+                  "can't open cached texture");
+  texture.Close();
+
+  auto rejects = RejectsCorrupted(ReadBytes(cachePath), (dir / "corrupted.image4mip").string(), [&](const std::string& a_path) {
+    CachedTexture corrupted;
+    return corrupted.Open(a_path, key);
+  });
+
+  errors += rejects("truncated file is accepted", [](std::vector<char>& a_data) { a_data.resize(a_data.size() - 64); });
+  errors += rejects("bad magic is accepted",      [](std::vector<char>& a_data) { a_data[0] = 'X'; });
+  errors += rejects("zero width is accepted",     [&](std::vector<char>& a_data) { *FieldAt<uint32_t>(a_data, HEADER_WIDTH_OFFSET) = 0; });
+  errors += rejects("huge size is accepted",      [&](std::vector<char>& a_data) {
+    *FieldAt<uint32_t>(a_data, HEADER_WIDTH_OFFSET)     = 0x80000000u; // 32 levels, size of level 0 wraps around 64 bits with 16 bytes per pixel
+    *FieldAt<uint32_t>(a_data, HEADER_WIDTH_OFFSET + 4) = 0x80000000u;
+    *FieldAt<uint32_t>(a_data, HEADER_WIDTH_OFFSET + 8) = 32;
+  });
+  errors += rejects("wrapped around data size is accepted", [&](std::vector<char>& a_data) { *FieldAt<uint64_t>(a_data, HEADER_DATA_SIZE_OFFSET) = ~uint64_t(0) - 100; });
+  errors += rejects("mip level out of data is accepted",    [&](std::vector<char>& a_data) { *FieldAt<uint64_t>(a_data, HEADER_MIP_OFFSETS_OFFSET + 2 * 8) += 64; });
+  errors += rejects("overlapping mip levels are accepted",  [&](std::vector<char>& a_data) {
+    *FieldAt<uint64_t>(a_data, HEADER_MIP_OFFSETS_OFFSET + 1 * 8) = *FieldAt<uint64_t>(a_data, HEADER_MIP_OFFSETS_OFFSET + 0 * 8);
+  });
+
+  // raw images with empty or overflowing sizes are rejected instead of allocated
+  const std::string badImagePath = (dir / "bad.image4f").string();
+  WriteImage4f(badImagePath, 0, 3, pixels);
+  errors += Check(loadImageHDR(getImageInfo(badImagePath)).empty(), "image of zero width is loaded");
+  WriteImage4f(badImagePath, 0x7FFFFFFF, 0x7FFFFFFF, pixels);
+  errors += Check(loadImageHDR(getImageInfo(badImagePath)).empty(), "image of overflowing size is loaded");
+  errors += Check(!loadCachedTexture(dir.string(), getImageInfo(badImagePath), texture), "image of overflowing size is cached");
+  WriteImage4f(badImagePath, int32_t(width), int32_t(height) + 1, pixels);
+  errors += Check(loadImageHDR(getImageInfo(badImagePath)).empty(), "truncated image is loaded");
+
+  errors += CheckChannels(dir.string());
+
+  std::filesystem::remove_all(dir);
+  if(errors != 0)
+    return 1;
+  std::cout << "test_texture_cache: OK" << std::endl;
+  return 0;
+}
@@ -0,0 +1,52 @@
+#ifndef CHIMERA_TEST_UTILS_H
+#define CHIMERA_TEST_UTILS_H
+
+#include <iostream>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+// helpers of CPU tests for binary files: reading, writing and checking that corrupted copies of a file are rejected
+//
+namespace test_utils
+{
+  inline std::vector<char> ReadBytes(const std::string& a_path)
+  {
+    std::ifstream file(a_path, std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  }
+
+  inline void WriteBytes(const std::string& a_path, const std::vector<char>& a_data)
+  {
+    std::ofstream file(a_path, std::ios::binary | std::ios::trunc);
+    file.write(a_data.data(), a_data.size());
+  }
+
+  // returns the number of errors, 0 or 1
+  inline int Check(bool a_condition, const char* a_what)
+  {
+    if(a_condition)
+      return 0;
+    std::cout << "check failed: " << a_what << std::endl;
+    return 1;
+  }
+
+  template<typename T>
+  T* FieldAt(std::vector<char>& a_data, size_t a_offset) { return reinterpret_cast<T*>(a_data.data() + a_offset); }
+
+  /**
+  \brief Returns function (a_what, a_corrupt) which corrupts a copy of a_original with a_corrupt, writes it to a_path and checks that a_open rejects it
+  */
+  inline auto RejectsCorrupted(const std::vector<char>& a_original, const std::string& a_path, std::function<bool(const std::string&)> a_open)
+  {
+    return [=](const char* a_what, const std::function<void(std::vector<char>&)>& a_corrupt) {
+      std::vector<char> data = a_original;
+      a_corrupt(data);
+      WriteBytes(a_path, data);
+      return Check(!a_open(a_path), a_what);
+    };
+  }
+}
+
+#endif// CHIMERA_TEST_UTILS_H
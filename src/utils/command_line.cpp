@@ -0,0 +1,27 @@
+#include "command_line.h"
+
+#include <cctype>
+
+std::unordered_map<std::string, std::string> readCommandLineParams(int argc, const char** argv)
+{
+  // "-key value" pairs; a key which is not followed by a value is stored with an empty string
+  std::unordered_map<std::string, std::string> res;
+  for(int i = 1; i < argc; ++i)
+  {
+    std::string key(argv[i]);
+    if(key.empty() || key[0] != '-')
+      continue;
+
+    // a negative number is a value, not a key; argv[i + 1][1] exists since argv[i + 1][0] is '-' and the string is null-terminated
+    const bool nextIsValue = (i + 1 < argc) &&
+                             (argv[i + 1][0] != '-' || (argv[i + 1][1] != '\0' && std::isdigit(static_cast<unsigned char>(argv[i + 1][1]))));
+    if(nextIsValue)
+    {
+      res[key] = argv[i + 1];
+      ++i;
+    }
+    else
+      res[key] = "";
+  }
+  return res;
+}
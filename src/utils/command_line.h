@@ -0,0 +1,13 @@
+#ifndef VK_GRAPHICS_RT_COMMAND_LINE_H
+#define VK_GRAPHICS_RT_COMMAND_LINE_H
+
+#include <string>
+#include <unordered_map>
+
+/**
+\brief "-key value" pairs of command line; a key which is not followed by a value is stored with an empty string.
+Values may be negative numbers, e.g. "-offset -1".
+*/
+std::unordered_map<std::string, std::string> readCommandLineParams(int argc, const char** argv);
+
+#endif// VK_GRAPHICS_RT_COMMAND_LINE_H
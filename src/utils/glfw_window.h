@@ -5,8 +5,8 @@
 #include "../render/render_gui.h"
 
 #include "GLFW/glfw3.h"
+#include "command_line.h"
 #include <memory>
-#include <unordered_map>
 
 
 void onKeyboardPressedBasic(GLFWwindow* window, int key, int scancode, int action, int mode);
@@ -24,6 +24,4 @@ void mainLoop(std::shared_ptr<IRender> &app, GLFWwindow* window, bool displayGUI
 
 void setupImGuiContext(GLFWwindow* a_window);
 
-std::unordered_map<std::string, std::string> readCommandLineParams(int argc, const char** argv);
-
 #endif //CBVH_STF_GLFW_WINDOW_H
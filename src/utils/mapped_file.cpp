@@ -0,0 +1,112 @@
+#include "mapped_file.h"
+
+#include <utility>
+
+#ifdef WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile& MappedFile::operator=(MappedFile&& a_other) noexcept
+{
+  if(this == &a_other)
+    return *this;
+  Close();
+  std::swap(m_data, a_other.m_data);
+  std::swap(m_size, a_other.m_size);
+#ifdef WIN32
+  std::swap(m_file,    a_other.m_file);
+  std::swap(m_mapping, a_other.m_mapping);
+#endif
+  return *this;
+}
+
+#ifdef WIN32
+
+bool MappedFile::Open(const std::string& a_path)
+{
+  Close();
+
+  HANDLE file = CreateFileA(a_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if(file == INVALID_HANDLE_VALUE)
+    return false;
+
+  LARGE_INTEGER size;
+  if(!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+  {
+    CloseHandle(file);
+    return false;
+  }
+
+  HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  void*  data    = (mapping != nullptr) ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+  if(data == nullptr)
+  {
+    if(mapping != nullptr)
+      CloseHandle(mapping);
+    CloseHandle(file);
+    return false;
+  }
+
+  m_file    = file;
+  m_mapping = mapping;
+  m_data    = reinterpret_cast<const uint8_t*>(data);
+  m_size    = size_t(size.QuadPart);
+  return true;
+}
+
+void MappedFile::Close()
+{
+  if(m_data != nullptr)
+    UnmapViewOfFile(m_data);
+  if(m_mapping != nullptr)
+    CloseHandle(m_mapping);
+  if(m_file != nullptr)
+    CloseHandle(m_file);
+  m_data    = nullptr;
+  m_size    = 0;
+  m_mapping = nullptr;
+  m_file    = nullptr;
+}
+
+#else
+
+bool MappedFile::Open(const std::string& a_path)
+{
+  Close();
+
+  const int fd = open(a_path.c_str(), O_RDONLY);
+  if(fd < 0)
+    return false;
+
+  struct stat st;
+  if(fstat(fd, &st) != 0 || st.st_size == 0)
+  {
+    close(fd);
+    return false;
+  }
+
+  void* data = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd); // mapping stays valid after the descriptor is closed
+  if(data == MAP_FAILED)
+    return false;
+
+  m_data = reinterpret_cast<const uint8_t*>(data);
+  m_size = size_t(st.st_size);
+  return true;
+}
+
+void MappedFile::Close()
+{
+  if(m_data != nullptr)
+    munmap(const_cast<uint8_t*>(m_data), m_size);
+  m_data = nullptr;
+  m_size = 0;
+}
+
+#endif
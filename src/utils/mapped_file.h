@@ -0,0 +1,43 @@
+#ifndef VK_GRAPHICS_RT_MAPPED_FILE_H
+#define VK_GRAPHICS_RT_MAPPED_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+/**
+\brief Read-only memory mapping of a whole file. Pages are loaded by OS on first access, so opening is cheap
+and only touched parts of the file are read.
+*/
+class MappedFile
+{
+public:
+  MappedFile() = default;
+  ~MappedFile() { Close(); }
+
+  MappedFile(const MappedFile&)            = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  MappedFile(MappedFile&& a_other) noexcept { *this = std::move(a_other); }
+  MappedFile& operator=(MappedFile&& a_other) noexcept;
+
+  bool Open(const std::string& a_path); ///< returns false if file does not exist or can't be mapped; empty files can't be mapped
+  void Close();
+
+  bool           IsOpen() const { return m_data != nullptr; }
+  const uint8_t* Data()   const { return m_data; }
+  size_t         Size()   const { return m_size; }
+
+  template<typename T>
+  const T* At(size_t a_offset) const { return reinterpret_cast<const T*>(m_data + a_offset); }
+
+private:
+  const uint8_t* m_data = nullptr;
+  size_t         m_size = 0;
+#ifdef WIN32
+  void*          m_file    = nullptr;
+  void*          m_mapping = nullptr;
+#endif
+};
+
+#endif// VK_GRAPHICS_RT_MAPPED_FILE_H
@@ -0,0 +1,137 @@
+#include "tile_scheduler.h"
+
+#include <algorithm>
+#include <chrono>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+static uint32_t MortonCode2D(uint32_t x, uint32_t y)
+{
+  auto spreadBits = [](uint32_t v) {
+    v &= 0x0000ffff;
+    v = (v | (v << 8)) & 0x00ff00ff;
+    v = (v | (v << 4)) & 0x0f0f0f0f;
+    v = (v | (v << 2)) & 0x33333333;
+    v = (v | (v << 1)) & 0x55555555;
+    return v;
+  };
+  return spreadBits(x) | (spreadBits(y) << 1);
+}
+
+TileScheduler::TileScheduler(uint32_t a_width, uint32_t a_height, uint32_t a_tileSize) :
+  m_width(a_width), m_height(a_height), m_tileSize(std::max(a_tileSize, 1u))
+{
+  m_tilesX = (m_width  + m_tileSize - 1) / m_tileSize;
+  m_tilesY = (m_height + m_tileSize - 1) / m_tileSize;
+
+  m_tiles.reserve(m_tilesX * m_tilesY);
+  for(uint32_t ty = 0; ty < m_tilesY; ++ty)
+  {
+    for(uint32_t tx = 0; tx < m_tilesX; ++tx)
+    {
+      RenderTile tile;
+      tile.x      = tx * m_tileSize;
+      tile.y      = ty * m_tileSize;
+      tile.width  = std::min(m_tileSize, m_width  - tile.x);
+      tile.height = std::min(m_tileSize, m_height - tile.y);
+      tile.id     = ty * m_tilesX + tx;
+      m_tiles.push_back(tile);
+    }
+  }
+
+  std::sort(m_tiles.begin(), m_tiles.end(), [this](const RenderTile& a, const RenderTile& b) {
+    return MortonCode2D(a.x / m_tileSize, a.y / m_tileSize) < MortonCode2D(b.x / m_tileSize, b.y / m_tileSize);
+  });
+
+  m_tileTimeMs.resize(m_tiles.size(), 0.0f);
+
+#ifdef _OPENMP
+  const uint32_t threadsNum = uint32_t(omp_get_max_threads());
+#else
+  const uint32_t threadsNum = 1;
+#endif
+  m_queues.resize(threadsNum);
+  for(auto& queue : m_queues)
+    queue = std::make_unique<WorkQueue>();
+}
+
+float TileScheduler::MaxTileTimeMs() const
+{
+  if(m_tileTimeMs.empty())
+    return 0.0f;
+  return *std::max_element(m_tileTimeMs.begin(), m_tileTimeMs.end());
+}
+
+bool TileScheduler::PopLocal(uint32_t a_threadId, uint32_t& a_tileId)
+{
+  WorkQueue& queue = *m_queues[a_threadId];
+  std::lock_guard<std::mutex> guard(queue.lock);
+  if(queue.tiles.empty())
+    return false;
+  a_tileId = queue.tiles.front();
+  queue.tiles.pop_front();
+  return true;
+}
+
+bool TileScheduler::StealTile(uint32_t a_threadId, uint32_t& a_tileId)
+{
+  const uint32_t threadsNum = uint32_t(m_queues.size());
+  for(uint32_t i = 1; i < threadsNum; ++i)
+  {
+    WorkQueue& victim = *m_queues[(a_threadId + i) % threadsNum];
+    std::lock_guard<std::mutex> guard(victim.lock);
+    if(!victim.tiles.empty())
+    {
+      a_tileId = victim.tiles.back(); // steal from the far end to keep the victim's locality
+      victim.tiles.pop_back();
+      m_stealsNum++;
+      return true;
+    }
+  }
+  return false;
+}
+
+void TileScheduler::Run(const std::function<void(const RenderTile&)>& a_tileFunc)
+{
+  const uint32_t threadsNum = uint32_t(m_queues.size());
+  const uint32_t tilesNum   = uint32_t(m_tiles.size());
+  const uint32_t chunkSize  = (tilesNum + threadsNum - 1) / threadsNum;
+
+  for(uint32_t t = 0; t < threadsNum; ++t)
+  {
+    auto& tiles = m_queues[t]->tiles;
+    tiles.clear();
+    const uint32_t begin = std::min(t * chunkSize, tilesNum);
+    const uint32_t end   = std::min(begin + chunkSize, tilesNum);
+    for(uint32_t i = begin; i < end; ++i)
+      tiles.push_back(i);
+  }
+  m_stealsNum = 0;
+
+  const auto frameStart = std::chrono::high_resolution_clock::now();
+
+  #pragma omp parallel num_threads(threadsNum)
+  {
+#ifdef _OPENMP
+    const uint32_t threadId = uint32_t(omp_get_thread_num());
+#else
+    const uint32_t threadId = 0;
+#endif
+    uint32_t tileIndex = 0;
+    while(PopLocal(threadId, tileIndex) || StealTile(threadId, tileIndex))
+    {
+      const RenderTile& tile = m_tiles[tileIndex];
+      const auto tileStart   = std::chrono::high_resolution_clock::now();
+
+      a_tileFunc(tile);
+
+      const auto tileEnd = std::chrono::high_resolution_clock::now();
+      m_tileTimeMs[tile.id] = std::chrono::duration<float, std::milli>(tileEnd - tileStart).count();
+    }
+  }
+
+  const auto frameEnd = std::chrono::high_resolution_clock::now();
+  m_frameTimeMs = std::chrono::duration<float, std::milli>(frameEnd - frameStart).count();
+}
@@ -0,0 +1,73 @@
+#ifndef VK_GRAPHICS_RT_TILE_SCHEDULER_H
+#define VK_GRAPHICS_RT_TILE_SCHEDULER_H
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+struct RenderTile
+{
+  uint32_t x      = 0; ///< left pixel of the tile
+  uint32_t y      = 0; ///< top pixel of the tile
+  uint32_t width  = 0; ///< may be smaller than tile size at the right image border
+  uint32_t height = 0; ///< may be smaller than tile size at the bottom image border
+  uint32_t id     = 0; ///< row-major index of the tile in the tile grid
+};
+
+/**
+\brief Splits the frame into square tiles and distributes them between CPU threads.
+
+Tiles are sorted in Morton (Z-curve) order and dealt to per-thread deques in contiguous chunks,
+so that each thread starts with spatially close tiles. A thread pops tiles from the front of its own deque
+and, when it runs out of work, steals from the back of other threads' deques.
+Time spent on every tile is measured and kept until the next Run().
+*/
+class TileScheduler
+{
+public:
+  TileScheduler(uint32_t a_width, uint32_t a_height, uint32_t a_tileSize = 16);
+
+  void Run(const std::function<void(const RenderTile&)>& a_tileFunc);
+
+  uint32_t TileSize() const { return m_tileSize; }
+  uint32_t TilesX()   const { return m_tilesX; }
+  uint32_t TilesY()   const { return m_tilesY; }
+  const std::vector<RenderTile>& Tiles() const { return m_tiles; }
+
+  //// statistics of the last Run()
+  //
+  const std::vector<float>& TileTimesMs() const { return m_tileTimeMs; } ///< indexed by RenderTile::id
+  float    FrameTimeMs()   const { return m_frameTimeMs; }
+  float    MaxTileTimeMs() const;
+  uint32_t StealsNum()     const { return m_stealsNum.load(); }
+  uint32_t ThreadsNum()    const { return uint32_t(m_queues.size()); }
+
+private:
+  struct WorkQueue
+  {
+    std::mutex            lock;
+    std::deque<uint32_t>  tiles;
+  };
+
+  bool PopLocal (uint32_t a_threadId, uint32_t& a_tileId);
+  bool StealTile(uint32_t a_threadId, uint32_t& a_tileId);
+
+  uint32_t m_width;
+  uint32_t m_height;
+  uint32_t m_tileSize;
+  uint32_t m_tilesX;
+  uint32_t m_tilesY;
+
+  std::vector<RenderTile>                 m_tiles;   ///< in Morton order
+  std::vector<std::unique_ptr<WorkQueue>> m_queues;  ///< one per thread
+
+  std::vector<float>    m_tileTimeMs;
+  float                 m_frameTimeMs = 0.0f;
+  std::atomic<uint32_t> m_stealsNum{0};
+};
+
+#endif// VK_GRAPHICS_RT_TILE_SCHEDULER_H